@@ -0,0 +1,159 @@
+﻿///
+///@file estimator-test.cpp
+///@brief Estimatorクラスのテストプログラム
+///@par Copyright
+/// Copyright (C) 2026 Team ODENS, Masutani Lab, Osaka Electro-Communication University
+///@par 履歴
+///- 2026/10/18 升谷 保博 新規作成（Estimatorのインスタンスが独立かのテスト）
+///
+#include <iostream>
+#include <cmath>
+#include "sr.h"
+#include "estimator.h"
+#include "ric30.h"
+
+using namespace std;
+using namespace odens;
+
+///
+///@brief 試験用の位置情報を作る
+///@param[out] sinfo 位置情報
+///@param[in] scenario 場面の番号（0か1）
+///@param[in] n フレーム番号
+///@param[in] t 時刻 [s]
+///@return なし
+///
+///- 場面0: 静止したボールにときどき外れ値が入り，途中で蹴られる．ロボットは1台．
+///- 場面1: ボールが斜めに転がり，途中で見えなくなる．場面0と同じフレームに外れ値が入る．
+///  ロボットは2台で1台は番号が得られない．
+///
+void makeInfo(srInfo &sinfo, int scenario, int n, double t)
+{
+  const Orthogonal invisible(INVISIBLE, INVISIBLE, INVISIBLE);
+  for (int c=BLUE; c<=YELLOW; c++) {
+    for (int i=0; i<=MAX_ROBOT_NUM; i++) {
+      sinfo.robot[c][i] = invisible;
+      sinfo.id[c][i] = false;
+    }
+  }
+  sinfo.time = t;
+  if (scenario == 0) {
+    double x = (n < 120) ? 0 : 1000*(t-2.0);
+    sinfo.ball = (n%37 == 36) ? Orthogonal(x+500, 0, 0) : Orthogonal(x, 5*sin(n*0.7), 0);
+    sinfo.robot[BLUE][1] = Orthogonal(-500, 100+n, 0);
+    sinfo.id[BLUE][1] = true;
+  } else {
+    if (n >= 100 && n < 140) {
+      sinfo.ball = invisible;
+    } else if (n%37 == 36) {
+      sinfo.ball = Orthogonal(-1000+400*t, 300*t+600, 0);
+    } else {
+      sinfo.ball = Orthogonal(-1000+400*t, 300*t, 0);
+    }
+    sinfo.robot[YELLOW][2] = Orthogonal(800, -200, M_PI/2);
+    sinfo.id[YELLOW][2] = true;
+    sinfo.robot[YELLOW][3] = (n%10 == 0) ? invisible : Orthogonal(-300+2*n, 400, 0);
+  }
+}
+
+///
+///@brief 2つの推定結果が同じか？
+///
+bool isSame(const srInfo &a, const Timed2D &va, BallMotion ma,
+            const srInfo &b, const Timed2D &vb, BallMotion mb)
+{
+  if (a.ball.x != b.ball.x || a.ball.y != b.ball.y
+      || va.x != vb.x || va.y != vb.y || ma != mb) {
+    return false;
+  }
+  for (int c=BLUE; c<=YELLOW; c++) {
+    for (int i=1; i<=MAX_ROBOT_NUM; i++) {
+      if (a.robot[c][i].x != b.robot[c][i].x || a.robot[c][i].y != b.robot[c][i].y
+          || a.robot[c][i].theta != b.robot[c][i].theta || a.id[c][i] != b.id[c][i]) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+///
+///@brief 2つのTaskを交互に動かし，互いの状態に影響されないかを調べる
+///@return 不一致の数
+///
+///- 目標までの距離による移動の状態（ヒステリシス）をmove()の戻り値（近い状態で向きが合えば10）で見る．
+///- Robotは開始しないので，コマンドを送れないというメッセージは捨てる．
+///
+int testTasks()
+{
+  int errors = 0;
+  srInfo sinfo;
+  sinfo.robot[BLUE][1] = Orthogonal(0, 0, 0);
+  TaskRIC30 task0(BLUE, 1);
+  TaskRIC30 task1(BLUE, 1);
+  streambuf *buf = cerr.rdbuf(nullptr);
+
+  //task0は近付いたので120mmではまだ近い状態，task1は遠い状態のまま
+  task0.move(sinfo, Orthogonal(60, 0, 0));
+  task1.move(sinfo, Orthogonal(200, 0, 0));
+  if (task0.move(sinfo, Orthogonal(120, 0, 0)) != 10) errors++;
+  if (task1.move(sinfo, Orthogonal(120, 0, 0)) != 0) errors++;
+
+  cerr.rdbuf(buf);
+  cerr.clear();
+  if (errors > 0) {
+    cout << "NG: 2つのTaskの状態" << endl;
+  }
+  return errors;
+}
+
+///estimator-testメイン関数
+int main()
+{
+  const int frames = 300;
+  const double dt = 1.0/60;
+
+  //それぞれ単独で動かした結果を基準とする
+  static srInfo reference[2][frames];
+  static Timed2D referenceVel[2][frames];
+  static BallMotion referenceMotion[2][frames];
+  for (int s=0; s<2; s++) {
+    Estimator estimator;
+    for (int n=0; n<frames; n++) {
+      srInfo sinfo;
+      makeInfo(sinfo, s, n, n*dt);
+      estimator.update(reference[s][n], referenceVel[s][n], referenceMotion[s][n], sinfo, n*dt);
+    }
+  }
+
+  //2つのインスタンスを交互に動かし，単独の場合と同じ結果になるかを調べる
+  Estimator estimator[2];
+  int errors = 0;
+  for (int n=0; n<frames; n++) {
+    for (int s=0; s<2; s++) {
+      srInfo sinfo, sinfo2;
+      Timed2D ballVel;
+      BallMotion motion;
+      makeInfo(sinfo, s, n, n*dt);
+      estimator[s].update(sinfo2, ballVel, motion, sinfo, n*dt);
+      if (!isSame(sinfo2, ballVel, motion, reference[s][n], referenceVel[s][n], referenceMotion[s][n])) {
+        cout << "場面" << s << " フレーム" << n << ": 単独の場合と異なる" << endl;
+        errors++;
+      }
+    }
+  }
+  //範囲外のパラメータは拒んで，前の値のままにする
+  EstimatorParameter bad;
+  bad.ballErrorLimit = -1;
+  if (!estimator[0].setParameter(bad)) {
+    cout << "範囲外のパラメータを受け付けた" << endl;
+    errors++;
+  }
+  errors += testTasks();
+  if (errors > 0) {
+    cout << "NG: " << errors << "件の不一致" << endl;
+    return 1;
+  }
+  cout << "OK: 2つのインスタンスは独立に動作している" << endl;
+  return 0;
+}
@@ -0,0 +1,292 @@
+﻿///
+///@file estimator-tuner.cpp
+///@brief 記録したログからEstimatorのパラメータを調整するプログラム
+///@par Copyright
+/// Copyright (C) 2026 Team ODENS, Masutani Lab, Osaka Electro-Communication University
+///@par 履歴
+///- 2026/10/18 升谷 保博 新規作成（Estimatorのパラメータ調整）
+///
+///- Loggerで記録したログ（ビジョンからの生の位置情報）を再生してEstimatorを動かし，
+///  誤差の小さいパラメータを乱択で探索する．候補の評価は全コアで並列に行う．
+///- 評価値は次の2つの平均の和で，外れ値の影響を抑えるためにどちらもCLIP_ERRORで頭打ちにする．
+///  - ボール: 1フレーム先の予測位置と次の観測との距離（遅れと雑音の両方を反映する）
+///  - 一定の間隔でわざと観測を隠し，隠している間の推定値と隠した観測との距離（保持と外挿を反映する）
+///
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <random>
+#include <algorithm>
+#include <cstdlib>
+#include <cmath>
+#include "sr.h"
+#include "estimator.h"
+
+using namespace std;
+using namespace odens;
+
+#define CLIP_ERROR (300.0)  ///<誤差の頭打ちの値 [mm]
+#define MASK_PERIOD (150)   ///<観測を隠す周期 [フレーム]
+#define MASK_LENGTH (15)    ///<観測を隠す長さ [フレーム]
+
+///
+///@brief ログの1フレーム分
+///
+struct LogFrame {
+  double time;  ///<時刻 [s]
+  srInfo sinfo; ///<ビジョンからの位置情報
+};
+
+///
+///@brief ログファイルを読み込む
+///@param[in] fileName ファイル名
+///@param[out] frames 読み込んだフレームの並び
+///@retval false 正常終了
+///@retval true 異常終了
+///
+///- 書式はLogger::write()の出力（時刻の文字列，時刻，ボール，両チームのロボット，…）．
+///- ロボットは見えていれば番号が得られているものとみなす．
+///
+bool readLog(const string &fileName, vector<LogFrame> &frames)
+{
+  ifstream fin(fileName.c_str());
+  if (!fin) {
+    cerr << "ファイルを開けない: " << fileName << endl;
+    return true;
+  }
+  string line;
+  while (getline(fin, line)) {
+    istringstream is(line);
+    string clock;
+    LogFrame f;
+    srInfo &s = f.sinfo;
+    is >> clock >> f.time >> s.ball.x >> s.ball.y >> s.ball.theta;
+    for (int c=BLUE; c<=YELLOW; c++) {
+      s.robot[c][0] = Orthogonal(INVISIBLE, INVISIBLE, INVISIBLE);
+      s.id[c][0] = false;
+      for (int i=1; i<=MAX_ROBOT_NUM; i++) {
+        is >> s.robot[c][i].x >> s.robot[c][i].y >> s.robot[c][i].theta;
+        s.id[c][i] = !s.robot[c][i].isInvisible();
+      }
+    }
+    if (!is) {
+      continue; //読めない行は飛ばす
+    }
+    s.time = f.time;
+    frames.push_back(f);
+  }
+  if (frames.empty()) {
+    cerr << "有効な行がない: " << fileName << endl;
+    return true;
+  }
+  return false;
+}
+
+///
+///@brief 2点間の距離（頭打ちあり）
+///
+static double clippedDistance(const Orthogonal &a, const Orthogonal &b)
+{
+  if (a.isInvisible() || b.isInvisible()) {
+    return CLIP_ERROR;
+  }
+  double dx = a.x-b.x;
+  double dy = a.y-b.y;
+  return std::min(sqrt(dx*dx+dy*dy), CLIP_ERROR);
+}
+
+///
+///@brief パラメータを評価する
+///@param[in] param パラメータ
+///@param[in] logs ログの並び
+///@param[out] ballError ボールの平均誤差 [mm]
+///@param[out] robotError ロボットの平均誤差 [mm]
+///@return 評価値（小さい方が良い）
+///
+double evaluate(const EstimatorParameter &param, const vector<vector<LogFrame>> &logs,
+                double &ballError, double &robotError)
+{
+  double ballSum = 0, robotSum = 0;
+  long ballCount = 0, robotCount = 0;
+  for (size_t l=0; l<logs.size(); l++) {
+    const vector<LogFrame> &log = logs[l];
+    Estimator estimator;
+    estimator.setParameter(param);
+    Orthogonal prevBall(INVISIBLE, INVISIBLE, INVISIBLE);
+    Timed2D prevVel(0, 0, 0);
+    double prevTime = 0;
+    for (size_t k=0; k<log.size(); k++) {
+      const LogFrame &f = log[k];
+      const bool masked = (k % MASK_PERIOD) >= MASK_PERIOD-MASK_LENGTH;
+      srInfo sinfo = f.sinfo;
+      if (masked) {
+        sinfo.ball.vanish();
+        for (int c=BLUE; c<=YELLOW; c++) {
+          for (int i=1; i<=MAX_ROBOT_NUM; i++) {
+            sinfo.robot[c][i].vanish();
+            sinfo.id[c][i] = false;
+          }
+        }
+      }
+      //1フレーム先の予測の誤差
+      if (!masked && !f.sinfo.ball.isInvisible() && !prevBall.isInvisible()) {
+        double dt = f.time-prevTime;
+        Orthogonal pred(prevBall.x+prevVel.x*dt, prevBall.y+prevVel.y*dt, 0);
+        ballSum += clippedDistance(pred, f.sinfo.ball);
+        ballCount++;
+      }
+      srInfo sinfo2;
+      Timed2D ballVel;
+      estimator.update(sinfo2, ballVel, sinfo, f.time);
+      //隠している間の誤差
+      if (masked && !f.sinfo.ball.isInvisible()) {
+        ballSum += clippedDistance(sinfo2.ball, f.sinfo.ball);
+        ballCount++;
+      }
+      for (int c=BLUE; c<=YELLOW; c++) {
+        for (int i=1; i<=MAX_ROBOT_NUM; i++) {
+          if (!f.sinfo.robot[c][i].isInvisible()) {
+            robotSum += clippedDistance(sinfo2.robot[c][i], f.sinfo.robot[c][i]);
+            robotCount++;
+          }
+        }
+      }
+      prevBall = sinfo2.ball;
+      prevVel = ballVel;
+      prevTime = f.time;
+    }
+  }
+  ballError = (ballCount > 0) ? ballSum/ballCount : 0;
+  robotError = (robotCount > 0) ? robotSum/robotCount : 0;
+  return ballError + robotError;
+}
+
+///
+///@brief 探索範囲から候補を1つ選ぶ
+///@param[in] random 乱数生成器
+///@param[in] base 元のパラメータ（探索しない項目はこの値のまま）
+///@param[in] scale 探索範囲の広さ（1で全範囲，小さくするとbaseの近く）
+///@return 候補
+///
+///- 運動状態の判断に関する項目は，ログだけでは評価できないので探索しない．
+///
+EstimatorParameter sample(mt19937 &random, const EstimatorParameter &base, double scale)
+{
+  uniform_real_distribution<double> u(-1, 1);
+  auto pick = [&](double x, double lo, double hi) {
+    double r = x + scale*(hi-lo)*u(random);
+    return std::min(std::max(r, lo), hi);
+  };
+  auto pickInt = [&](int x, int lo, int hi) {
+    return (int)floor(pick(x+0.5, lo, hi+0.999));
+  };
+  EstimatorParameter p = base;
+  p.ballWindow = pick(base.ballWindow, 0.3, 2.0);
+  p.ballMinSamples = pickInt(base.ballMinSamples, 2, 8);
+  p.ballVelocityFloor = pick(base.ballVelocityFloor, 0, 50);
+  p.ballErrorDistance = pick(base.ballErrorDistance, 30, 300);
+  p.ballErrorLimit = pickInt(base.ballErrorLimit, 1, 4);
+  p.ballFitIteration = pickInt(base.ballFitIteration, 0, 5);
+  p.ballHuberDistance = pick(base.ballHuberDistance, 5, 60);
+  p.ballRejectDistance = std::max(pick(base.ballRejectDistance, 40, 300), p.ballHuberDistance);
+  p.kickResidual = pick(base.kickResidual, 10, 100);
+  p.kickSpeed = pick(base.kickSpeed, 100, 1000);
+  p.robotHoldTime = pick(base.robotHoldTime, 0.2, 3.0);
+  p.robotJumpDistance = pick(base.robotJumpDistance, 80, 600);
+  return p;
+}
+
+///
+///@brief 候補を全コアで並列に評価する
+///@param[in] params 候補の並び
+///@param[in] logs ログの並び
+///@param[out] costs 各候補の評価値
+///@return なし
+///
+void evaluateAll(const vector<EstimatorParameter> &params, const vector<vector<LogFrame>> &logs,
+                 vector<double> &costs)
+{
+  costs.assign(params.size(), 0);
+  atomic<size_t> next(0);
+  unsigned n = std::max(1u, thread::hardware_concurrency());
+  vector<thread> workers;
+  for (unsigned w=0; w<n; w++) {
+    workers.push_back(thread([&]() {
+      size_t i;
+      while ((i = next++) < params.size()) {
+        double b, r;
+        costs[i] = evaluate(params[i], logs, b, r);
+      }
+    }));
+  }
+  for (size_t w=0; w<workers.size(); w++) {
+    workers[w].join();
+  }
+}
+
+///estimator-tunerメイン関数
+int main(int argc, char* argv[])
+{
+  int trials = 1000;
+  unsigned seed = 1;
+  vector<string> fileNames;
+  for (int i=1; i<argc; i++) {
+    string a = argv[i];
+    if (a == "-n" && i+1 < argc) {
+      trials = atoi(argv[++i]);
+    } else if (a == "-s" && i+1 < argc) {
+      seed = atoi(argv[++i]);
+    } else {
+      fileNames.push_back(a);
+    }
+  }
+  if (fileNames.empty() || trials <= 0) {
+    cerr << "使い方: estimator-tuner [-n 試行回数] [-s 乱数の種] ログファイル..." << endl;
+    return 1;
+  }
+
+  vector<vector<LogFrame>> logs(fileNames.size());
+  size_t total = 0;
+  for (size_t i=0; i<fileNames.size(); i++) {
+    if (readLog(fileNames[i], logs[i])) {
+      return 1;
+    }
+    total += logs[i].size();
+  }
+  cout << "ログ: " << logs.size() << "ファイル，" << total << "フレーム" << endl;
+  cout << "並列数: " << std::max(1u, thread::hardware_concurrency()) << endl;
+
+  EstimatorParameter best;
+  double ballError, robotError;
+  double bestCost = evaluate(best, logs, ballError, robotError);
+  cout << "規定値: " << bestCost << " (ボール " << ballError << " mm, ロボット " << robotError << " mm)" << endl;
+
+  //全範囲の乱択の後，最良の候補の近くを狭めながら探索する
+  mt19937 random(seed);
+  const double scales[] = {1.0, 0.2, 0.05};
+  for (int stage=0; stage<3; stage++) {
+    int n = (stage == 0) ? trials : trials/4;
+    vector<EstimatorParameter> params;
+    for (int i=0; i<n; i++) {
+      params.push_back(sample(random, best, scales[stage]));
+    }
+    vector<double> costs;
+    evaluateAll(params, logs, costs);
+    for (size_t i=0; i<costs.size(); i++) {
+      if (costs[i] < bestCost) {
+        bestCost = costs[i];
+        best = params[i];
+      }
+    }
+    cout << "段階" << stage+1 << ": " << bestCost << endl;
+  }
+  bestCost = evaluate(best, logs, ballError, robotError);
+  cout << "最良: " << bestCost << " (ボール " << ballError << " mm, ロボット " << robotError << " mm)" << endl;
+  cout << endl << "# 以下を設定ファイルの最後に貼り付ける" << endl;
+  best.print(cout);
+  return 0;
+}
@@ -0,0 +1,285 @@
+﻿///
+///@file game-table-test.cpp
+///@brief Gameクラスの遷移表のテストプログラム
+///@par Copyright
+/// Copyright (C) 2026 Team ODENS, Masutani Lab, Osaka Electro-Communication University
+///@par 履歴
+///- 2026/10/18 升谷 保博 新規作成（Gameの遷移表のテスト）
+///
+#include <iostream>
+#include "sr.h"
+#include "referee.h"
+#include "game.h"
+
+using namespace std;
+using namespace odens;
+
+///
+///@brief 遷移表に置き換える前のGame::decideMode()のswitch文による遷移（比較の基準）
+///@param[in] c レフェリーボックスのコマンド
+///@param[in] color 自チームの色
+///@param[in] prev 前回のプレーの種類
+///@param[in,out] kickType 記憶しているキックの種類
+///@return ゲームモード
+///
+GameMode referenceMode(int c, int color, PlayType prev, KickType &kickType)
+{
+  GameMode mode;
+  switch (c) {
+  case ref::HALT:
+    mode.play = Halt;
+    mode.kick = KickTypeNone;
+    break;
+  case ref::NORMAL_START:
+    mode.play = (prev == InPlay) ? InPlay : SetPlay;
+    mode.kick = kickType;
+    break;
+  case ref::FORCE_START:
+    mode.play = InPlay;
+    mode.kick = KickTypeNone;
+    break;
+  case ref::PREPARE_KICKOFF_YELLOW:
+  case ref::PREPARE_KICKOFF_BLUE:
+    mode.play = PreSetPlay;
+    kickType = (color == (c == ref::PREPARE_KICKOFF_YELLOW ? YELLOW : BLUE)) ? OurKickOff : TheirKickOff;
+    mode.kick = kickType;
+    break;
+  case ref::PREPARE_PENALTY_YELLOW:
+  case ref::PREPARE_PENALTY_BLUE:
+    mode.play = PreSetPlay;
+    kickType = (color == (c == ref::PREPARE_PENALTY_YELLOW ? YELLOW : BLUE)) ? OurPenaltyKick : TheirPenaltyKick;
+    mode.kick = kickType;
+    break;
+  case ref::DIRECT_FREE_YELLOW:
+  case ref::DIRECT_FREE_BLUE:
+    if (prev == InPlay) {
+      mode.play = InPlay;
+    } else {
+      mode.play = SetPlay;
+      kickType = (color == (c == ref::DIRECT_FREE_YELLOW ? YELLOW : BLUE)) ? OurDirectFreeKick : TheirDirectFreeKick;
+    }
+    mode.kick = kickType;
+    break;
+  case ref::INDIRECT_FREE_YELLOW:
+  case ref::INDIRECT_FREE_BLUE:
+    if (prev == InPlay) {
+      mode.play = InPlay;
+    } else {
+      mode.play = SetPlay;
+      kickType = (color == (c == ref::INDIRECT_FREE_YELLOW ? YELLOW : BLUE)) ? OurIndirectFreeKick : TheirIndirectFreeKick;
+    }
+    mode.kick = kickType;
+    break;
+  case ref::TIMEOUT_YELLOW:
+  case ref::TIMEOUT_BLUE:
+  case ref::GOAL_YELLOW:
+  case ref::GOAL_BLUE:
+    mode.play = prev;
+    mode.kick = KickTypeNone;
+    break;
+  case ref::BALL_PLACEMENT_YELLOW:
+  case ref::BALL_PLACEMENT_BLUE:
+    mode.play = BallPlacement;
+    mode.kick = (color == (c == ref::BALL_PLACEMENT_YELLOW ? YELLOW : BLUE)) ? OurBallPlacement : TheirBallPlacement;
+    break;
+  default: //STOPと知らないコマンド
+    mode.play = OutOfPlay;
+    mode.kick = KickTypeNone;
+    break;
+  }
+  return mode;
+}
+
+///
+///@brief コマンドの列を実際のGameと基準の遷移に順に与えて，結果を比べる
+///@param[in] color 自チームの色
+///@param[in] commands コマンドの列（最後が調べるコマンドで，それより前は状態を作るためのもの）
+///@param[in] n コマンドの数
+///@return 不一致の数
+///
+///- 前回のプレーの種類と記憶しているキックの種類は，コマンドを与えてGameの中に作る．
+///
+int compareSequence(int color, const int commands[], int n)
+{
+  int errors = 0;
+  Game game(color);
+  RefereeInfo rinfo;
+  const Orthogonal ball0(0, 0, 0);
+  PlayType prev = PlayTypeNone;
+  KickType kickType = KickTypeNone;
+  for (int i=0; i<n; i++) {
+    GameMode m1 = referenceMode(commands[i], color, prev, kickType);
+    rinfo.command = static_cast<ref::Command>(commands[i]);
+    GameMode m2 = game.decideMode(rinfo, ball0, 0.1*i);
+    if (m1.play != m2.play || m1.kick != m2.kick) {
+      cout << "NG: color=" << color << " command=";
+      for (int j=0; j<=i; j++) {
+        cout << commands[j] << (j < i ? "," : "");
+      }
+      cout << " 期待 " << m1.getString() << " 結果 " << m2.getString() << endl;
+      errors++;
+    }
+    prev = m1.play;
+  }
+  return errors;
+}
+
+///
+///@brief セットプレーの終了条件を確かめる
+///@return 不一致の数
+///
+int testSetPlayExit()
+{
+  int errors = 0;
+  RefereeInfo rinfo;
+  const Orthogonal ball0(0, 0, 0);
+
+  //相手のフリーキック：設定した距離を超えて動いたらInPlay
+  Game game(YELLOW);
+  game.setSetPlayTimeout(5);
+  game.setBallMovedDistance(50);
+  rinfo.command = ref::STOP;
+  game.decideMode(rinfo, ball0, 0.0);
+  rinfo.command = ref::DIRECT_FREE_BLUE;
+  if (game.decideMode(rinfo, ball0, 0.1).play != SetPlay) errors++;
+  if (game.decideMode(rinfo, Orthogonal(40, 0, 0), 0.2).play != SetPlay) errors++;
+  if (game.decideMode(rinfo, Orthogonal(60, 0, 0), 0.3).play != InPlay) errors++;
+
+  //自チームのフリーキック：ボールが動いても設定した時間まではSetPlay
+  Game game2(BLUE);
+  game2.setSetPlayTimeout(5);
+  game2.setBallMovedDistance(50);
+  rinfo.command = ref::STOP;
+  game2.decideMode(rinfo, ball0, 0.0);
+  rinfo.command = ref::DIRECT_FREE_BLUE;
+  if (game2.decideMode(rinfo, ball0, 0.1).play != SetPlay) errors++;
+  if (game2.decideMode(rinfo, Orthogonal(500, 0, 0), 5.0).play != SetPlay) errors++;
+  if (game2.decideMode(rinfo, Orthogonal(500, 0, 0), 5.2).play != InPlay) errors++;
+
+  //相手のフリーキック：セットプレー開始後のキックならすぐにInPlay，開始前のキックは無視する
+  Game game3(YELLOW);
+  game3.setSetPlayTimeout(5);
+  game3.setBallMovedDistance(50);
+  rinfo.command = ref::STOP;
+  game3.decideMode(rinfo, ball0, BallKicked, 0.05, 0.1);
+  rinfo.command = ref::DIRECT_FREE_BLUE;
+  if (game3.decideMode(rinfo, ball0, BallKicked, 0.05, 0.2).play != SetPlay) errors++;
+  if (game3.decideMode(rinfo, ball0, BallKicked, 0.05, 0.3).play != SetPlay) errors++;
+  if (game3.decideMode(rinfo, ball0, BallKicked, 0.35, 0.4).play != InPlay) errors++;
+
+  //イベントで処理したコマンドのまま，update()でセットプレーの終了を判断する
+  Game game4(YELLOW);
+  game4.setSetPlayTimeout(5);
+  game4.setBallMovedDistance(50);
+  RefereeEvent event = RefereeEvent();
+  event.command = ref::STOP;
+  event.commandCounter = 1;
+  game4.consume(event, ball0, BallMotionNone, 0, 0.0);
+  event.command = ref::DIRECT_FREE_BLUE;
+  event.commandCounter = 2;
+  if (game4.consume(event, ball0, BallMotionNone, 0, 0.1).play != SetPlay) errors++;
+  if (game4.getCommand() != ref::DIRECT_FREE_BLUE) errors++;
+  if (game4.update(Orthogonal(40, 0, 0), BallMotionNone, 0, 0.2).play != SetPlay) errors++;
+  if (game4.update(Orthogonal(60, 0, 0), BallMotionNone, 0, 0.3).play != InPlay) errors++;
+  //処理済みのカウンタのイベントは無視する
+  if (game4.consume(event, ball0, BallMotionNone, 0, 0.4).play != InPlay) errors++;
+
+  //レフェリーが途絶えている間はOutOfPlayにし，戻ったら途絶える前のInPlayから続ける
+  Game game5(YELLOW);
+  game5.setBallMovedDistance(50);
+  const ref::Command kickoff[] = {ref::STOP, ref::PREPARE_KICKOFF_BLUE, ref::NORMAL_START};
+  for (int i = 0; i < 3; i++) {
+    event.command = kickoff[i];
+    event.commandCounter = 10+i;
+    game5.consume(event, ball0, BallMotionNone, 0, 0.1*i);
+  }
+  if (game5.update(Orthogonal(60, 0, 0), BallMotionNone, 0, 0.3).play != InPlay) errors++;
+  size_t transitions = game5.getTimeline().size();
+  rinfo.command = ref::NORMAL_START;
+  if (game5.decideSafeMode(rinfo, ball0, 0.4).play != OutOfPlay) errors++;
+  if (rinfo.command != ref::STOP) errors++;
+  if (game5.update(Orthogonal(60, 0, 0), BallMotionNone, 0, 0.5).play != InPlay) errors++;
+  if (game5.getCommand() != ref::NORMAL_START) errors++;
+  if (game5.getTimeline().size() != transitions) errors++;
+
+  if (errors > 0) {
+    cout << "NG: セットプレーの終了条件" << endl;
+  }
+  return errors;
+}
+
+///
+///@brief ゲームモードの遷移の記録を確かめる
+///@return 不一致の数
+///
+int testTimeline()
+{
+  int errors = 0;
+  RefereeInfo rinfo;
+  const Orthogonal ball0(100, 200, 0);
+  Game game(BLUE);
+  const ref::Command commands[] = {ref::HALT, ref::HALT, ref::STOP, ref::PREPARE_KICKOFF_BLUE,
+    ref::NORMAL_START, ref::NORMAL_START, ref::STOP};
+  const int n = sizeof(commands)/sizeof(commands[0]);
+  for (int i=0; i<n; i++) {
+    rinfo.command = commands[i];
+    game.decideMode(rinfo, ball0, 1.0*i);
+  }
+  //同じモードが続いた分（HALTとNORMAL_STARTの2回目）は記録されない
+  const vector<GameModeTransition> &timeline = game.getTimeline();
+  if (timeline.size() != 5) errors++;
+  if (timeline.size() > 2 && (timeline[2].command != ref::PREPARE_KICKOFF_BLUE
+    || timeline[2].play != PreSetPlay || timeline[2].kick != OurKickOff
+    || timeline[2].time != 3.0 || timeline[2].ballX != 100 || timeline[2].ballY != 200)) errors++;
+  vector<GameModeTransition> out;
+  if (game.getTimeline(2.0, 4.0, out) != 3 || out.front().time != 2.0) errors++;
+  if (game.getTimeline(4.5, 5.5, out) != 0) errors++;
+  GameModeTransition tr;
+  if (game.getModeAt(5.5, tr) || tr.play != SetPlay) errors++;
+  if (!game.getModeAt(-1.0, tr)) errors++;
+
+  if (errors > 0) {
+    cout << "NG: ゲームモードの遷移の記録" << endl;
+  }
+  return errors;
+}
+
+///game-table-testメイン関数
+int main()
+{
+  //記憶しているキックの種類を作るコマンド（-1は何も与えない）
+  const int kickCommands[] = {-1, ref::PREPARE_KICKOFF_YELLOW, ref::PREPARE_KICKOFF_BLUE,
+    ref::PREPARE_PENALTY_YELLOW, ref::PREPARE_PENALTY_BLUE, ref::DIRECT_FREE_YELLOW, ref::DIRECT_FREE_BLUE,
+    ref::INDIRECT_FREE_YELLOW, ref::INDIRECT_FREE_BLUE};
+  //前回のプレーの種類を作るコマンド（-1は何も与えない）
+  const int playCommands[] = {-1, ref::HALT, ref::STOP, ref::FORCE_START, ref::NORMAL_START,
+    ref::BALL_PLACEMENT_YELLOW, ref::BALL_PLACEMENT_BLUE};
+  const int nk = sizeof(kickCommands)/sizeof(kickCommands[0]);
+  const int np = sizeof(playCommands)/sizeof(playCommands[0]);
+  int errors = 0;
+  int cases = 0;
+  //全てのコマンド（範囲外の値を含む），色，前回のプレー，記憶しているキックの組み合わせ
+  for (int c=-1; c<=ref::CommandNOI; c++) {
+    for (int color=BLUE; color<=YELLOW; color++) {
+      for (int k=0; k<nk; k++) {
+        for (int p=0; p<np; p++) {
+          int commands[3];
+          int n = 0;
+          if (kickCommands[k] >= 0) commands[n++] = kickCommands[k];
+          if (playCommands[p] >= 0) commands[n++] = playCommands[p];
+          commands[n++] = c;
+          errors += compareSequence(color, commands, n);
+          cases++;
+        }
+      }
+    }
+  }
+  errors += testSetPlayExit();
+  errors += testTimeline();
+  if (errors > 0) {
+    cout << "NG: " << errors << "件の不一致" << endl;
+    return 1;
+  }
+  cout << "OK: " << cases << "通りの遷移が一致した" << endl;
+  return 0;
+}
@@ -38,6 +38,8 @@ int main(int argc, char* argv[])
   }
 
   Game game(Config::MyColor);
+  game.setSetPlayTimeout(Config::SetPlayTimeout);
+  game.setBallMovedDistance(Config::BallMovedDistance);
 
   cout << "メインループ開始" << endl;
   while (true) {
@@ -14,6 +14,7 @@
 #pragma once
 #include <string>
 #include "sr.h"
+#include "estimator.h"
 
 namespace odens {
 
@@ -28,16 +29,24 @@ public:
   static bool Pause; ///<一時停止で開始
   static bool Goalie; ///<ゴールキーパーか？
   static std::string RobotPortName; ///<シリアルポートの名前
+  static bool RobotReceive; ///<ロボットからの応答を受信するか？
+  static bool ParametricMotion; ///<移動に連続値の移動指令を使うか？
+  static bool MotionScheduler;  ///<コマンドの切り替えを動作の区切りまで保留するか？
   static std::string VisionAddress; ///<ビジョンのマルチキャストアドレス
   static int VisionPortNumber; ///<ビジョンのポート番号
   static bool Referee; ///<レフェリーを使う
   static std::string RefereeAddress; ///<レフェリーのマルチキャストアドレス
   static int RefereePortNumber; ///<レフェリーのポート番号
+  static double RefereeTimeout; ///<レフェリーの受信が途絶えたとみなす時間 [s]
+  static double SetPlayTimeout; ///<セットプレーを打ち切ってInPlayにする時間 [s]
+  static double BallMovedDistance; ///<相手のセットプレーでボールが動いたとみなす距離 [mm]
+  static double InterceptWalkSpeed; ///<転がるボールの迎撃点を求めるときのロボットの歩く速さ [mm/s]（0なら迎撃点を使わない）
   static int Quadrant; ///<SSL-Visionの象限(0..3: 第1..4象限）
   static bool AttackRight; ///<SSL-Visionの右側へ攻める
   static int OurMarkerTable[MAX_ROBOT_NUM+1]; ///<自チームロボットのマーカ番号
   static int TheirMarkerTable[MAX_ROBOT_NUM+1]; ///<相手チームロボットのマーカ番号
   static bool Logger; ///<ログを取るか？
+  static EstimatorParameter EstimatorParam; ///<位置推定の調整用パラメータ（設定ファイルの[Estimator]の節）
   static bool setup(int argc, char* argv[]);
   static void print();
 };
@@ -88,9 +88,10 @@ private:
 
   void drawField();
   void drawBall(Orthogonal p);
-  void drawBall(Orthogonal p, Orthogonal p2);
+  void drawBall(Orthogonal p, Orthogonal p2, const Uncertainty &u2);
   void drawRobot(int color, int num, Orthogonal p, bool number);
-  void drawRobot(int color, int num, Orthogonal p, bool number, Orthogonal p2, bool number2);
+  void drawRobot(int color, int num, Orthogonal p, bool number, Orthogonal p2, bool number2, const Uncertainty &u2);
+  void drawUncertainty(Orthogonal p, const Uncertainty &u);
   void drawFieldLine(Orthogonal p, Orthogonal q);
   void main();
   inline unsigned char changeColor(int color);
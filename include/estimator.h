@@ -13,6 +13,9 @@
 
 #pragma once
 #include <deque>
+#include <vector>
+#include <memory>
+#include <iostream>
 #include "sr.h"
 
 namespace odens {
@@ -61,6 +64,74 @@ struct Timed2D {
   }
 };
 
+///
+///@brief ボールの運動の状態を表す列挙型
+///
+enum BallMotion {
+  BallMotionNone = 0, ///<不明（見えていない）
+  BallStopped,        ///<静止
+  BallRolling,        ///<転がっている
+  BallKicked,         ///<蹴られた直後
+  BallHeld,           ///<ロボットのすぐそばにある（保持されている）
+  BallMotionNOI       ///<項目数
+};
+
+#define ROBOT_SLOT_NUM (2*(MAX_ROBOT_NUM+1)) ///< 両チームのロボットの要素数（0番要素を含む）
+
+///
+///@brief 両チームの全ロボットの状態を成分ごとの配列で保持する構造体（SoA）
+///
+///- 添字は color*(MAX_ROBOT_NUM+1)+number で，srInfo::robot を1次元に並べた順と同じ．
+///- 0番要素も計算の対象に含めて，ロボットごとの分岐をなくしている．
+///- 番号が得られているかどうかも，マスク演算しやすいようにdoubleの0/1で保持する．
+///
+struct RobotStateArray {
+  double x[ROBOT_SLOT_NUM];     ///<x座標 [mm]
+  double y[ROBOT_SLOT_NUM];     ///<y座標 [mm]
+  double theta[ROBOT_SLOT_NUM]; ///<方向 [rad]
+  double id[ROBOT_SLOT_NUM];    ///<番号が得られているか？（1:真，0:偽）
+  double time[ROBOT_SLOT_NUM];  ///<時刻 [s]
+};
+
+///
+///@brief Estimatorの調整用パラメータを保持する構造体
+///
+///- 規定値はコンストラクタで設定する．設定ファイルの[Estimator]の節で変更できる．
+///- estimator-tunerで記録したログから調整できる．
+///
+struct EstimatorParameter {
+  double ballWindow;         ///<ボールのデータを保持する時間 [s]
+  int ballMinSamples;        ///<直線を当てはめるのに必要なデータの数
+  double ballVelocityFloor;  ///<これより遅い速度は0とみなす [mm/s]
+  double ballErrorDistance;  ///<推定値との隔たりが大きいとみなす距離 [mm]
+  int ballErrorLimit;        ///<隔たりがこの回数を超えて続いたらボールが動いたとみなす
+  int ballFitIteration;      ///<ボールの当てはめで重みを計算し直す回数の上限
+  double ballHuberDistance;  ///<ボールの当てはめで重みを下げ始める残差 [mm]
+  double ballRejectDistance; ///<ボールの当てはめで除外する残差 [mm]
+  double ballHoldTime;       ///<見えなくなったボールを保持する時間（速度推定なしの場合） [s]
+  double ballFilterDelay;    ///<見えなくなってからパーティクルフィルタに切り替えるまでの時間 [s]
+  bool ballParticleFilter;   ///<隠れている間にパーティクルフィルタを使うか？
+  double kickResidual;       ///<蹴られたとみなす予測からの残差 [mm]
+  double kickSpeed;          ///<蹴られたとみなす速さの下限 [mm/s]
+  double maxBallSpeed;       ///<ボールの速さの上限（これを超えたら誤検出） [mm/s]
+  double rollingSpeed;       ///<転がっているとみなす速さ [mm/s]
+  double kickDuration;       ///<蹴られた状態を続ける時間 [s]
+  double heldDistance;       ///<ロボットが保持しているとみなす距離 [mm]
+  double robotHoldTime;      ///<見えなくなったロボットを保持する時間 [s]
+  double robotJumpDistance;  ///<番号付きのロボットが1フレームで動ける距離 [mm]
+  double ballPositionNoise; ///<ボールの観測の誤差の標準偏差 [mm]
+  double ballDriftSpeed;    ///<見えていないボールの位置の誤差が増える速さ [mm/s]
+  double robotPositionNoise;///<ロボットの観測の誤差の標準偏差 [mm]
+  double robotDriftSpeed;   ///<見えていないロボットの位置の誤差が増える速さ [mm/s]
+  double confidenceDistance;///<信頼度が0.5になる位置の標準偏差 [mm]
+
+  EstimatorParameter();
+  void print(std::ostream &os) const;
+  bool check() const;
+};
+
+class BallParticleFilter;
+
 ///
 ///@brief Orthogonal用位置推定クラス
 ///
@@ -68,19 +139,59 @@ class Estimator {
 private:
   Orthogonal ball;                      ///<記憶するボール位置
   double ballTime;                      ///<ボール位置を記憶した時刻
-  Orthogonal robot[2][MAX_ROBOT_NUM+1]; ///<記憶する各ロボット位置
-  bool id[2][MAX_ROBOT_NUM+1];          ///<記憶する各ロボットの番号が得られているか？
-  double robotTime[2][MAX_ROBOT_NUM+1]; ///<各ロボット位置を記憶した時刻
+  RobotStateArray robotState[2];        ///<記憶する各ロボットの状態（現在と次の二重バッファ）
+  int robotStateIndex;                  ///<robotStateのどちらが現在の状態か
+  RobotStateArray robotObs;             ///<現在の各ロボットの観測（作業領域）
+  RobotStateArray robotOut;             ///<各ロボットの推定結果（作業領域）
   std::deque<Timed2D> ballDeque;             ///<過去のボールデータを保持する両端キュー
+  std::vector<double> ballWeight;       ///<ballDequeの各データの重み（作業領域）
+  std::vector<double> ballWeightPrev;   ///<計算し直す前のballWeight（作業領域）
+  EstimatorParameter param;             ///<調整用パラメータ
+  Timed2D prevBall;                     ///<前回のボールの推定位置
+  Timed2D prevBallVel;                  ///<前回のボールの推定速度
+  int ballOutlierRun;                   ///<予測から外れたボールのデータが連続した回数
+  int ballErrorCount;                   ///<推定値との隔たりが連続して大きい回数
+  BallMotion ballMotion;                ///<ボールの運動の状態
+  double ballKickTime;                  ///<ボールが蹴られたと判断した時刻
+  std::unique_ptr<BallParticleFilter> ballFilter; ///<隠れている間のボールの推定（使わない場合はnullptr）
+
+  void updateRobots(srInfo &sinfo2, const srInfo &sinfo, double ctime);
+  bool fitBall(Timed2D &ball2, Timed2D &ballVel, Uncertainty &u, double ctime);
+  bool detectKick(const Timed2D &ball, double ctime);
+  BallMotion classifyBall(const Timed2D &ball2, const Timed2D &ballVel, bool kicked, double ctime);
+  bool updateBallFilter(Timed2D &ball2, Timed2D &ballVel, const srInfo &sinfo2, const srInfo &sinfo, double ctime, double fitTime);
+  void filterUncertainty(Uncertainty &u, double ctime);
 public:
   void clear();
-  //コンストラクタ
-  Estimator()
+  Estimator();
+  ~Estimator();
+  bool setBallFit(int iteration, double huberDistance, double rejectDistance);
+  void setBallParticleFilter(bool use);
+  bool setParameter(const EstimatorParameter &p);
+  ///
+  ///@brief 調整用パラメータを返す
+  ///
+  const EstimatorParameter &getParameter() const
   {
-    clear();
+    return param;
   }
   void update(srInfo &sinfo2, const srInfo &sinfo, double ctime);
   void update(srInfo &sinfo2, Timed2D &ballVel, const srInfo &sinfo, double ctime);
+  void update(srInfo &sinfo2, Timed2D &ballVel, BallMotion &motion, const srInfo &sinfo, double ctime);
+  ///
+  ///@brief ボールの運動の状態を返す
+  ///
+  BallMotion getBallMotion() const
+  {
+    return ballMotion;
+  }
+  ///
+  ///@brief ボールが最後に蹴られたと判断した時刻を返す（判断していなければ0）
+  ///
+  double getBallKickTime() const
+  {
+    return ballKickTime;
+  }
 };
 
 } //namespace odens
@@ -15,8 +15,10 @@
 ///
 
 #pragma once
+#include <vector>
 #include "sr.h"
 #include "referee.h"
+#include "estimator.h"
 
 namespace odens {
 
@@ -30,6 +32,7 @@ enum PlayType {
   InPlay,           ///<通常のプレー
   SetPlay,          ///<セットプレー
   PreSetPlay,       ///<セットプレーの準備
+  BallPlacement,    ///<ボールプレースメント（ボールに近付かない）
   PlayTypeNOI       ///<項目数
 };
 
@@ -46,9 +49,128 @@ enum KickType {
   TheirPenaltyKick,     ///<相手チームのペナルティキック
   TheirDirectFreeKick,  ///<相手チームの直接フリーキック
   TheirIndirectFreeKick,///<相手チームの関節フリーキック
+  OurBallPlacement,     ///<自チームのボールプレースメント
+  TheirBallPlacement,   ///<相手チームのボールプレースメント
   KickTypeNOI           ///<項目数
 };
 
+///
+///@brief 遷移でのキックの種類の扱いを表す列挙型
+///
+enum KickRule {
+  KickOutput = 0, ///<表のキックの種類をそのまま出力する（記憶しない）
+  KickRecall,     ///<記憶しているキックの種類を出力する
+  KickStore,      ///<表のキックの種類を記憶して出力する
+  KickRuleNOI     ///<項目数
+};
+
+///
+///@brief 1つのコマンドの（前回のプレーの種類で場合分けした）遷移先を表す構造体
+///
+struct GameRule {
+  PlayType play;       ///<プレーの種類（PlayTypeNoneなら前回のまま）
+  KickType kickBlue;   ///<自チームが青のときのキックの種類
+  KickType kickYellow; ///<自チームが黄のときのキックの種類
+  KickRule rule;       ///<キックの種類の扱い
+};
+
+///
+///@brief 遷移表の1行（1つのコマンド）を表す構造体
+///
+struct GameRuleRow {
+  ref::Command command; ///<対応するコマンド（表の並びの検査用）
+  GameRule other;       ///<前回のプレーがInPlay以外のときの遷移先
+  GameRule inPlay;      ///<前回のプレーがInPlayのときの遷移先
+};
+
+///
+///@brief (コマンド，自チームの色，前回のプレーの種類)から決まる遷移先を表す構造体
+///
+struct GameTransition {
+  PlayType play; ///<プレーの種類
+  KickType kick; ///<キックの種類（ruleがKickRecallなら使わない）
+  KickRule rule; ///<キックの種類の扱い
+};
+
+///
+///@brief コマンドによるゲームモードの遷移表
+///
+///- ref::Commandの順に1行ずつ並べる．コマンドを追加したら行を追加する
+///  （行の数と並びはstatic_assertで検査している）．
+///- セットプレーの終了（時間切れ，ボールが動いた）はこの表ではなく，Game::decideMode()で扱う．
+///
+constexpr GameRuleRow gameRuleTable[] = {
+  //コマンド                    前回がInPlay以外                                                    前回がInPlay
+  {ref::HALT,                   {Halt, KickTypeNone, KickTypeNone, KickOutput},                      {Halt, KickTypeNone, KickTypeNone, KickOutput}},
+  {ref::STOP,                   {OutOfPlay, KickTypeNone, KickTypeNone, KickOutput},                 {OutOfPlay, KickTypeNone, KickTypeNone, KickOutput}},
+  {ref::NORMAL_START,           {SetPlay, KickTypeNone, KickTypeNone, KickRecall},                   {InPlay, KickTypeNone, KickTypeNone, KickRecall}},
+  {ref::FORCE_START,            {InPlay, KickTypeNone, KickTypeNone, KickOutput},                    {InPlay, KickTypeNone, KickTypeNone, KickOutput}},
+  {ref::PREPARE_KICKOFF_YELLOW, {PreSetPlay, TheirKickOff, OurKickOff, KickStore},                   {PreSetPlay, TheirKickOff, OurKickOff, KickStore}},
+  {ref::PREPARE_KICKOFF_BLUE,   {PreSetPlay, OurKickOff, TheirKickOff, KickStore},                   {PreSetPlay, OurKickOff, TheirKickOff, KickStore}},
+  {ref::PREPARE_PENALTY_YELLOW, {PreSetPlay, TheirPenaltyKick, OurPenaltyKick, KickStore},           {PreSetPlay, TheirPenaltyKick, OurPenaltyKick, KickStore}},
+  {ref::PREPARE_PENALTY_BLUE,   {PreSetPlay, OurPenaltyKick, TheirPenaltyKick, KickStore},           {PreSetPlay, OurPenaltyKick, TheirPenaltyKick, KickStore}},
+  {ref::DIRECT_FREE_YELLOW,     {SetPlay, TheirDirectFreeKick, OurDirectFreeKick, KickStore},        {InPlay, KickTypeNone, KickTypeNone, KickRecall}},
+  {ref::DIRECT_FREE_BLUE,       {SetPlay, OurDirectFreeKick, TheirDirectFreeKick, KickStore},        {InPlay, KickTypeNone, KickTypeNone, KickRecall}},
+  {ref::INDIRECT_FREE_YELLOW,   {SetPlay, TheirIndirectFreeKick, OurIndirectFreeKick, KickStore},    {InPlay, KickTypeNone, KickTypeNone, KickRecall}},
+  {ref::INDIRECT_FREE_BLUE,     {SetPlay, OurIndirectFreeKick, TheirIndirectFreeKick, KickStore},    {InPlay, KickTypeNone, KickTypeNone, KickRecall}},
+  {ref::TIMEOUT_YELLOW,         {PlayTypeNone, KickTypeNone, KickTypeNone, KickOutput},              {PlayTypeNone, KickTypeNone, KickTypeNone, KickOutput}},
+  {ref::TIMEOUT_BLUE,           {PlayTypeNone, KickTypeNone, KickTypeNone, KickOutput},              {PlayTypeNone, KickTypeNone, KickTypeNone, KickOutput}},
+  {ref::GOAL_YELLOW,            {PlayTypeNone, KickTypeNone, KickTypeNone, KickOutput},              {PlayTypeNone, KickTypeNone, KickTypeNone, KickOutput}},
+  {ref::GOAL_BLUE,              {PlayTypeNone, KickTypeNone, KickTypeNone, KickOutput},              {PlayTypeNone, KickTypeNone, KickTypeNone, KickOutput}},
+  {ref::BALL_PLACEMENT_YELLOW,  {BallPlacement, TheirBallPlacement, OurBallPlacement, KickOutput},   {BallPlacement, TheirBallPlacement, OurBallPlacement, KickOutput}},
+  {ref::BALL_PLACEMENT_BLUE,    {BallPlacement, OurBallPlacement, TheirBallPlacement, KickOutput},   {BallPlacement, OurBallPlacement, TheirBallPlacement, KickOutput}},
+};
+
+///
+///@brief 遷移表の行がref::Commandの順に並んでいるか？（コンパイル時の検査用）
+///@param[in] i 調べ始める行
+///
+constexpr bool isGameRuleTableOrdered(int i = 0)
+{
+  return i >= ref::CommandNOI || (gameRuleTable[i].command == i && isGameRuleTableOrdered(i+1));
+}
+
+static_assert(sizeof(gameRuleTable)/sizeof(gameRuleTable[0]) == ref::CommandNOI, "gameRuleTableの行数がref::CommandNOIと一致しない");
+static_assert(isGameRuleTableOrdered(), "gameRuleTableの行がref::Commandの順に並んでいない");
+
+///
+///@brief 遷移表の要素から遷移先を作る（gameTransition()の下請け）
+///
+constexpr GameTransition resolveGameRule(const GameRule &r, int color, PlayType prev)
+{
+  return GameTransition{r.play == PlayTypeNone ? prev : r.play, color == BLUE ? r.kickBlue : r.kickYellow, r.rule};
+}
+
+///
+///@brief 遷移表を引く
+///@param[in] c レフェリーボックスのコマンド
+///@param[in] color 自チームの色
+///@param[in] prev 前回のプレーの種類
+///@return 遷移先（表にないコマンドはSTOPと同じ）
+///
+constexpr GameTransition gameTransition(int c, int color, PlayType prev)
+{
+  return (c < 0 || c >= ref::CommandNOI)
+    ? GameTransition{OutOfPlay, KickTypeNone, KickOutput}
+    : resolveGameRule(prev == InPlay ? gameRuleTable[c].inPlay : gameRuleTable[c].other, color, prev);
+}
+
+#define GAME_TIMELINE_RESERVE (1024) ///<ゲームモードの遷移の記録のために予め確保する要素数
+
+///
+///@brief ゲームモードの遷移1回分の記録
+///
+///- 1試合で数百個程度なので，全てメモリに保持する．ボールの位置はfloatで小さくしている．
+///
+struct GameModeTransition {
+  double time;          ///<遷移した時刻 [s]
+  ref::Command command; ///<遷移のきっかけになったコマンド
+  PlayType play;        ///<遷移後のプレーの種類
+  KickType kick;        ///<遷移後のキックの種類
+  float ballX;          ///<遷移したときのボールのx座標 [mm]（見えていなければINVISIBLE）
+  float ballY;          ///<遷移したときのボールのy座標 [mm]（見えていなければINVISIBLE）
+};
+
 class Game;
 
 ///
@@ -95,9 +217,41 @@ private:
   KickType m_kickType;      ///<現在のキックの種類
   Orthogonal m_setPlayBall; ///<セットプレー開始時のボールの位置
   double m_setPlayTime;     ///<セットプレー開始時刻
+  uint32_t m_commandCounter;///<最後に処理したコマンドの変化のカウンタ
+  bool m_hasCommandCounter; ///<m_commandCounterが有効か？
+  ref::Command m_command;   ///<最後に処理したコマンド（decideSafeMode()の置き換えは含まない）
+  double m_setPlayTimeout;  ///<セットプレーを打ち切ってInPlayにする時間 [s]
+  double m_ballMovedDistance;///<相手のセットプレーでボールが動いたとみなす距離 [mm]
+  std::vector<GameModeTransition> m_timeline; ///<ゲームモードの遷移の記録（時刻の順）
+
+  GameMode decideCommand(ref::Command c, const Orthogonal &ball, BallMotion motion, double kickTime, double ctime);
+  void record(ref::Command c, const GameMode &mode, const Orthogonal &ball, double ctime);
 public:
   Game(int color);
+  void setSetPlayTimeout(double t);
+  void setBallMovedDistance(double d);
   GameMode decideMode(const RefereeInfo &rinfo, const Orthogonal &ball, double ctime);
+  GameMode decideMode(const RefereeInfo &rinfo, const Orthogonal &ball, BallMotion motion, double kickTime, double ctime);
+  GameMode consume(const RefereeEvent &event, const Orthogonal &ball, BallMotion motion, double kickTime, double ctime);
+  GameMode decideSafeMode(RefereeInfo &rinfo, const Orthogonal &ball, double ctime);
+  GameMode update(const Orthogonal &ball, BallMotion motion, double kickTime, double ctime);
+  ///
+  ///@brief 最後に処理したコマンドを返す
+  ///
+  ref::Command getCommand() const
+  {
+    return m_command;
+  }
+  ///
+  ///@brief ゲームモードの遷移の記録全体を返す
+  ///
+  const std::vector<GameModeTransition> &getTimeline() const
+  {
+    return m_timeline;
+  }
+  int getTimeline(double t0, double t1, std::vector<GameModeTransition> &out) const;
+  bool getModeAt(double t, GameModeTransition &tr) const;
+  void clearTimeline();
 };
 
 } //namespace odens
@@ -30,6 +30,8 @@ public:
   bool open(int color, int number);
   void write(double ctime, const srInfo &sinfo, const Timed2D &ballVel, 
     const RefereeInfo &rinfo, const GameMode &mode, const RobotCommand &com);
+  void writeTimeline(const std::vector<GameModeTransition> &timeline);
+  void writeRobotTrace(const RobotSendStats &stats, const std::vector<RobotSendRecord> &trace);
 };
 
 } //namespace odens
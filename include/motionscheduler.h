@@ -0,0 +1,137 @@
+﻿///
+///@file motionscheduler.h
+///@brief MotionSchedulerクラスの宣言
+///@par Copyright
+/// Copyright (C) 2026 Team ODENS, Masutani Lab, Osaka Electro-Communication University
+///@par 履歴
+///- 2026/10/18 升谷 保博 新規作成（動作の区切りによるコマンドの切り替え）
+///@addtogroup robot
+///@{
+///
+
+#pragma once
+#include <iostream>
+#include "robot.h"
+
+namespace odens {
+
+///
+///@brief コマンド（モーション）の最短の継続時間と中断の可否
+///
+///- ロボットの種類ごとにCommandの順に並べた表を作り，MotionScheduler::setRobot()に渡す．
+///
+struct MotionTiming {
+  double minDuration; ///<一度送ったら続ける最短の時間（歩行なら1歩の周期） [s]
+  bool interruptible; ///<最短の時間の途中でも切り替えてよいか？
+};
+
+///
+///@brief 各ロボットのmotionTimingTableに並べる値
+///
+///- 実機のモーションの周期は測っていないので，MotionSchedulerは設定ファイルで
+///  `MotionScheduler = true`とした場合だけこれらの値を使う（既定ではどのコマンドもすぐに切り替える）．
+///- 時間は起き上がり（Task::runStandUp()）のボタン操作の1段と同じ1/6 [s]を単位にしている．
+///
+constexpr MotionTiming timingFree = {0, true};           ///<いつでも切り替えてよい（停止，トルクのオン・オフ）
+constexpr MotionTiming timingStep = {0.333, false};      ///<歩行（1歩の周期）
+constexpr MotionTiming timingSmallStep = {0.167, false}; ///<小さな歩行（1歩の周期），起き上がり
+constexpr MotionTiming timingWhole = {1.0, false};       ///<キックや開脚（動作全体）
+
+///
+///@brief 動作の列の1段
+///
+struct MotionStep {
+  RobotCommand command; ///<コマンド
+  double duration;      ///<続ける時間（0以下ならMotionTimingのminDuration） [s]
+};
+
+#define MOTION_QUEUE_SIZE (16) ///<動作の列の段数の上限
+
+///
+///@brief MotionSchedulerの統計
+///
+struct MotionSchedulerStats {
+  uint32_t requests;  ///<request()の回数
+  uint32_t switches;  ///<Robotへ送るコマンドを切り替えた回数
+  uint32_t deferred;  ///<動作の途中なので切り替えを保留した回数
+  uint32_t collapsed; ///<保留中に取り消されたか置き換えられた依頼の数（送らずに済んだ切り替え）
+  uint32_t sequences; ///<動作の列を始めた回数
+};
+
+///
+///@brief TaskとRobotの間でコマンドの切り替えの時期を決めるクラス
+///
+///- 中断できないコマンドは，最短の継続時間（歩行なら1歩の周期）の区切りまで切り替えを保留する．
+///  同じコマンドを続けている間は区切りを1周期ずつ先へ延ばすので，歩行の途中では切り替えない．
+///- 保留中の依頼は最新のものだけを残す．元のコマンドに戻る依頼なら保留を取り消す．
+///  パケットが同じコマンドへの切り替えは，切り替えとみなさない．
+///- 起き上がりのような複数の段の動作は列にして，時刻に従って順に送る．
+///- Taskのメインループのスレッドだけから使う（ミューテックスを使わない）．
+///- 緊急のコマンド（停止やトルクオフ）はforce()で保留や列を捨ててすぐに送る．
+///- setEnabled(true)にしなければ，どのコマンドも中断できるものとして扱う（依頼をすぐに送る）．
+///  動作の列は有効かどうかに関わらず，段ごとに決めた時間に従う．
+///
+class MotionScheduler {
+private:
+  Robot *m_probot;                       ///<コマンドを送るRobot
+  bool m_enabled;                        ///<最短の継続時間の表に従うか？
+  const MotionTiming *m_timingTable;     ///<各コマンドの最短の継続時間と中断の可否
+  size_t m_timingNum;                    ///<m_timingTableの要素数
+  RobotCommand m_current;                ///<送っているコマンド
+  double m_startTime;                    ///<送っているコマンドの開始時刻 [s]
+  double m_holdUntil;                    ///<この時刻までは切り替えない [s]
+  double m_period;                       ///<送っているコマンドの区切りの周期（0なら中断できる） [s]
+  bool m_hasPending;                     ///<保留している依頼があるか？
+  RobotCommand m_pending;                ///<保留している依頼
+  MotionStep m_queue[MOTION_QUEUE_SIZE]; ///<動作の列
+  size_t m_queueHead;                    ///<動作の列の現在の段
+  size_t m_queueNum;                     ///<動作の列の段数（0なら列を実行していない）
+  double m_stepEnd;                      ///<動作の列の現在の段の終わる時刻 [s]
+  MotionSchedulerStats m_stats;          ///<統計
+
+  MotionTiming getTiming(RobotCommand com) const;
+  bool isSamePacket(RobotCommand a, RobotCommand b) const;
+  void apply(RobotCommand com, double duration, double ctime);
+  void startStep(double ctime);
+public:
+  MotionScheduler();
+  void setRobot(Robot &robot, const MotionTiming *table, size_t num);
+  void request(RobotCommand com, double ctime);
+  bool requestMotion(const RobotMotion &motion, double ctime);
+  void force(RobotCommand com, double ctime);
+  bool startSequence(const MotionStep *steps, size_t num, double ctime);
+  void update(double ctime);
+  ///
+  ///@brief 最短の継続時間の表に従うか設定する
+  ///@param[in] enabled 従うか？（falseならどのコマンドもすぐに切り替える）
+  ///
+  void setEnabled(bool enabled)
+  {
+    m_enabled = enabled;
+  }
+  ///
+  ///@brief 動作の列を実行中か？
+  ///
+  bool isSequenceRunning() const
+  {
+    return m_queueNum > 0;
+  }
+  ///
+  ///@brief 送っているコマンドを返す
+  ///
+  RobotCommand getCurrent() const
+  {
+    return m_current;
+  }
+  ///
+  ///@brief 統計を返す
+  ///
+  MotionSchedulerStats getStats() const
+  {
+    return m_stats;
+  }
+};
+
+} //namespace odens
+
+///@} doxygenのためのコメント（消してはいけない）
@@ -0,0 +1,52 @@
+﻿///
+///@file notifier.h
+///@brief Notifierクラスの宣言
+///@par Copyright
+/// Copyright (C) 2026 Team ODENS, Masutani Lab, Osaka Electro-Communication University
+///@par 履歴
+///- 2026/10/18 升谷 保博 新規作成（ビジョンとレフェリーの待ち合わせ）
+///@addtogroup notifier Notifier
+///@brief 受信スレッドからメインループへの通知
+///@{
+///
+
+#pragma once
+#include <boost/thread.hpp>
+#include <boost/thread/condition_variable.hpp>
+
+namespace odens {
+
+///
+///@brief 通知の発生源を表す列挙型（ビットの論理和で組み合わせる）
+///
+enum NotifySource {
+  NotifyNone = 0,    ///<なし（タイムアウト）
+  NotifyVision = 1,  ///<ビジョンの新しいフレーム
+  NotifyReferee = 2  ///<レフェリーボックスの新しいコマンド
+};
+
+///
+///@brief 複数の受信スレッドからの通知をまとめて待つクラス
+///
+///- Vision，Refereeの受信スレッドがnotify()し，メインループがwait()で
+///  どちらか一方が来るまで待つ．
+///- 通知は待つ前に来ていても失われない（発生源ごとのフラグとして残る）．
+///
+class Notifier {
+private:
+  boost::mutex m_mutex;                  ///<ミューテックス（排他制御に利用）
+  boost::condition_variable m_condition; ///<条件変数（同期に利用）
+  unsigned m_pending;                    ///<まだ待ち側に渡していない通知（NotifySourceの論理和）
+public:
+  ///コンストラクタ
+  Notifier()
+    :m_pending(NotifyNone)
+  {
+  }
+  void notify(NotifySource source);
+  unsigned wait(unsigned timeout);
+};
+
+} //namespace odens
+
+///@} doxygenのためのコメント（消してはいけない）
@@ -0,0 +1,116 @@
+﻿///
+///@file particlefilter.h
+///@brief BallParticleFilterクラスの宣言
+///@par Copyright
+/// Copyright (C) 2026 Team ODENS, Masutani Lab, Osaka Electro-Communication University
+///@par 履歴
+///- 2026/10/18 升谷 保博 新規作成（ボールのパーティクルフィルタ）
+///@addtogroup particlefilter BallParticleFilter
+///@brief ボールのパーティクルフィルタ
+///@{
+///
+
+#pragma once
+#include <random>
+#include "sr.h"
+#include "estimator.h"
+
+namespace odens {
+
+#define BALL_PARTICLE_NUM (512)  ///<粒子の数（1フレームあたりの計算量はこれに比例する）
+
+///
+///@brief 粒子の状態を成分ごとの配列で保持する構造体
+///
+struct BallParticleArray {
+  double x[BALL_PARTICLE_NUM];  ///<x座標 [mm]
+  double y[BALL_PARTICLE_NUM];  ///<y座標 [mm]
+  double vx[BALL_PARTICLE_NUM]; ///<速度のx成分 [mm/s]
+  double vy[BALL_PARTICLE_NUM]; ///<速度のy成分 [mm/s]
+};
+
+///
+///@brief ロボットによる隠れを考慮したボールのパーティクルフィルタ
+///
+///- 粒子の数は固定で，記憶領域はすべてコンストラクタで確保する．
+///- 見えていないときは，ロボットの周り（隠れる領域）にない粒子の重みを下げる．
+///  これにより，隠れている間もボールがありそうな位置を保持できる．
+///
+class BallParticleFilter {
+private:
+  BallParticleArray m_particle[2];          ///<粒子（リサンプリングのために2組を交互に使う）
+  int m_index;                              ///<現在の粒子の組の添字
+  double m_weight[BALL_PARTICLE_NUM];       ///<重み
+  double m_noiseX[BALL_PARTICLE_NUM];       ///<速度のx成分に加える雑音
+  double m_noiseY[BALL_PARTICLE_NUM];       ///<速度のy成分に加える雑音
+  double m_occluded[BALL_PARTICLE_NUM];     ///<隠れる領域にあるか（1か0）
+  std::mt19937 m_random;                    ///<乱数生成器
+  std::normal_distribution<double> m_normal;        ///<標準正規分布
+  std::uniform_real_distribution<double> m_uniform; ///<[0,1)の一様分布
+  bool m_initialized;       ///<初期化されたか？
+  double m_time;            ///<最後に更新した時刻
+  double m_seenTime;        ///<最後にボールが見えた時刻
+  double m_decay;           ///<速度が1/eになる時間 [s]
+  double m_velocityNoise;   ///<速度の変化の標準偏差 [mm/s/√s]
+  double m_observationNoise;///<観測の誤差の尺度 [mm]
+  double m_missProbability; ///<隠れる領域の外でボールを見落とす確率
+  double m_occluderRadius;  ///<ロボットがボールを隠す半径 [mm]
+  double m_resetDistance;   ///<これ以上離れた観測が来たら初期化し直す距離 [mm]
+  double m_holdTime;        ///<見えなくなってから推定を続ける時間 [s]
+  Orthogonal m_ball;        ///<推定位置
+  Timed2D m_vel;            ///<推定速度
+  double m_spread;          ///<粒子の広がり（位置の標準偏差） [mm]
+  double m_cxx;             ///<粒子の位置の共分散のxx成分 [mm^2]
+  double m_cxy;             ///<粒子の位置の共分散のxy成分 [mm^2]
+  double m_cyy;             ///<粒子の位置の共分散のyy成分 [mm^2]
+  void initialize(const Orthogonal &ball, const Timed2D &vel, double ctime);
+  void resample();
+  void estimate();
+public:
+  BallParticleFilter();
+  void clear();
+  void update(const Orthogonal &ball, const Timed2D &vel, const srInfo &sinfo, double ctime);
+  ///
+  ///@brief 推定値が使えるか？
+  ///
+  bool isValid() const
+  {
+    return m_initialized && m_time-m_seenTime <= m_holdTime;
+  }
+  ///
+  ///@brief 推定位置を返す
+  ///
+  Orthogonal getBall() const
+  {
+    return m_ball;
+  }
+  ///
+  ///@brief 推定速度を返す [mm/s]
+  ///
+  Timed2D getVelocity() const
+  {
+    return m_vel;
+  }
+  ///
+  ///@brief 粒子の広がり（位置の標準偏差）を返す [mm]
+  ///
+  double getSpread() const
+  {
+    return m_spread;
+  }
+  ///
+  ///@brief 粒子の位置の共分散を返す [mm^2]
+  ///@param[out] cxx xx成分
+  ///@param[out] cxy xy成分
+  ///@param[out] cyy yy成分
+  ///@return なし
+  ///
+  void getCovariance(double &cxx, double &cxy, double &cyy) const
+  {
+    cxx = m_cxx; cxy = m_cxy; cyy = m_cyy;
+  }
+};
+
+} //namespace odens
+
+///@} doxygenのためのコメント（消してはいけない）
@@ -0,0 +1,69 @@
+﻿///
+///@file predictor.h
+///@brief BallPredictorクラスの宣言
+///@par Copyright
+/// Copyright (C) 2026 Team ODENS, Masutani Lab, Osaka Electro-Communication University
+///@par 履歴
+///- 2026/10/18 升谷 保博 新規作成（ボールの軌道予測）
+///@addtogroup predictor BallPredictor
+///@brief ボールの軌道予測クラス
+///@{
+///
+
+#pragma once
+#include "sr.h"
+#include "estimator.h"
+
+namespace odens {
+
+#define PREDICTOR_SAMPLE_NUM (64)  ///<迎撃点探索のために保持する軌道の点の数
+
+///
+///@brief 転がり摩擦による一定の減速を仮定してボールの軌道を予測するクラス
+///
+///- update()で推定値を与えたときに軌道の諸量と軌道上の点を計算しておき，
+///  各問い合わせはそれを使って閉じた式か短い探索で答える．
+///- 時間はすべてupdate()で与えた時刻からの相対時間 [s]．
+///
+class BallPredictor {
+private:
+  double m_deceleration;   ///<転がり摩擦による減速度 [mm/s^2]
+  double m_horizon;        ///<迎撃点を探索する最大の時間 [s]
+  Orthogonal m_ball;       ///<現在のボールの位置
+  double m_ux;             ///<進行方向の単位ベクトルのx成分
+  double m_uy;             ///<進行方向の単位ベクトルのy成分
+  double m_speed;          ///<現在の速さ [mm/s]
+  double m_stopTime;       ///<止まるまでの時間 [s]
+  double m_stopDistance;   ///<止まるまでに転がる距離 [mm]
+  double m_sampleTime;     ///<軌道の点の時間間隔 [s]
+  double m_sampleX[PREDICTOR_SAMPLE_NUM]; ///<軌道の点のx座標 [mm]
+  double m_sampleY[PREDICTOR_SAMPLE_NUM]; ///<軌道の点のy座標 [mm]
+  double travel(double t) const;
+public:
+  BallPredictor();
+  bool setDeceleration(double deceleration);
+  void update(const Orthogonal &ball, const Timed2D &ballVel);
+  Orthogonal position(double t) const;
+  double timeToDistance(double s) const;
+  double timeToLine(const Orthogonal &p, const Orthogonal &q) const;
+  Timed2D crossOurGoalLine() const;
+  Timed2D intercept(const Orthogonal &robot, double speed, double reach = ROBOT_RADIUS+BALL_RADIUS) const;
+  ///
+  ///@brief 止まる位置を返す
+  ///
+  Orthogonal stopPosition() const
+  {
+    return position(m_stopTime);
+  }
+  ///
+  ///@brief 止まるまでの時間を返す [s]
+  ///
+  double stopTime() const
+  {
+    return m_stopTime;
+  }
+};
+
+} //namespace odens
+
+///@} doxygenのためのコメント（消してはいけない）
@@ -15,7 +15,10 @@
 #include <string>
 #include <boost/thread.hpp>
 #include <boost/asio.hpp>
+#include <boost/atomic.hpp>
+#include <boost/lockfree/spsc_queue.hpp>
 #include "sr.h"
+#include "notifier.h"
 
 namespace odens {
 
@@ -61,42 +64,117 @@ namespace odens {
       TIMEOUT_BLUE = 13,
       GOAL_YELLOW = 14,
       GOAL_BLUE = 15,
+      BALL_PLACEMENT_YELLOW = 16,
+      BALL_PLACEMENT_BLUE = 17,
       CommandNOI
     };
   }
 
 class Referee; //friendのために先に宣言しておく
 
+#define REFEREE_TEAM_NAME_LENGTH 31 ///< チーム名の最大文字数（超えた分は切り捨てる）
+#define REFEREE_YELLOW_CARD_NUM 8   ///< 残り時間を保持するイエローカードの最大数
+
+///
+///@brief レフェリーボックスのチームの情報を保持する構造体
+///
+///- パケットごとにメモリを確保しないように，全て固定長にしている．
+///
+struct RefereeTeamInfo {
+  char name[REFEREE_TEAM_NAME_LENGTH+1]; ///<チーム名（空文字列もありうる）
+  uint32_t score;           ///<得点
+  uint32_t redCards;        ///<レッドカードの枚数
+  int yellowCardNum;        ///<yellowCardTimesの要素数
+  uint32_t yellowCardTimes[REFEREE_YELLOW_CARD_NUM]; ///<有効なイエローカードの残り時間 [μs]（短い順）
+  uint32_t yellowCards;     ///<これまでのイエローカードの枚数
+  uint32_t timeouts;        ///<残りのタイムアウトの回数
+  uint32_t timeoutTime;     ///<残りのタイムアウトの時間 [μs]
+  uint32_t goalie;          ///<ゴールキーパーのパターン番号
+  uint32_t foulCounter;     ///<ファウルの回数（送られてこなければ0）
+  uint32_t ballPlacementFailures; ///<ボールプレースメントの連続失敗回数（送られてこなければ0）
+  bool canPlaceBall;        ///<ボールプレースメントができるか？（送られてこなければ偽）
+  uint32_t maxAllowedBots;  ///<フィールドに出せるロボットの数（送られてこなければ0）
+};
+
 ///
 ///@brief レフェリーボックスの情報を保持する構造体
 ///
+///- 座標はビジョンの座標系のままなので，VisionHumanoid::convertPosition()で変換して使う．
+///
 struct RefereeInfo {
   uint64_t packetTimestamp; ///<パケットのタイムスタンプ
   ref::Stage stage;                  ///<ステージ
   int32_t stageTimeLeft;    ///<残り時間
   ref::Command command;              ///<コマンド
   uint32_t commandCounter;  ///<コマンドのカウンタ
-  uint32_t score[2];        ///<両チームの得点
+  uint64_t commandTimestamp; ///<コマンドが出されたときのタイムスタンプ
+  uint32_t score[2];        ///<両チームの得点（team[].scoreと同じ）
+  RefereeTeamInfo team[2];  ///<両チームの情報
+  bool hasDesignatedPosition;     ///<designatedPositionが有効か？
+  Orthogonal designatedPosition;  ///<ボールプレースメントの目標位置（ビジョンの座標系） [mm]
+  bool hasBlueTeamOnPositiveHalf; ///<blueTeamOnPositiveHalfが有効か？
+  bool blueTeamOnPositiveHalf;    ///<青チームのゴールがx軸の正の側にあるか？
+  bool hasNextCommand;            ///<nextCommandが有効か？
+  ref::Command nextCommand;       ///<現在の中断の後に出される予定のコマンド
+  bool hasCurrentActionTimeRemaining; ///<currentActionTimeRemainingが有効か？
+  int64_t currentActionTimeRemaining; ///<現在の行動（フリーキックなど）の残り時間 [μs]（負もありうる）
+  bool unknownCommand;      ///<知らないコマンドを受信したか？（その場合commandはSTOPにしている）
   friend Referee;                           ///<@ref Referee クラス
 
   ///コマンドの文字列を返す
-  std::string RefereeInfo::commandString()
+  std::string commandString()
   {
-    return commandStringTable[command];
+    if (unknownCommand) {
+      return "UNKNOWN";
+    }
+    return (command >= 0 && command < ref::CommandNOI) ? commandStringTable[command] : "";
+  }
+  ///次のコマンドの文字列を返す
+  std::string nextCommandString()
+  {
+    return (hasNextCommand && nextCommand >= 0 && nextCommand < ref::CommandNOI) ? commandStringTable[nextCommand] : "";
   }
   ///ステージの文字列を返す
-  std::string RefereeInfo::stageString()
+  std::string stageString()
   {
-    return stageStringTable[stage];
+    return (stage >= 0 && stage < ref::StageNOI) ? stageStringTable[stage] : "";
   }
 private:
   static std::string commandStringTable[ref::CommandNOI]; ///<コマンドの文字列を保持する配列
   static std::string stageStringTable[ref::StageNOI];   ///<ステージの文字列を保持する配列
 };
 
+#define REFEREE_EVENT_QUEUE_SIZE 64 ///< コマンドの変化を保持する待ち行列の大きさ
+
+///
+///@brief レフェリーボックスのコマンドの変化（command_counterが変わったこと）を表す構造体
+///
+struct RefereeEvent {
+  ref::Command command;      ///<新しいコマンド
+  uint32_t commandCounter;   ///<コマンドのカウンタ
+  uint64_t commandTimestamp; ///<コマンドが出されたときのタイムスタンプ
+  uint32_t missed;           ///<直前のイベントとの間でカウンタが飛んだ数（パケットの取りこぼし）
+  double arrivalTime;        ///<パケットを受信した時刻（getTime()の値） [s]
+};
+
+///
+///@brief レフェリーボックスからの受信の状態（受信間隔の統計）を保持する構造体
+///
+struct RefereeStatistics {
+  uint32_t packets;     ///<受信したパケットの数
+  double interval;      ///<最後の受信間隔 [s]
+  double meanInterval;  ///<受信間隔の平均 [s]
+  double jitter;        ///<受信間隔の標準偏差 [s]
+  double maxInterval;   ///<受信間隔の最大値 [s]
+  double age;           ///<最後に受信してからの時間 [s]
+  uint32_t staleCount;  ///<get()が途絶と判断するようになった回数
+};
+
 ///
 ///@brief レフェリーボックスからの信号を受信するクラス
 ///
+///- get()は最新の情報だけを返す．コマンドの変化は全てpopEvent()で順に取り出せる．
+///
 class Referee {
 private:
   boost::thread m_thread;     ///<スレッド
@@ -106,13 +184,42 @@ private:
   boost::asio::ip::udp::socket m_socket;   ///<通信のためのソケット
   RefereeInfo m_refereeInfo;  ///<得られたレフェリーボックスの情報（排他制御の対象）
   bool m_active;              ///<通信の状態を表すフラグ
+  double m_timeout;           ///<受信がこの時間途絶えたら途絶とみなす [s]
+  double m_lastArrival;       ///<最後にパケットを受信した時刻（排他制御の対象）
+  uint32_t m_packets;         ///<受信したパケットの数（排他制御の対象）
+  double m_interval;          ///<最後の受信間隔（排他制御の対象）
+  double m_intervalMean;      ///<受信間隔の平均（排他制御の対象）
+  double m_intervalM2;        ///<受信間隔の平均からの偏差の2乗和（排他制御の対象）
+  double m_intervalMax;       ///<受信間隔の最大値（排他制御の対象）
+  bool m_stale;               ///<前回のget()で途絶と判断したか？
+  uint32_t m_staleCount;      ///<get()が途絶と判断するようになった回数
+  boost::lockfree::spsc_queue<RefereeEvent, boost::lockfree::capacity<REFEREE_EVENT_QUEUE_SIZE> > m_events; ///<コマンドの変化の待ち行列（受信スレッドが入れ，メインループが取り出す）
+  bool m_hasCounter;          ///<m_lastCounterが有効か？（受信スレッドだけが使う）
+  uint32_t m_lastCounter;     ///<最後に待ち行列に入れたコマンドのカウンタ（受信スレッドだけが使う）
+  boost::atomic<uint32_t> m_droppedEvents; ///<待ち行列が一杯で入れられなかった回数（次のパケットで入れ直す）
+  Notifier *m_notifier;       ///<新しいコマンドを通知する先（なければnullptr）
 
   void main();
+  void pushEvent(const RefereeInfo &info, double arrivalTime);
+  static void clearInfo(RefereeInfo &info);
 public:
   ///コンストラクタ
   Referee()
     :m_io(),
-    m_socket(m_io)
+    m_socket(m_io),
+    m_timeout(1.0),
+    m_lastArrival(0),
+    m_packets(0),
+    m_interval(0),
+    m_intervalMean(0),
+    m_intervalM2(0),
+    m_intervalMax(0),
+    m_stale(false),
+    m_staleCount(0),
+    m_hasCounter(false),
+    m_lastCounter(0),
+    m_droppedEvents(0),
+    m_notifier(nullptr)
   {
    std::cout << "Referee コンストラクタ" << std::endl;
   }
@@ -127,6 +234,29 @@ public:
   }
   bool start(std::string address, int port);
   int get(RefereeInfo &info);
+  bool popEvent(RefereeEvent &event);
+  void getStatistics(RefereeStatistics &stat);
+  ///
+  ///@brief 途絶とみなす時間を設定する [s]
+  ///
+  void setTimeout(double timeout)
+  {
+    m_timeout = timeout;
+  }
+  ///
+  ///@brief 新しいコマンドを受信したときの通知先を設定する（start()の前に呼ぶ）
+  ///
+  void setNotifier(Notifier *notifier)
+  {
+    m_notifier = notifier;
+  }
+  ///
+  ///@brief 待ち行列が一杯で入れられなかった回数を返す
+  ///
+  uint32_t getDroppedEvents() const
+  {
+    return m_droppedEvents;
+  }
 };
 
 } //namespace odens
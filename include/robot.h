@@ -15,82 +15,366 @@
 #include <iostream>
 #include <string>
 #include <vector>
+#include <array>
+#include <algorithm>
+#include <memory>
 #include <cstdint>
+#include <cmath>
 #include <boost/thread.hpp>
 #include <boost/asio.hpp>
+#include <boost/atomic.hpp>
 
 namespace odens {
 
 typedef size_t RobotCommand; ///<ロボットへ送るコマンドを表す非負の値
 
+#define PACKET_MAX_SIZE (13) ///<パケットの長さの上限 [byte]（KHR-3HVとKXR-L2の13byte）
+
 ///
 ///@brief ロボットへ送るバイト列
 ///
+///- 固定長の配列なので動的なメモリ確保をしない．リテラル型なのでconstexprの表にできる．
+///
 struct Packet {
-  std::vector<uint8_t> b;     ///<バイト列
+  std::array<uint8_t, PACKET_MAX_SIZE> b; ///<バイト列（先頭からsize個を使う）
+  size_t size;                            ///<長さ [byte]
 
   ///データ列を16進で表示
-  void print()
+  void print() const
   {
-    for (size_t i=0; i<b.size(); i++) {
+    for (size_t i=0; i<size; i++) {
       std::cout << std::hex << int(b[i]) <<",";
     }
     std::cout << std::endl;
   }
 };
 
+///
+///@brief パケットのバイト列の和の下位8bitを求める（チェックサムの計算と検査用）
+///@param[in] p パケット
+///@param[in] first 最初の添字
+///@param[in] last 最後の添字の次
+///
+constexpr uint8_t packetSum(const Packet &p, size_t first, size_t last)
+{
+  return first >= last ? 0 : static_cast<uint8_t>(p.b[first] + packetSum(p, first+1, last));
+}
+
+///
+///@brief 連続値の移動指令（前進，横移動，旋回の速さ）
+///
+///- それぞれ最大の速さに対する比（-1～1）．
+///- RobotCommandに詰めて送信スレッドへ渡すので，1/127刻みに量子化される．
+///
+struct RobotMotion {
+  double forward; ///<前進の速さ（正が前）
+  double strafe;  ///<横移動の速さ（正が左）
+  double turn;    ///<旋回の速さ（正が左旋回）
+};
+
+#define ROBOT_MOTION_FLAG (static_cast<RobotCommand>(1) << (8*sizeof(RobotCommand)-1)) ///<RobotCommandが連続値の移動指令であることを表すビット
+#define ROBOT_MOTION_SCALE (127) ///<連続値の移動指令を量子化したときの最大値
+
+///
+///@brief RobotCommandが連続値の移動指令か？
+///
+inline bool isMotionCommand(RobotCommand com)
+{
+  return (com & ROBOT_MOTION_FLAG) != 0;
+}
+
+///
+///@brief 連続値の移動指令を量子化してRobotCommandに詰める
+///@param[in] m 移動指令（範囲外の値は-1～1に制限する）
+///@return 移動指令を表すRobotCommand（下位から前進，横移動，旋回を8bitずつ）
+///
+inline RobotCommand encodeMotion(const RobotMotion &m)
+{
+  const double v[3] = {m.forward, m.strafe, m.turn};
+  RobotCommand com = ROBOT_MOTION_FLAG;
+  for (int i = 0; i < 3; i++) {
+    double x = std::max(-1.0, std::min(1.0, v[i]));
+    int q = static_cast<int>(std::floor(x*ROBOT_MOTION_SCALE + 0.5)) + 128; //1～255
+    com |= static_cast<RobotCommand>(q) << (8*i);
+  }
+  return com;
+}
+
+///
+///@brief RobotCommandに詰めた移動指令を取り出す
+///@param[in] com 移動指令を表すRobotCommand
+///@param[out] q 前進，横移動，旋回の量子化された値（-ROBOT_MOTION_SCALE～ROBOT_MOTION_SCALE）
+///@return なし
+///
+inline void decodeMotion(RobotCommand com, int q[3])
+{
+  for (int i = 0; i < 3; i++) {
+    q[i] = static_cast<int>((com >> (8*i)) & 0xff) - 128;
+  }
+}
+
+#define ROBOT_REPLY_MAX_SIZE (64)   ///<ロボットからの応答1つの長さの上限 [byte]
+#define ROBOT_RX_BUFFER_SIZE (256)  ///<受信したバイト列を区切るまで保持するバッファの大きさ [byte]
+
+///
+///@brief ロボットからの応答の種類を表す列挙型
+///
+enum ReplyType {
+  ReplyNone = 0, ///<応答ではない（読み捨てたバイト列）
+  ReplyAck,      ///<受理した（ACK）
+  ReplyNak,      ///<受理しなかった（NAK）
+  ReplyData,     ///<データを含む応答
+  ReplyTypeNOI   ///<項目数
+};
+
+///
+///@brief ロボットからの応答1つ
+///
+struct RobotReply {
+  ReplyType type; ///<応答の種類
+  std::array<uint8_t, ROBOT_REPLY_MAX_SIZE> b; ///<応答のバイト列（先頭からsize個を使う）
+  size_t size;    ///<長さ [byte]
+};
+
+///
+///@brief ロボットからの受信をまとめた情報（テレメトリ）
+///
+///- 時間はgetTime()の値 [s]．
+///- 応答の往復時間は，パケットの書き込みを始めてからACKを受信するまでの時間．
+///- ACKは，書き込みを終えた最新の送信に対応させる．それより前のACK待ちの送信は取りこぼしとする．
+///  応答の往復時間が送信の間隔より短い（普通はそうなる）場合に正確になる．
+///
+struct RobotTelemetry {
+  uint32_t acks;        ///<ACKの数
+  uint32_t naks;        ///<NAKの数
+  uint32_t lostAcks;    ///<ACKが来なかった（取りこぼした）送信の数
+  uint32_t dataReplies; ///<データを含む応答の数
+  uint32_t badBytes;    ///<応答として解釈できずに読み捨てたバイト数
+  uint32_t rttSamples;  ///<往復時間を求めた応答の数（ACK待ちの送信がないACKとNAKは含まない）
+  double rttLast;       ///<最新の応答の往復時間 [s]
+  double rttMean;       ///<応答の往復時間の平均（rttSamples個） [s]
+  double rttMax;        ///<応答の往復時間の最大 [s]
+  double lastReplyTime; ///<最後に応答を受信した時刻 [s]
+  RobotReply lastData;  ///<最新のデータを含む応答（内容の解釈はロボットの種類ごと）
+};
+
+#define ROBOT_TRACE_SIZE (1024) ///<送信の記録を保持する数（リングバッファの大きさ）
+
+///
+///@brief 送信1回の記録
+///
+struct RobotSendRecord {
+  double time;          ///<書き込みを始めた時刻 [s]
+  RobotCommand command; ///<送信したコマンド
+  uint32_t bytes;       ///<書き込んだバイト数
+  bool ok;              ///<書き込みに成功したか？
+  float duration;       ///<書き込みにかかった時間 [s]
+  float delay;          ///<コマンドが変わってから書き込みを始めるまでの時間 [s]（再送なら-1）
+};
+
+///
+///@brief 送信の統計
+///
+///- 書き込みにかかった時間の平均と最大は，書き込みに成功した送信について求める．
+///
+struct RobotSendStats {
+  uint32_t writes;     ///<書き込みの回数
+  uint32_t changes;    ///<コマンドが変わって書き込んだ回数
+  uint32_t keepalives; ///<コマンドが変わらずに再送した回数
+  uint32_t failures;   ///<書き込みに失敗した（期限切れを含む）回数
+  uint32_t timeouts;   ///<書き込みが期限を過ぎて取り消された回数
+  uint64_t bytes;      ///<書き込んだバイト数の合計
+  double durationMean; ///<書き込みにかかった時間の平均 [s]
+  double durationMax;  ///<書き込みにかかった時間の最大 [s]
+  double delayMean;    ///<コマンドが変わってから書き込みを始めるまでの時間の平均 [s]
+  double delayMax;     ///<コマンドが変わってから書き込みを始めるまでの時間の最大 [s]
+};
+
+class RobotManager;
+
 ///
 ///@brief シリアル通信でロボットへパケットを送信するクラス
 ///
+///- start()で開始すると自分のスレッドとIOサービスを使う．
+///  RobotManager::add()で開始すると，RobotManagerのスレッドとIOサービスを複数のRobotで共有する．
+///- TaskはMotionSchedulerを通してコマンドを送る．
+///
 class Robot {
+  friend class RobotManager;
+  friend class MotionScheduler;
 private:
-  boost::thread m_thread; ///<スレッド
-  boost::mutex m_mutex;   ///<ミューテックス
-  bool m_loop;            ///<別スレッドの繰り返しのフラグ
-  boost::asio::io_service m_io;        ///<ASIOのIOサービス
-  boost::asio::serial_port m_serial;   ///<シリアルポート
-  Packet m_packet;   ///<送信するパケット
-  int m_interval;         ///<送信する間隔 [ms]
-  RobotCommand m_com; ///<送信したコマンド
+  boost::thread m_thread; ///<スレッド（start()で開始した場合）
+  boost::asio::io_service m_io;        ///<start()で開始した場合のASIOのIOサービス
+  boost::asio::io_service *m_pio;      ///<使っているIOサービス（m_ioかRobotManagerのもの）
+  std::unique_ptr<boost::asio::serial_port> m_serial;   ///<シリアルポート（開始時にm_pioで作る）
+  std::unique_ptr<boost::asio::deadline_timer> m_keepaliveTimer; ///<コマンドが変わらないときの再送のタイマ
+  std::unique_ptr<boost::asio::deadline_timer> m_writeTimer;     ///<書き込みの期限のタイマ
+  boost::atomic<RobotCommand> m_com; ///<送信するコマンド（setCommand()からの受け渡し）
+  boost::atomic<bool> m_kickPending; ///<送信スレッドへの送信の依頼が処理待ちか？
+  int m_interval;         ///<コマンドが変わらないときに再送する間隔 [ms]
+  int m_writeTimeout;     ///<書き込みの期限 [ms]
+  bool m_writing;         ///<書き込み中か？（送信スレッドだけが使う）
+  RobotCommand m_sending; ///<書き込み中（最後に書き込んだ）コマンド（送信スレッドだけが使う）
+  RobotCommand m_lastSent; ///<1つ前の書き込みのコマンド（送信スレッドだけが使う）
+  boost::atomic<double> m_comTime; ///<m_comが変わった時刻 [s]
+  float m_writeDelay;     ///<書き込み中の送信のコマンドが変わってから書き込みを始めるまでの時間 [s]（再送なら-1）
+  boost::mutex m_traceMutex;      ///<送信の記録と統計のためのミューテックス（入出力の間は持たない）
+  std::array<RobotSendRecord, ROBOT_TRACE_SIZE> m_trace; ///<送信の記録のリングバッファ
+  uint64_t m_traceCount;          ///<これまでに記録した送信の数（m_traceの次の位置はこれの剰余）
+  RobotSendStats m_sendStats;     ///<送信の統計
+  bool m_receive;         ///<ロボットからの応答を受信するか？
+  double m_ackTimeout;    ///<これより長く応答が来なければ取りこぼしとみなす時間 [s]
+  std::array<uint8_t, ROBOT_RX_BUFFER_SIZE> m_rxBuffer; ///<受信したバイト列（送信スレッドだけが使う）
+  size_t m_rxSize;        ///<m_rxBufferに溜まっているバイト数
+  double m_writeStart;    ///<書き込み中のパケットの書き込みを始めた時刻 [s]
+  double m_ackSendTime;   ///<ACK待ちの最新の送信の書き込みを始めた時刻 [s]
+  double m_ackWriteEnd;   ///<ACK待ちの最新の送信の書き込みを終えた時刻 [s]
+  uint32_t m_ackPending;  ///<ACK待ちの送信の数
+  boost::mutex m_telemetryMutex; ///<m_telemetryのためのミューテックス（入出力の間は持たない）
+  RobotTelemetry m_telemetry;    ///<ロボットからの受信をまとめた情報
+  Packet m_motionPacket;  ///<連続値の移動指令のパケット（送信スレッドだけが使う）
 
   ///
-  ///@brief パケットのバイト列をあらかじめ作成する（ロボットごとに関数を定義する）
+  ///@brief パケットの表を設定する（ロボットごとに関数を定義する）
   ///
   virtual void initializePacket() = 0;
+  bool open(boost::asio::io_service &io, std::string port, int interval, int phase);
+  void close();
   void main();
+  void kick();
+  void startWrite();
+  void onWrite(const boost::system::error_code &ec, size_t bytes);
+  void onWriteTimeout(const boost::system::error_code &ec);
+  void onKeepalive(const boost::system::error_code &ec);
+  void startRead();
+  void onRead(const boost::system::error_code &ec, size_t bytes);
+  void handleReply(const RobotReply &reply, size_t bytes, double now);
+  void dropLostAcks(double now);
+  void addPendingAck(double writeEnd);
+  void putCommand(RobotCommand com);
+  void recordSend(size_t bytes, bool ok, double now);
 
 protected:
-  std::vector<Packet> m_packetTable;   ///<各コマンドのパケットを登録するベクター
-  std::vector<std::string> m_commandStringTable; ///<各コマンドの文字列を登録するベクター
+  const Packet *m_packetTable; ///<各コマンドのパケットの表（ロボットごとのconstexprの配列を指す）
+  size_t m_packetNum;          ///<m_packetTableの要素数
+  const char *const *m_commandStringTable; ///<各コマンドの文字列の表（要素数はm_packetNum）
   int m_baud_rate; ///<通信速度 [bps]
   boost::asio::serial_port_base::parity::type m_parity; ///<パリティチェックの種類
 
+  ///
+  ///@brief 受信したバイト列の先頭から応答を1つ区切って検査する（ロボットごとに定義する）
+  ///@param[in] data 受信したバイト列
+  ///@param[in] size dataの長さ
+  ///@param[out] reply 区切った応答（読み捨てる場合はReplyNone）
+  ///@return 使ったバイト数（0ならまだ応答全体が届いていない）
+  ///
+  ///- 規定では応答を返さないロボットとして全て読み捨てる．
+  ///
+  virtual size_t parseReply(const uint8_t *, size_t size, RobotReply &reply)
+  {
+    reply.type = ReplyNone;
+    reply.size = 0;
+    return size;
+  }
+  ///
+  ///@brief 送信するたびにACKを返すロボットか？（ロボットごとに定義する）
+  ///
+  virtual bool expectsAck() const
+  {
+    return false;
+  }
+  ///
+  ///@brief 連続値の移動指令のパケットを作る（対応するロボットで定義する，送信スレッドで実行）
+  ///@param[in] q 前進，横移動，旋回の量子化された値（-ROBOT_MOTION_SCALE～ROBOT_MOTION_SCALE）
+  ///@param[out] packet パケット
+  ///@retval false 正常終了
+  ///@retval true 異常終了（対応していない）
+  ///
+  virtual bool makeMotionPacket(const int [3], Packet &) const
+  {
+    return true;
+  }
+
 public:
   ///コンストラクタ
   Robot()
     :m_io(),
-    m_serial(m_io)
+    m_com(0),
+    m_kickPending(false),
+    m_comTime(0)
   {
+    m_pio = &m_io;
+    m_packetTable = nullptr;
+    m_packetNum = 0;
+    m_commandStringTable = nullptr;
+    m_interval = 50;
+    m_writeTimeout = 100;
+    m_writing = false;
+    m_sending = 0;
+    m_lastSent = static_cast<RobotCommand>(-1);
+    m_writeDelay = -1;
+    m_traceCount = 0;
+    m_sendStats = RobotSendStats();
+    m_receive = false;
+    m_ackTimeout = 0.2;
+    m_rxSize = 0;
+    m_writeStart = 0;
+    m_ackSendTime = 0;
+    m_ackWriteEnd = 0;
+    m_ackPending = 0;
+    m_telemetry = RobotTelemetry();
     std::cout << "Robot コンストラクタ" << std::endl;
   }
-  ///デストラクタ
-  ~Robot()
+  ///
+  ///@brief デストラクタ
+  ///
+  ///- RobotManagerで開始した場合は，先にRobotManagerを止めておくこと．
+  ///
+  virtual ~Robot()
   {
     std::cout << "Robot デストラクタ" << std::endl;
     if (m_thread.joinable()) {
-      m_loop = false;
+      m_io.stop();
       m_thread.join();
     }
   }
   bool start(std::string port, int interval);
   ///
-  ///@brief 送信したコマンドを返す
+  ///@brief 書き込みの期限を設定する（start()の前に呼ぶ）
+  ///@param[in] timeout 期限 [ms]
+  ///
+  void setWriteTimeout(int timeout)
+  {
+    m_writeTimeout = timeout;
+  }
+  ///
+  ///@brief ロボットからの応答を受信するか設定する（start()の前に呼ぶ）
+  ///@param[in] receive 受信するか？
+  ///
+  void setReceive(bool receive)
+  {
+    m_receive = receive;
+  }
+  RobotTelemetry getTelemetry();
+  RobotSendStats getSendStats();
+  size_t getSendTrace(std::vector<RobotSendRecord> &trace);
+  ///
+  ///@brief 送信するコマンドを返す
   ///
   RobotCommand getCommand()
   {
-    return m_com;
+    return m_com.load();
   }
   void setCommand(const RobotCommand &com);
+  bool setMotion(const RobotMotion &motion);
+  ///
+  ///@brief 連続値の移動指令に対応しているか？（対応するロボットで定義する）
+  ///
+  virtual bool supportsMotion() const
+  {
+    return false;
+  }
+  bool getPacket(RobotCommand com, Packet &packet) const;
   std::string getCommandString(const RobotCommand &com);
   std::string getCommandString();
   size_t size();
@@ -0,0 +1,80 @@
+﻿///
+///@file robotmanager.h
+///@brief RobotManagerクラスの宣言
+///@par Copyright
+/// Copyright (C) 2026 Team ODENS, Masutani Lab, Osaka Electro-Communication University
+///@par 履歴
+///- 2026/10/18 升谷 保博 新規作成（複数のロボットを1つのスレッドで動かす）
+///@addtogroup robot
+///@{
+///
+
+#pragma once
+#include <string>
+#include <vector>
+#include <memory>
+#include <boost/thread.hpp>
+#include <boost/asio.hpp>
+#include "robot.h"
+
+namespace odens {
+
+///
+///@brief 複数のRobotを1つのスレッドとIOサービスで動かすクラス
+///
+///- 1台のPCでチーム全体のロボットを制御するためのもの．ロボットごとのシリアルポート，
+///  コマンドの受け渡し（setCommand()，setMotion()）と再送のタイマは各Robotが持つ．
+///- 再送の時期が重ならないように，各Robotの最初の送信を再送の間隔÷台数ずつずらす．
+///- RobotはRobotManagerより長く存在しなければならない（先にstop()を呼べば破棄してよい）．
+///
+class RobotManager {
+private:
+  ///
+  ///@brief 登録したRobot1台分の情報
+  ///
+  struct Entry {
+    Robot *robot;     ///<Robot
+    std::string port; ///<シリアルポートの名前
+    int interval;     ///<コマンドが変わらないときに再送する間隔 [ms]
+  };
+  boost::asio::io_service m_io; ///<全てのRobotで共有するASIOのIOサービス
+  std::unique_ptr<boost::asio::io_service::work> m_work; ///<m_io.run()を終わらせないためのもの
+  boost::thread m_thread;       ///<スレッド
+  std::vector<Entry> m_entries; ///<登録したRobot
+
+  void main();
+public:
+  ///コンストラクタ
+  RobotManager()
+  {
+    std::cout << "RobotManager コンストラクタ" << std::endl;
+  }
+  ///デストラクタ
+  ~RobotManager()
+  {
+    std::cout << "RobotManager デストラクタ" << std::endl;
+    stop();
+  }
+  bool add(Robot &robot, std::string port, int interval);
+  bool start();
+  void stop();
+  ///
+  ///@brief 登録したRobotの数を返す
+  ///
+  size_t size() const
+  {
+    return m_entries.size();
+  }
+  ///
+  ///@brief 登録したRobotを返す
+  ///@param[in] i 登録した順番
+  ///
+  Robot &operator[](size_t i)
+  {
+    return *m_entries[i].robot;
+  }
+};
+
+} //namespace odens
+
+///@} doxygenのためのコメント（消してはいけない）
@@ -0,0 +1,408 @@
+﻿///
+///@file robotprotocol.h
+///@brief ロボットの通信規約の記述子からパケットの符号化とRobotクラスを作るテンプレート
+///@par Copyright
+/// Copyright (C) 2026 Team ODENS, Masutani Lab, Osaka Electro-Communication University
+///@par 履歴
+///- 2026/10/18 升谷 保博 新規作成（通信規約の記述子からのパケット生成）
+///@addtogroup robot
+///@{
+///
+///- ロボットの種類ごとに通信規約の記述子（構造体）を1つ書けば，パケットの符号化と検査，
+///  応答の区切り，シリアルポートの設定，コマンドの文字列の表をこのテンプレートが作る．
+///- 記述子に必要なメンバ（ric30.hなどを参照）
+///  - CommandType: コマンドの列挙型，commandNum: コマンドの数
+///  - size: パケットの長さ，base(): 固定のバイトとアナログの中立値を並べたパケット
+///  - buttonPos, buttonFormat, buttonsNone: ボタンの位置，形式，何も押さない値
+///  - analogPos, analogNum: アナログ値の位置と数（0～4）
+///  - checksum, checksumPos: チェックサムの種類と位置
+///  - baudRate, parity: シリアルポートの設定，reply: 応答の形式
+///  - motionForward, motionStrafe, motionTurn, motionSign: 連続値の移動指令を割り当てるアナログ値の番号
+///    （-1なら対応しない）と向き
+///  - name(), table(), names(): 種類の名前，パケットの表，コマンドの文字列の表
+///- 関数はVisual Studio 2015で使えるC++11のconstexpr関数（returnだけ）で書いている．
+///
+
+#pragma once
+#include <iostream>
+#include <algorithm>
+#include <cstdint>
+#include <boost/asio.hpp>
+#include "robot.h"
+
+namespace odens {
+
+///
+///@brief パケットの中のボタンの状態の形式を表す列挙型
+///
+enum ButtonFormat {
+  ButtonBigEndian = 0, ///<上位，下位の2byte（RIC30，RCB-4）
+  ButtonInvertedPairs, ///<下位，~下位，上位，~上位の4byte（ROBOTIS）
+  ButtonFormatNOI      ///<項目数
+};
+
+///
+///@brief パケットのチェックサムの種類を表す列挙型
+///
+enum ChecksumType {
+  ChecksumNone = 0, ///<なし（固定のバイトだけを検査する）
+  ChecksumSum8,     ///<checksumPosより前の全てのバイトの和の下位8bit
+  ChecksumTypeNOI   ///<項目数
+};
+
+///
+///@brief ロボットからの応答の形式を表す列挙型
+///
+enum ReplyFormat {
+  ReplyFormatNone = 0, ///<応答を返さない
+  ReplyFormatRcb4,     ///<先頭が全体の長さ，末尾がSum8．送信ごとにACK（04 00 06 0a）かNAK（04 00 15 19）を返す
+  ReplyFormatEcho,     ///<送信と同じ形式のパケット（データを含む応答）
+  ReplyFormatNOI       ///<項目数
+};
+
+static_assert(PACKET_MAX_SIZE == 13, "encodePacket()はPACKET_MAX_SIZEが13であることを前提にしている");
+
+///
+///@brief 添字がボタンの状態のバイトか？
+///
+template <class D>
+constexpr bool isButtonByte(size_t i)
+{
+  return i >= D::buttonPos && i < D::buttonPos + (D::buttonFormat == ButtonBigEndian ? 2 : 4);
+}
+
+///
+///@brief 添字がアナログ値のバイトか？
+///
+template <class D>
+constexpr bool isAnalogByte(size_t i)
+{
+  return i >= D::analogPos && i < D::analogPos + D::analogNum;
+}
+
+///
+///@brief 添字がチェックサムのバイトか？
+///
+template <class D>
+constexpr bool isChecksumByte(size_t i)
+{
+  return D::checksum == ChecksumSum8 && i == D::checksumPos;
+}
+
+///
+///@brief 添字が固定のバイト（ヘッダやフッタなど，base()の値のまま）か？
+///
+template <class D>
+constexpr bool isFixedByte(size_t i)
+{
+  return !isButtonByte<D>(i) && !isAnalogByte<D>(i) && !isChecksumByte<D>(i);
+}
+
+///
+///@brief パケットの添字iのバイト（一時オブジェクトをconstで参照するための関数）
+///
+constexpr uint8_t packetByte(const Packet &p, size_t i)
+{
+  return p.b[i];
+}
+
+///
+///@brief 記述子Dの基本パケットの添字iのバイト
+///
+template <class D>
+constexpr uint8_t baseByte(size_t i)
+{
+  return packetByte(D::base(), i);
+}
+
+///
+///@brief ボタンの状態のバイトの値
+///@param[in] k ボタンの状態の中での位置
+///@param[in] c ボタンの状態を表す2byte
+///
+template <class D>
+constexpr uint8_t buttonByte(size_t k, uint16_t c)
+{
+  return static_cast<uint8_t>(D::buttonFormat == ButtonBigEndian
+    ? (k == 0 ? (c >> 8) : c)
+    : (k == 0 ? c : k == 1 ? ~c : k == 2 ? (c >> 8) : ~(c >> 8)));
+}
+
+///
+///@brief チェックサムを除くパケットのバイトの値
+///@param[in] i 添字
+///@param[in] c ボタンの状態を表す2byte
+///@param[in] a0 アナログ値0
+///@param[in] a1 アナログ値1
+///@param[in] a2 アナログ値2
+///@param[in] a3 アナログ値3
+///
+template <class D>
+constexpr uint8_t payloadByte(size_t i, uint16_t c, uint8_t a0, uint8_t a1, uint8_t a2, uint8_t a3)
+{
+  return i >= D::size ? 0
+    : isButtonByte<D>(i) ? buttonByte<D>(i - D::buttonPos, c)
+    : isAnalogByte<D>(i)
+      ? (i - D::analogPos == 0 ? a0 : i - D::analogPos == 1 ? a1 : i - D::analogPos == 2 ? a2 : a3)
+    : baseByte<D>(i);
+}
+
+///
+///@brief 添字firstからlastの前までのpayloadByte()の和の下位8bit
+///
+template <class D>
+constexpr uint8_t payloadSum(size_t first, size_t last, uint16_t c, uint8_t a0, uint8_t a1, uint8_t a2, uint8_t a3)
+{
+  return first >= last ? 0
+    : static_cast<uint8_t>(payloadByte<D>(first, c, a0, a1, a2, a3) + payloadSum<D>(first+1, last, c, a0, a1, a2, a3));
+}
+
+///
+///@brief パケットのバイトの値（チェックサムを含む）
+///
+template <class D>
+constexpr uint8_t encodedByte(size_t i, uint16_t c, uint8_t a0, uint8_t a1, uint8_t a2, uint8_t a3)
+{
+  return isChecksumByte<D>(i) ? payloadSum<D>(0, i, c, a0, a1, a2, a3) : payloadByte<D>(i, c, a0, a1, a2, a3);
+}
+
+///
+///@brief 記述子Dに従ってパケットを作る（コンパイル時に計算できる）
+///@param[in] c ボタンの状態を表す2byte
+///@param[in] a0 アナログ値0
+///@param[in] a1 アナログ値1
+///@param[in] a2 アナログ値2
+///@param[in] a3 アナログ値3
+///@return パケットのバイト列
+///
+template <class D>
+constexpr Packet encodePacket(uint16_t c, uint8_t a0, uint8_t a1, uint8_t a2, uint8_t a3)
+{
+  return Packet{{{
+    encodedByte<D>(0, c, a0, a1, a2, a3), encodedByte<D>(1, c, a0, a1, a2, a3),
+    encodedByte<D>(2, c, a0, a1, a2, a3), encodedByte<D>(3, c, a0, a1, a2, a3),
+    encodedByte<D>(4, c, a0, a1, a2, a3), encodedByte<D>(5, c, a0, a1, a2, a3),
+    encodedByte<D>(6, c, a0, a1, a2, a3), encodedByte<D>(7, c, a0, a1, a2, a3),
+    encodedByte<D>(8, c, a0, a1, a2, a3), encodedByte<D>(9, c, a0, a1, a2, a3),
+    encodedByte<D>(10, c, a0, a1, a2, a3), encodedByte<D>(11, c, a0, a1, a2, a3),
+    encodedByte<D>(12, c, a0, a1, a2, a3)}}, D::size};
+}
+
+///
+///@brief パケットの添字i以降が記述子Dに従っているか？（コンパイル時に計算できる）
+///
+///- 固定のバイト，チェックサム，反転したボタンのバイトを検査する．
+///
+template <class D>
+constexpr bool isProtocolPacketFrom(const Packet &p, size_t i)
+{
+  return i >= D::size ? p.size == D::size
+    : (!isFixedByte<D>(i) || p.b[i] == baseByte<D>(i))
+    && (!isChecksumByte<D>(i) || p.b[i] == packetSum(p, 0, i))
+    && (!(D::buttonFormat == ButtonInvertedPairs && isButtonByte<D>(i) && (i - D::buttonPos) % 2 == 1)
+      || p.b[i] == static_cast<uint8_t>(~p.b[i-1]))
+    && isProtocolPacketFrom<D>(p, i+1);
+}
+
+///
+///@brief パケットが記述子Dに従っているか？（コンパイル時に計算できる）
+///
+template <class D>
+constexpr bool isProtocolPacket(const Packet &p)
+{
+  return isProtocolPacketFrom<D>(p, 0);
+}
+
+///
+///@brief パケットの表の添字i以降の全ての要素が記述子Dに従っているか？（コンパイル時の検査用）
+///@param[in] table パケットの表
+///@param[in] n 表の要素数
+///@param[in] i 調べ始める添字
+///
+template <class D>
+constexpr bool isProtocolPacketTable(const Packet *table, size_t n, size_t i = 0)
+{
+  return i >= n || (isProtocolPacket<D>(table[i]) && isProtocolPacketTable<D>(table, n, i+1));
+}
+
+///
+///@brief RCB-4の応答全体が届いていてチェックサムが合うか？
+///@param[in] data 受信したバイト列
+///@param[in] size dataの長さ
+///
+inline bool isCompleteRcb4Reply(const uint8_t *data, size_t size)
+{
+  size_t n = (size > 0) ? data[0] : 0;
+  if (n < 4 || n > ROBOT_REPLY_MAX_SIZE || size < n) {
+    return false;
+  }
+  uint8_t sum = 0;
+  for (size_t i = 0; i < n-1; i++) {
+    sum += data[i];
+  }
+  return sum == data[n-1];
+}
+
+///
+///@brief RCB-4からの応答を1つ区切る
+///@param[in] data 受信したバイト列
+///@param[in] size dataの長さ
+///@param[out] reply 区切った応答
+///@return 使ったバイト数（0ならまだ応答全体が届いていない）
+///
+///- 先頭が全体の長さ，末尾がそれまでの和の下位8bitのチェックサム．
+///- 送信しているCOM→RAMの転送には[04 00 06 0a]（ACK）か[04 00 15 19]（NAK）が返る．
+///- 紛れ込んだ1byteを長さと取り違えて待ち続けないように，全体が届くのを待つ間も
+///  次のバイトから完全な応答が始まっていれば先頭を読み捨てる．
+///
+inline size_t parseRcb4Reply(const uint8_t *data, size_t size, RobotReply &reply)
+{
+  reply.type = ReplyNone;
+  reply.size = 0;
+  size_t n = data[0];
+  if (n < 4 || n > ROBOT_REPLY_MAX_SIZE) {
+    return 1; //長さとしてありえないので1byte読み捨てる
+  }
+  if (size < n) {
+    return isCompleteRcb4Reply(data+1, size-1) ? 1 : 0;
+  }
+  if (!isCompleteRcb4Reply(data, size)) {
+    return 1; //チェックサムが合わないので1byte読み捨てる
+  }
+  std::copy(data, data+n, reply.b.begin());
+  reply.size = n;
+  if (n == 4 && data[2] == 0x06) {
+    reply.type = ReplyAck;
+  } else if (n == 4 && data[2] == 0x15) {
+    reply.type = ReplyNak;
+  } else {
+    reply.type = ReplyData;
+  }
+  return n;
+}
+
+///
+///@brief 送信と同じ形式の応答を1つ区切る
+///@param[in] data 受信したバイト列
+///@param[in] size dataの長さ
+///@param[out] reply 区切った応答
+///@return 使ったバイト数（0ならまだ応答全体が届いていない）
+///
+///- 届いた分だけ固定のバイトを先に調べて，合わなければ1byte読み捨てる．値の意味はロボット側のプログラムで決める．
+///
+template <class D>
+size_t parseEchoReply(const uint8_t *data, size_t size, RobotReply &reply)
+{
+  reply.type = ReplyNone;
+  reply.size = 0;
+  for (size_t i = 0; i < size && i < D::size; i++) {
+    if (isFixedByte<D>(i) && data[i] != baseByte<D>(i)) {
+      return 1;
+    }
+  }
+  if (size < D::size) {
+    return 0;
+  }
+  Packet p = Packet();
+  std::copy(data, data+D::size, p.b.begin());
+  p.size = D::size;
+  if (!isProtocolPacket<D>(p)) {
+    return 1;
+  }
+  std::copy(data, data+D::size, reply.b.begin());
+  reply.size = D::size;
+  reply.type = ReplyData;
+  return D::size;
+}
+
+///
+///@brief 通信規約の記述子Dに従ってロボットへコマンドを送信するクラス
+///
+template <class D>
+class ProtocolRobot : public Robot {
+private:
+  ///
+  ///@brief パケットの表とコマンドの文字列の表を設定する
+  ///@return なし
+  ///
+  void initializePacket()
+  {
+    std::cout << D::name() << "::initializePacket()" << std::endl;
+    m_packetTable = D::table();
+    m_packetNum = D::commandNum;
+    m_commandStringTable = D::names();
+  }
+  ///
+  ///@brief 応答を1つ区切る（形式は記述子のreplyで決まる）
+  ///@param[in] data 受信したバイト列
+  ///@param[in] size dataの長さ
+  ///@param[out] reply 区切った応答
+  ///@return 使ったバイト数（0ならまだ応答全体が届いていない）
+  ///
+  size_t parseReply(const uint8_t *data, size_t size, RobotReply &reply)
+  {
+    switch (D::reply) {
+    case ReplyFormatRcb4:
+      return parseRcb4Reply(data, size, reply);
+    case ReplyFormatEcho:
+      return parseEchoReply<D>(data, size, reply);
+    default:
+      return Robot::parseReply(data, size, reply);
+    }
+  }
+  ///
+  ///@brief 送信するたびにACKを返すか？
+  ///
+  bool expectsAck() const
+  {
+    return D::reply == ReplyFormatRcb4;
+  }
+  ///
+  ///@brief 連続値の移動指令をアナログ値にしたパケットを作る
+  ///@param[in] q 前進，横移動，旋回の量子化された値（-ROBOT_MOTION_SCALE～ROBOT_MOTION_SCALE）
+  ///@param[out] packet パケット
+  ///@retval false 正常終了
+  ///@retval true 異常終了（対応していない）
+  ///
+  ///- 記述子で割り当てたアナログ値を中立値からmotionSign×qだけずらす．ボタンは押さない．
+  ///
+  bool makeMotionPacket(const int q[3], Packet &packet) const
+  {
+    if (!supportsMotion()) {
+      return true;
+    }
+    const Packet base = D::base();
+    uint8_t a[4] = {0, 0, 0, 0};
+    for (size_t k = 0; k < D::analogNum; k++) {
+      a[k] = base.b[D::analogPos + k];
+    }
+    const int index[3] = {D::motionForward, D::motionStrafe, D::motionTurn};
+    for (int i = 0; i < 3; i++) {
+      if (index[i] >= 0) {
+        a[index[i]] = static_cast<uint8_t>(a[index[i]] + D::motionSign*q[i]);
+      }
+    }
+    packet = encodePacket<D>(D::buttonsNone, a[0], a[1], a[2], a[3]);
+    return false;
+  }
+
+public:
+  ///コンストラクタ
+  ProtocolRobot()
+  {
+    std::cout << D::name() << " コンストラクタ" << std::endl;
+    m_baud_rate = D::baudRate;
+    m_parity = D::parity;
+  }
+  ///
+  ///@brief 連続値の移動指令に対応しているか？（記述子で前進を割り当てていれば対応する）
+  ///
+  bool supportsMotion() const
+  {
+    return D::motionForward >= 0;
+  }
+};
+
+} //namespace odens
+
+///@} doxygenのためのコメント（消してはいけない）
@@ -113,6 +113,29 @@ struct Orthogonal
   friend std::ostream& operator<<(std::ostream& os, const Orthogonal& p);
 };
 
+///
+///@brief 推定位置の新しさと不確かさを保持する構造体
+///
+///- Estimatorの推定結果でのみ意味を持つ（ビジョンから得たままのsrInfoでは値は不定）．
+///- 見えていない物体の信頼度は0．
+///
+struct Uncertainty
+{
+  double age;        ///<最後に観測されてからの時間 [s]（0ならば今回観測された）
+  double confidence; ///<信頼度（0～1）
+  double cxx;        ///<位置の共分散のxx成分 [mm^2]
+  double cxy;        ///<位置の共分散のxy成分 [mm^2]
+  double cyy;        ///<位置の共分散のyy成分 [mm^2]
+
+  ///
+  ///@brief 見えていないことにする
+  ///
+  void vanish()
+  {
+    age = 0; confidence = 0; cxx = cxy = cyy = 0;
+  }
+};
+
 ///
 ///@brief フィールドの全ての物体の位置情報を保持する構造体
 ///
@@ -122,6 +145,23 @@ struct srInfo
   Orthogonal robot[2][MAX_ROBOT_NUM+1]; ///<ロボット位置（0番要素は不使用）
   bool       id[2][MAX_ROBOT_NUM+1];    ///<ロボット番号が得られているか？（0番要素は不使用）
   double     time;                      ///<データ取得時刻
+  Uncertainty ballUncertainty;                      ///<ボール位置の不確かさ（推定結果のみ）
+  Uncertainty robotUncertainty[2][MAX_ROBOT_NUM+1]; ///<ロボット位置の不確かさ（推定結果のみ，0番要素は不使用）
+
+  ///全ての物体を不可視にする
+  void vanish()
+  {
+    ball.vanish();
+    ballUncertainty.vanish();
+    for (int i=0; i<2; i++) {
+      for (int j=0; j<=MAX_ROBOT_NUM; j++) {
+        robot[i][j].vanish();
+        id[i][j] = false;
+        robotUncertainty[i][j].vanish();
+      }
+    }
+    time = 0;
+  }
 };
 
 ///
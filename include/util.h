@@ -38,6 +38,7 @@ double absmin(double x,double y);             //絶対値の小さい方を返
 // キーボード入力
 void inkeyInitialize();     //inkey()関数を初期化して使用できるようにする
 int  inkey();               //キーボードからの入力を受け取る
+void inkeyTerminate();      //inkey()関数の後始末
 
 // 時計関係
 void   getTimeInitialize(); //getTime()関数を初期化して使用できるようにする
@@ -18,6 +18,7 @@
 #include <boost/thread/condition_variable.hpp>
 #include <boost/asio.hpp>
 #include "sr.h"
+#include "notifier.h"
 
 namespace odens {
 
@@ -34,14 +35,21 @@ private:
   boost::asio::ip::udp::socket m_socket;  ///<通信のためのソケット
   VisionInfo m_visionInfo;                ///<得られた位置情報（排他制御の対象）
   bool m_active;                          ///<通信の状態を表すフラグ
+  bool m_updated;                         ///<まだ取り出していない新しい情報があるか？（排他制御の対象）
+  int m_prevFrameNumber;                  ///<前回get()で得たフレーム番号
+  Notifier *m_notifier;                   ///<新しい情報を通知する先（なければnullptr）
 
   void main();
+  int take(VisionInfo &info);
 
 public:
   ///コンストラクタ
   Vision()
     :m_io(),
-    m_socket(m_io)
+    m_socket(m_io),
+    m_updated(false),
+    m_prevFrameNumber(0),
+    m_notifier(nullptr)
   {
     std::cout << "Visionコンストラクタ" << std::endl;
   }
@@ -56,6 +64,14 @@ public:
   }
   bool start(std::string address, int port);
   int get(VisionInfo &info);
+  int tryGet(VisionInfo &info);
+  ///
+  ///@brief 新しい情報を受信したときの通知先を設定する（start()の前に呼ぶ）
+  ///
+  void setNotifier(Notifier *notifier)
+  {
+    m_notifier = notifier;
+  }
 };
 
 } //namespace odens
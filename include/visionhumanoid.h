@@ -71,8 +71,22 @@ public:
     }
   }
   int get(srInfo &sinfo, VisionInfo &vinfo);
+  int tryGet(srInfo &sinfo, VisionInfo &vinfo);
+  ///新しいフレームを受信したときの通知先の設定（start()の前に呼ぶ）
+  void setNotifier(Notifier *notifier)
+  {
+    m_vision.setNotifier(notifier);
+  }
+  ///ビジョンの座標系の位置（レフェリーの指定位置など）を変換する
+  Orthogonal convertPosition(const Orthogonal &v)
+  {
+    Orthogonal p;
+    convert(p, v, true);
+    return p;
+  }
 private:
   void convert(Orthogonal &p, const Orthogonal &v, bool notheta);
+  void convertInfo(srInfo &sinfo, VisionInfo &vinfo, const VisionInfo &oinfo);
 };
 
 } //namespace odens
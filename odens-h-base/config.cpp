@@ -32,16 +32,24 @@ int     Config::MyColor = BLUE;
 bool    Config::Pause = true;
 bool    Config::Goalie = false;
 string  Config::RobotPortName = "COM7";
+bool    Config::RobotReceive = false;
+bool    Config::ParametricMotion = false;
+bool    Config::MotionScheduler = false;
 string  Config::VisionAddress = "224.5.23.2";
 int     Config::VisionPortNumber = 10006;
 bool    Config::Referee = true;
 string  Config::RefereeAddress = "224.5.23.1";
 int     Config::RefereePortNumber = 10003;  
+double  Config::RefereeTimeout = 1.0;
+double  Config::SetPlayTimeout = 20;
+double  Config::BallMovedDistance = 100;
+double  Config::InterceptWalkSpeed = 0;
 int     Config::Quadrant = 0;
 bool    Config::AttackRight = true;
 int     Config::OurMarkerTable[MAX_ROBOT_NUM+1] = {0,0,1,2};
 int     Config::TheirMarkerTable[MAX_ROBOT_NUM+1] = {0,3,4,5};
 bool    Config::Logger = false;
+EstimatorParameter Config::EstimatorParam;
 
 ///
 ///@brief コマンドラインと設定ファイルによって変数を設定する
@@ -77,16 +85,47 @@ bool Config::setup(int argc, char* argv[])
     ("Pause", value<bool>(), "一時停止で開始")
     ("Goalie", value<bool>(), "ゴールキーパー")
     ("RobotPortName", value<string>(), "シリアルポートの名前")
+    ("RobotReceive", value<bool>(), "ロボットからの応答を受信する")
+    ("ParametricMotion", value<bool>(), "移動に連続値の移動指令を使う（RIC30）")
+    ("MotionScheduler", value<bool>(), "コマンドの切り替えを動作の区切りまで保留する")
     ("VisionAddress", value<string>(), "ビジョンのマルチキャストアドレス")
     ("VisionPortNumber", value<int>(), "ビジョンのポート番号")
     ("Referee", value<bool>(), "レフェリーを使う")
     ("RefereeAddress", value<string>(), "レフェリーのマルチキャストアドレス")
     ("RefereePortNumber", value<int>(), "レフェリーのポート番号")
+    ("RefereeTimeout", value<double>(), "レフェリーの受信が途絶えたとみなす時間 [s]")
+    ("SetPlayTimeout", value<double>(), "セットプレーを打ち切ってInPlayにする時間 [s]")
+    ("BallMovedDistance", value<double>(), "相手のセットプレーでボールが動いたとみなす距離 [mm]")
+    ("InterceptWalkSpeed", value<double>(), "転がるボールの迎撃点を求めるときのロボットの歩く速さ [mm/s]（0なら迎撃点を使わない）")
     ("Quadrant", value<int>(), "SSL Visionの象限-1")
     ("AttackRight", value<bool>(), "右へ攻める")
     ("OurMarkerTable", value<string>(), "自チームロボットのマーカ番号対応")
     ("TheirMarkerTable", value<string>(), "相手チームロボットのマーカ番号対応")
     ("Logger", value<bool>(), "ログを取るか？")
+    ("Estimator.BallWindow", value<double>(), "ボールのデータを保持する時間 [s]")
+    ("Estimator.BallMinSamples", value<int>(), "直線を当てはめるのに必要なデータの数")
+    ("Estimator.BallVelocityFloor", value<double>(), "これより遅い速度は0とみなす [mm/s]")
+    ("Estimator.BallErrorDistance", value<double>(), "推定値との隔たりが大きいとみなす距離 [mm]")
+    ("Estimator.BallErrorLimit", value<int>(), "隔たりがこの回数を超えて続いたらボールが動いたとみなす")
+    ("Estimator.BallFitIteration", value<int>(), "ボールの当てはめで重みを計算し直す回数の上限")
+    ("Estimator.BallHuberDistance", value<double>(), "ボールの当てはめで重みを下げ始める残差 [mm]")
+    ("Estimator.BallRejectDistance", value<double>(), "ボールの当てはめで除外する残差 [mm]")
+    ("Estimator.BallHoldTime", value<double>(), "見えなくなったボールを保持する時間 [s]")
+    ("Estimator.BallFilterDelay", value<double>(), "パーティクルフィルタに切り替えるまでの時間 [s]")
+    ("Estimator.BallParticleFilter", value<bool>(), "隠れている間にパーティクルフィルタを使う")
+    ("Estimator.KickResidual", value<double>(), "蹴られたとみなす予測からの残差 [mm]")
+    ("Estimator.KickSpeed", value<double>(), "蹴られたとみなす速さの下限 [mm/s]")
+    ("Estimator.MaxBallSpeed", value<double>(), "ボールの速さの上限 [mm/s]")
+    ("Estimator.RollingSpeed", value<double>(), "転がっているとみなす速さ [mm/s]")
+    ("Estimator.KickDuration", value<double>(), "蹴られた状態を続ける時間 [s]")
+    ("Estimator.HeldDistance", value<double>(), "ロボットが保持しているとみなす距離 [mm]")
+    ("Estimator.RobotHoldTime", value<double>(), "見えなくなったロボットを保持する時間 [s]")
+    ("Estimator.RobotJumpDistance", value<double>(), "番号付きのロボットが1フレームで動ける距離 [mm]")
+    ("Estimator.BallPositionNoise", value<double>(), "ボールの観測の誤差の標準偏差 [mm]")
+    ("Estimator.BallDriftSpeed", value<double>(), "見えていないボールの位置の誤差が増える速さ [mm/s]")
+    ("Estimator.RobotPositionNoise", value<double>(), "ロボットの観測の誤差の標準偏差 [mm]")
+    ("Estimator.RobotDriftSpeed", value<double>(), "見えていないロボットの位置の誤差が増える速さ [mm/s]")
+    ("Estimator.ConfidenceDistance", value<double>(), "信頼度が0.5になる位置の標準偏差 [mm]")
     ;
   } catch(exception& e) {
     cerr << e.what() << endl;
@@ -149,6 +188,15 @@ bool Config::setup(int argc, char* argv[])
   if (vm2.count("RobotPortName")) {
     RobotPortName= vm2["RobotPortName"].as<string>();
   }
+  if (vm2.count("RobotReceive")) {
+    RobotReceive = vm2["RobotReceive"].as<bool>();
+  }
+  if (vm2.count("ParametricMotion")) {
+    ParametricMotion = vm2["ParametricMotion"].as<bool>();
+  }
+  if (vm2.count("MotionScheduler")) {
+    MotionScheduler = vm2["MotionScheduler"].as<bool>();
+  }
   if (vm2.count("VisionAddress")) {
     VisionAddress= vm2["VisionAddress"].as<string>();
   }
@@ -164,6 +212,18 @@ bool Config::setup(int argc, char* argv[])
   if (vm2.count("RefereePortNumber")) {
     RefereePortNumber = vm2["RefereePortNumber"].as<int>();
   }
+  if (vm2.count("RefereeTimeout")) {
+    RefereeTimeout = vm2["RefereeTimeout"].as<double>();
+  }
+  if (vm2.count("SetPlayTimeout")) {
+    SetPlayTimeout = vm2["SetPlayTimeout"].as<double>();
+  }
+  if (vm2.count("BallMovedDistance")) {
+    BallMovedDistance = vm2["BallMovedDistance"].as<double>();
+  }
+  if (vm2.count("InterceptWalkSpeed")) {
+    InterceptWalkSpeed = vm2["InterceptWalkSpeed"].as<double>();
+  }
   if (vm2.count("Quadrant")) {
     Quadrant = vm2["Quadrant"].as<int>();
   }
@@ -185,6 +245,81 @@ bool Config::setup(int argc, char* argv[])
   if (vm2.count("Logger")) {
     Logger = vm2["Logger"].as<bool>();
   }
+  if (vm2.count("Estimator.BallWindow")) {
+    EstimatorParam.ballWindow = vm2["Estimator.BallWindow"].as<double>();
+  }
+  if (vm2.count("Estimator.BallMinSamples")) {
+    EstimatorParam.ballMinSamples = vm2["Estimator.BallMinSamples"].as<int>();
+  }
+  if (vm2.count("Estimator.BallVelocityFloor")) {
+    EstimatorParam.ballVelocityFloor = vm2["Estimator.BallVelocityFloor"].as<double>();
+  }
+  if (vm2.count("Estimator.BallErrorDistance")) {
+    EstimatorParam.ballErrorDistance = vm2["Estimator.BallErrorDistance"].as<double>();
+  }
+  if (vm2.count("Estimator.BallErrorLimit")) {
+    EstimatorParam.ballErrorLimit = vm2["Estimator.BallErrorLimit"].as<int>();
+  }
+  if (vm2.count("Estimator.BallFitIteration")) {
+    EstimatorParam.ballFitIteration = vm2["Estimator.BallFitIteration"].as<int>();
+  }
+  if (vm2.count("Estimator.BallHuberDistance")) {
+    EstimatorParam.ballHuberDistance = vm2["Estimator.BallHuberDistance"].as<double>();
+  }
+  if (vm2.count("Estimator.BallRejectDistance")) {
+    EstimatorParam.ballRejectDistance = vm2["Estimator.BallRejectDistance"].as<double>();
+  }
+  if (vm2.count("Estimator.BallHoldTime")) {
+    EstimatorParam.ballHoldTime = vm2["Estimator.BallHoldTime"].as<double>();
+  }
+  if (vm2.count("Estimator.BallFilterDelay")) {
+    EstimatorParam.ballFilterDelay = vm2["Estimator.BallFilterDelay"].as<double>();
+  }
+  if (vm2.count("Estimator.BallParticleFilter")) {
+    EstimatorParam.ballParticleFilter = vm2["Estimator.BallParticleFilter"].as<bool>();
+  }
+  if (vm2.count("Estimator.KickResidual")) {
+    EstimatorParam.kickResidual = vm2["Estimator.KickResidual"].as<double>();
+  }
+  if (vm2.count("Estimator.KickSpeed")) {
+    EstimatorParam.kickSpeed = vm2["Estimator.KickSpeed"].as<double>();
+  }
+  if (vm2.count("Estimator.MaxBallSpeed")) {
+    EstimatorParam.maxBallSpeed = vm2["Estimator.MaxBallSpeed"].as<double>();
+  }
+  if (vm2.count("Estimator.RollingSpeed")) {
+    EstimatorParam.rollingSpeed = vm2["Estimator.RollingSpeed"].as<double>();
+  }
+  if (vm2.count("Estimator.KickDuration")) {
+    EstimatorParam.kickDuration = vm2["Estimator.KickDuration"].as<double>();
+  }
+  if (vm2.count("Estimator.HeldDistance")) {
+    EstimatorParam.heldDistance = vm2["Estimator.HeldDistance"].as<double>();
+  }
+  if (vm2.count("Estimator.RobotHoldTime")) {
+    EstimatorParam.robotHoldTime = vm2["Estimator.RobotHoldTime"].as<double>();
+  }
+  if (vm2.count("Estimator.RobotJumpDistance")) {
+    EstimatorParam.robotJumpDistance = vm2["Estimator.RobotJumpDistance"].as<double>();
+  }
+  if (vm2.count("Estimator.BallPositionNoise")) {
+    EstimatorParam.ballPositionNoise = vm2["Estimator.BallPositionNoise"].as<double>();
+  }
+  if (vm2.count("Estimator.BallDriftSpeed")) {
+    EstimatorParam.ballDriftSpeed = vm2["Estimator.BallDriftSpeed"].as<double>();
+  }
+  if (vm2.count("Estimator.RobotPositionNoise")) {
+    EstimatorParam.robotPositionNoise = vm2["Estimator.RobotPositionNoise"].as<double>();
+  }
+  if (vm2.count("Estimator.RobotDriftSpeed")) {
+    EstimatorParam.robotDriftSpeed = vm2["Estimator.RobotDriftSpeed"].as<double>();
+  }
+  if (vm2.count("Estimator.ConfidenceDistance")) {
+    EstimatorParam.confidenceDistance = vm2["Estimator.ConfidenceDistance"].as<double>();
+  }
+  if (EstimatorParam.check()) {
+    return true;
+  }
   //コマンドラインの設定の利用
   if (vm.count("num1")) {
     MyNumber = 1;
@@ -227,11 +362,18 @@ void Config::print()
   cout << "MyColor: " << makeString(MyColor==BLUE,"BLUE", "YELLOW") << endl;
   cout << "Goalie: " << makeString(Goalie, "true", "false") << endl;
   cout << "RobotPortName: " << RobotPortName << endl;
+  cout << "RobotReceive: " << makeString(RobotReceive, "true", "false") << endl;
+  cout << "ParametricMotion: " << makeString(ParametricMotion, "true", "false") << endl;
+  cout << "MotionScheduler: " << makeString(MotionScheduler, "true", "false") << endl;
   cout << "VisionAddress: " << VisionAddress << endl;
   cout << "VisionPortNumber: " << VisionPortNumber << endl;
   cout << "Referee: " << makeString(Referee, "true", "false") << endl;
   cout << "RefereeAddress: " << RefereeAddress << endl;
   cout << "RefereePortNumber: " << RefereePortNumber << endl;
+  cout << "RefereeTimeout: " << RefereeTimeout << endl;
+  cout << "SetPlayTimeout: " << SetPlayTimeout << endl;
+  cout << "BallMovedDistance: " << BallMovedDistance << endl;
+  cout << "InterceptWalkSpeed: " << InterceptWalkSpeed << endl;
   cout << "Quadrant: " << Quadrant << endl;
   cout << "AttackRight: " << makeString(AttackRight, "true", "false") << endl;
   for (int i=1; i<=MAX_ROBOT_NUM; i++) {
@@ -240,6 +382,7 @@ void Config::print()
   for (int i=1; i<=MAX_ROBOT_NUM; i++) {
     cout << "TheirMarkerTable[" << i << "]: " << TheirMarkerTable[i] << endl;
   }
+  EstimatorParam.print(cout);
 
 }
 
@@ -44,6 +44,7 @@
 #include <cmath>
 #include <vector>
 #include <cassert>
+#include <algorithm>
 #include <stdarg.h>
 #define DRAW_MAIN
 #include "draw.h"
@@ -166,15 +167,15 @@ void Draw::main()
       }
     } else if (drawMode == WithEstimation) {
       //ボールを描く
-      drawBall(si.ball, si2.ball);
+      drawBall(si.ball, si2.ball, si2.ballUncertainty);
       //各ロボットを描く
       for (int i = 1; i <= MAX_ROBOT_NUM; i++) {
         drawRobot(BLUE, i,
           si.robot[BLUE][i], si.id[BLUE][i],
-          si2.robot[BLUE][i], si2.id[BLUE][i]);
+          si2.robot[BLUE][i], si2.id[BLUE][i], si2.robotUncertainty[BLUE][i]);
         drawRobot(YELLOW, i,
           si.robot[YELLOW][i], si.id[YELLOW][i],
-          si2.robot[YELLOW][i], si2.id[YELLOW][i]);
+          si2.robot[YELLOW][i], si2.id[YELLOW][i], si2.robotUncertainty[YELLOW][i]);
       }
     } else if (drawMode == Vision) {
       //ボールを描く
@@ -323,10 +324,11 @@ Draw::drawBall(Orthogonal p)
 ///@brief     ボールの描画（推定値付き）
 ///@param[in] p ボールの位置
 ///@param[in] p2 ボールの位置の推定値
+///@param[in] u2 ボールの位置の推定値の不確かさ
 ///@return なし
 ///
 void
-Draw::drawBall(Orthogonal p, Orthogonal p2)
+Draw::drawBall(Orthogonal p, Orthogonal p2, const Uncertainty &u2)
 {
   if (p.isInvisible() && p2.isInvisible()) return;
   ::newrgbcolor(m_window,255,128,64);//描画色変更（オレンジ）
@@ -335,6 +337,7 @@ Draw::drawBall(Orthogonal p, Orthogonal p2)
   }
   if (!p2.isInvisible()) {
     ::drawarc(m_window,(float)p2.x,(float)p2.y,BALL_RADIUS*1.5,BALL_RADIUS*1.5,0,360,1);
+    drawUncertainty(p2, u2);
   }
   if(m_drawPos) {//座標表示
     int sign = (m_positiveIsRightSide ? 1 : -1);
@@ -395,10 +398,11 @@ Draw::drawRobot(int color, int num, Orthogonal p, bool number)
 ///@param[in] number 番号を描画するか？
 ///@param[in] p2      位置（推定値）
 ///@param[in] number2 番号を描画するか？（推定値）
+///@param[in] u2      位置の不確かさ（推定値）
 ///@return なし
 ///
 void 
-Draw::drawRobot(int color, int num, Orthogonal p, bool number, Orthogonal p2, bool number2)
+Draw::drawRobot(int color, int num, Orthogonal p, bool number, Orthogonal p2, bool number2, const Uncertainty &u2)
 {
   if (p.isInvisible() && p2.isInvisible()) return;
   if (color == BLUE) {
@@ -411,6 +415,7 @@ Draw::drawRobot(int color, int num, Orthogonal p, bool number, Orthogonal p2, bo
   }
   if (!p2.isInvisible()) {
     ::drawarc(m_window,(float)p2.x,(float)p2.y,ROBOT_RADIUS,ROBOT_RADIUS,0,360,1);
+    drawUncertainty(p2, u2);
   }
 
   ::newrgbcolor(m_window,0,0,0);//描画色変更（黒）
@@ -442,6 +447,39 @@ Draw::drawRobot(int color, int num, Orthogonal p, bool number, Orthogonal p2, bo
   }
 }
 
+///
+///@brief     推定位置の不確かさを誤差楕円で描画する
+///@param[in] p 推定位置
+///@param[in] u 不確かさ
+///@return なし
+///
+///- 共分散行列の固有値・固有ベクトルから2σの楕円を求め，折れ線で描く
+///  （::drawarcは軸に平行な楕円しか描けないため）．
+///- 信頼度が高いほど白に近く，低いほど赤に近い色で描く．
+///- 描画色は変更したままになる．
+///
+void
+Draw::drawUncertainty(Orthogonal p, const Uncertainty &u)
+{
+  const int SEGMENT_NUM = 24; //折れ線の分割数
+  if (p.isInvisible() || u.confidence <= 0) return;
+  //固有値（長軸と短軸の分散）と長軸の方向
+  double mean = (u.cxx+u.cyy)/2;
+  double diff = (u.cxx-u.cyy)/2;
+  double root = sqrt(diff*diff+u.cxy*u.cxy);
+  double a = 2*sqrt(std::max(mean+root, 0.0));
+  double b = 2*sqrt(std::max(mean-root, 0.0));
+  double angle = 0.5*atan2(2*u.cxy, u.cxx-u.cyy);
+  double c = cos(angle), s = sin(angle);
+  int level = (int)(255*u.confidence);
+  ::newrgbcolor(m_window,255,level,level);
+  for (int i=0; i<=SEGMENT_NUM; i++) {
+    double phi = 2*M_PI*i/SEGMENT_NUM;
+    double ex = a*cos(phi), ey = b*sin(phi);
+    ::line(m_window,(float)(p.x+c*ex-s*ey),(float)(p.y+s*ex+c*ey),(i == 0) ? PENUP : PENDOWN);
+  }
+}
+
 ///
 ///@brief ウィンドウに機体の座標を表示する
 ///@return なし
@@ -10,10 +10,134 @@
 ///@{
 ///
 
+#include <algorithm>
+#include <iostream>
 #include "estimator.h"
+#include "particlefilter.h"
 
 namespace odens {
 
+///
+///@brief 規定値を設定するコンストラクタ
+///
+///- いずれも手で決めた値で，要検討（estimator-tunerで調整できる）．
+///
+EstimatorParameter::EstimatorParameter()
+{
+  ballWindow = 1.0;
+  ballMinSamples = 3;
+  ballVelocityFloor = 10;
+  ballErrorDistance = 100;
+  ballErrorLimit = 1;
+  ballFitIteration = 3;
+  ballHuberDistance = 20;
+  ballRejectDistance = 100;
+  ballHoldTime = 10.0;
+  ballFilterDelay = 0.3;
+  ballParticleFilter = false;
+  kickResidual = 30;
+  kickSpeed = 300;
+  maxBallSpeed = 8000;
+  rollingSpeed = 50;
+  kickDuration = 0.5;
+  heldDistance = ROBOT_RADIUS+BALL_RADIUS+50;
+  robotHoldTime = 1.0;
+  robotJumpDistance = 240;
+  ballPositionNoise = 5;
+  ballDriftSpeed = 300;
+  robotPositionNoise = 10;
+  robotDriftSpeed = 300;
+  confidenceDistance = 50;
+}
+
+///
+///@brief 値が範囲内か調べる
+///@retval false 全て範囲内
+///@retval true 範囲外の値がある（どれかをcerrに表示する）
+///
+///- 当てはめに使うデータの数や回数が負になると，update()で空のballDequeを参照してしまう．
+///
+bool EstimatorParameter::check() const
+{
+  bool error = false;
+  if (!(ballWindow > 0)) {
+    std::cerr << "Estimator.BallWindow 範囲外の値: " << ballWindow << std::endl;
+    error = true;
+  }
+  if (ballMinSamples < 2) {
+    std::cerr << "Estimator.BallMinSamples 範囲外の値（2以上）: " << ballMinSamples << std::endl;
+    error = true;
+  }
+  if (ballErrorLimit < 0) {
+    std::cerr << "Estimator.BallErrorLimit 範囲外の値（0以上）: " << ballErrorLimit << std::endl;
+    error = true;
+  }
+  if (ballFitIteration < 0) {
+    std::cerr << "Estimator.BallFitIteration 範囲外の値（0以上）: " << ballFitIteration << std::endl;
+    error = true;
+  }
+  if (!(ballHuberDistance > 0) || ballRejectDistance < ballHuberDistance) {
+    std::cerr << "Estimator.BallHuberDistance，BallRejectDistance 範囲外の値: "
+      << ballHuberDistance << "，" << ballRejectDistance << std::endl;
+    error = true;
+  }
+  return error;
+}
+
+///
+///@brief 設定ファイルの書式で出力する
+///@param[in] os 出力ストリーム
+///@return なし
+///
+///- 設定ファイルの最後に貼り付けて使う（[Estimator]の節になる）．
+///
+void EstimatorParameter::print(std::ostream &os) const
+{
+  os << "[Estimator]" << std::endl;
+  os << "BallWindow = " << ballWindow << std::endl;
+  os << "BallMinSamples = " << ballMinSamples << std::endl;
+  os << "BallVelocityFloor = " << ballVelocityFloor << std::endl;
+  os << "BallErrorDistance = " << ballErrorDistance << std::endl;
+  os << "BallErrorLimit = " << ballErrorLimit << std::endl;
+  os << "BallFitIteration = " << ballFitIteration << std::endl;
+  os << "BallHuberDistance = " << ballHuberDistance << std::endl;
+  os << "BallRejectDistance = " << ballRejectDistance << std::endl;
+  os << "BallHoldTime = " << ballHoldTime << std::endl;
+  os << "BallFilterDelay = " << ballFilterDelay << std::endl;
+  os << "BallParticleFilter = " << (ballParticleFilter ? "true" : "false") << std::endl;
+  os << "KickResidual = " << kickResidual << std::endl;
+  os << "KickSpeed = " << kickSpeed << std::endl;
+  os << "MaxBallSpeed = " << maxBallSpeed << std::endl;
+  os << "RollingSpeed = " << rollingSpeed << std::endl;
+  os << "KickDuration = " << kickDuration << std::endl;
+  os << "HeldDistance = " << heldDistance << std::endl;
+  os << "RobotHoldTime = " << robotHoldTime << std::endl;
+  os << "RobotJumpDistance = " << robotJumpDistance << std::endl;
+  os << "BallPositionNoise = " << ballPositionNoise << std::endl;
+  os << "BallDriftSpeed = " << ballDriftSpeed << std::endl;
+  os << "RobotPositionNoise = " << robotPositionNoise << std::endl;
+  os << "RobotDriftSpeed = " << robotDriftSpeed << std::endl;
+  os << "ConfidenceDistance = " << confidenceDistance << std::endl;
+}
+
+///
+///@brief コンストラクタ
+///
+///- ballFilterの破棄にBallParticleFilterの定義が必要なので，
+///  コンストラクタとデストラクタはここで定義する．
+///
+Estimator::Estimator()
+{
+  clear();
+}
+
+///
+///@brief デストラクタ
+///
+Estimator::~Estimator()
+{
+}
+
 ///
 ///@brief 保持している値をすべてクリア
 ///@return なし
@@ -22,10 +146,156 @@ void Estimator::clear()
 {
   ball.vanish();
   ballTime = 0;
-  for (int i=0; i<2; i++) {
+  prevBall.vanish();
+  prevBallVel = Timed2D(0,0,0);
+  ballOutlierRun = 0;
+  ballErrorCount = 0;
+  ballMotion = BallMotionNone;
+  ballKickTime = 0;
+  if (ballFilter) {
+    ballFilter->clear();
+  }
+  robotStateIndex = 0;
+  for (int k=0; k<ROBOT_SLOT_NUM; k++) {
+    robotState[0].x[k] = robotState[0].y[k] = robotState[0].theta[k] = INVISIBLE;
+    robotState[0].id[k] = 0;
+    robotState[0].time[k] = 0;
+  }
+}
+
+///
+///@brief 全ロボットの推定の本体（分岐のないループ）
+///@param[out] next 更新後の状態
+///@param[out] out 推定結果（timeは最後に観測した時刻，出力しないものは0）
+///@param[in] prev 更新前の状態
+///@param[in] obs 現在の観測
+///@param[in] ctime 現在の時刻
+///@param[in] holdTime 過去データを保持する時間 [s]
+///@param[in] jumpDistance2 飛びとみなす距離の2乗 [mm^2]
+///@return なし
+///
+///- 読み出しと書き込みの配列を分け，要素を全て先に読み出しておかないと，
+///  条件付きの読み書きとみなされてベクトル化されない．
+///
+static void estimateRobots(RobotStateArray &next, RobotStateArray &out,
+  const RobotStateArray &prev, const RobotStateArray &obs,
+  double ctime, double holdTime, double jumpDistance2)
+{
+  for (int k=0; k<ROBOT_SLOT_NUM; k++) {
+    const double sx = prev.x[k], sy = prev.y[k], sq = prev.theta[k];
+    const double sid = prev.id[k], st = prev.time[k];
+    const double ox = obs.x[k], oy = obs.y[k], oq = obs.theta[k];
+    const double oid = obs.id[k];
+    const double dx = ox - sx;
+    const double dy = oy - sy;
+    const bool seen = ox != INVISIBLE;
+    //過去データがあり，古くないか？
+    const bool fresh = (sx != INVISIBLE) & (ctime - st <= holdTime);
+    //過去データが新しく，idが真であり，現在データと離れているか？
+    const bool jump = fresh & (sid != 0) & (dx*dx + dy*dy > jumpDistance2);
+    //現在データを採用するか？
+    const bool accept = seen & !jump;
+    const double nx = accept ? ox : sx;
+    const double ny = accept ? oy : sy;
+    const double nq = accept ? oq : sq;
+    const double nid = accept ? oid : sid;
+    const double nt = accept ? ctime : st;
+    next.x[k] = nx;
+    next.y[k] = ny;
+    next.theta[k] = nq;
+    next.id[k] = nid;
+    next.time[k] = nt;
+    //採用したか，過去データが新しければ記憶している値を出力する
+    const bool output = accept | fresh;
+    out.x[k] = output ? nx : INVISIBLE;
+    out.y[k] = output ? ny : INVISIBLE;
+    out.theta[k] = output ? nq : INVISIBLE;
+    out.id[k] = output ? nid : 0;
+    out.time[k] = output ? nt : 0;
+  }
+}
+
+///
+///@brief 観測した時点の不確かさを返す
+///@param[in] noise 観測の誤差の標準偏差 [mm]
+///@return 不確かさ（共分散だけを設定し，ageUncertainty()で仕上げる）
+///
+static Uncertainty observed(double noise)
+{
+  Uncertainty u;
+  u.age = 0;
+  u.confidence = 1;
+  u.cxx = u.cyy = noise*noise;
+  u.cxy = 0;
+  return u;
+}
+
+///
+///@brief 観測されていない時間の分だけ共分散を増やし，信頼度を求める
+///@param[in,out] u 不確かさ（観測した時点の共分散を入れておく）
+///@param[in] age 最後に観測されてからの時間 [s]
+///@param[in] driftSpeed 位置の誤差が増える速さ [mm/s]
+///@param[in] confidenceDistance 信頼度が0.5になる位置の標準偏差 [mm]
+///@return なし
+///
+///- 信頼度は s^2/(s^2+σ^2)．sはconfidenceDistance，σ^2は共分散の対角成分の平均．
+///- 保持しているだけの古い値は共分散が大きくなるので，信頼度も自然に下がる．
+///
+static void ageUncertainty(Uncertainty &u, double age, double driftSpeed, double confidenceDistance)
+{
+  const double d2 = (driftSpeed*age)*(driftSpeed*age);
+  const double s2 = confidenceDistance*confidenceDistance;
+  u.age = age;
+  u.cxx += d2;
+  u.cyy += d2;
+  u.confidence = s2/(s2 + (u.cxx+u.cyy)/2);
+}
+
+///
+///@brief 全ロボットの位置をまとめて推定し保持している値を更新
+///@param[out] sinfo2 推定結果
+///@param[in] sinfo 現在の位置情報
+///@param[in] ctime 現在の時刻
+///@return なし
+///
+///- srInfoから成分ごとの配列へ並べ替え，分岐のないループで両チームを一度に処理し，書き戻す．
+///- 推定の本体 estimateRobots() はロボット間で依存がないので，コンパイラがベクトル化できる．
+///- 距離は2乗のまま比較するので，sqrtもOrthogonal::distance()のエラー出力もない．
+///- 不確かさは，観測の誤差に見えていない時間の分の誤差を加えたものとする．
+///
+void Estimator::updateRobots(srInfo &sinfo2, const srInfo &sinfo, double ctime)
+{
+  const double holdTime = param.robotHoldTime;
+  const double jumpDistance2 = param.robotJumpDistance*param.robotJumpDistance;
+
+  //srInfoから成分ごとの配列へ（0番要素は見えていないものとする）
+  const Orthogonal *obs = &sinfo.robot[0][0];
+  for (int k=0; k<ROBOT_SLOT_NUM; k++) {
+    const bool valid = (k % (MAX_ROBOT_NUM+1)) != 0;
+    robotObs.x[k] = valid ? obs[k].x : INVISIBLE;
+    robotObs.y[k] = obs[k].y;
+    robotObs.theta[k] = obs[k].theta;
+    robotObs.id[k] = (valid && (&sinfo.id[0][0])[k]) ? 1.0 : 0.0;
+  }
+
+  //分岐のない推定（全ロボット一括）
+  const int cur = robotStateIndex;
+  estimateRobots(robotState[1-cur], robotOut, robotState[cur], robotObs, ctime, holdTime, jumpDistance2);
+  robotStateIndex = 1-robotStateIndex;
+
+  //成分ごとの配列からsrInfoへ
+  for (int i=BLUE; i<=YELLOW; i++) {
     for (int j=1; j<=MAX_ROBOT_NUM; j++) {
-      robot[i][j].vanish();
-      robotTime[i][j] = 0;
+      const int k = i*(MAX_ROBOT_NUM+1)+j;
+      sinfo2.robot[i][j] = Orthogonal(robotOut.x[k], robotOut.y[k], robotOut.theta[k]);
+      sinfo2.id[i][j] = robotOut.id[k] != 0;
+      Uncertainty &u = sinfo2.robotUncertainty[i][j];
+      if (robotOut.x[k] == INVISIBLE) {
+        u.vanish();
+      } else {
+        u = observed(param.robotPositionNoise);
+        ageUncertainty(u, ctime - robotOut.time[k], param.robotDriftSpeed, param.confidenceDistance);
+      }
     }
   }
 }
@@ -41,53 +311,337 @@ void Estimator::clear()
 ///
 void Estimator::update(srInfo &sinfo2, const srInfo &sinfo, double ctime)
 {
+  //各ロボットの推定（パーティクルフィルタで隠すものとして使うので先に行う）
+  updateRobots(sinfo2, sinfo, ctime);
+
   //ボールの推定
+  Uncertainty &u = sinfo2.ballUncertainty;
   if (sinfo.ball.isInvisible()) {
     //見えていなければ
-    if (ball.isInvisible() || ctime-ballTime > 10.0) { //TODO 要検討
+    if (ball.isInvisible() || ctime-ballTime > param.ballHoldTime) {
       //過去データがないか，古ければ
       sinfo2.ball.vanish();
+      u.vanish();
     } else {
       //過去データがあり，古くなければ
       sinfo2.ball = ball;
+      u = observed(param.ballPositionNoise);
+      ageUncertainty(u, ctime-ballTime, param.ballDriftSpeed, param.confidenceDistance);
     }
   } else {
     //見えていれば，
     sinfo2.ball = sinfo.ball;
     ball = sinfo.ball;
     ballTime = ctime;
+    u = observed(param.ballPositionNoise);
+    ageUncertainty(u, 0, param.ballDriftSpeed, param.confidenceDistance);
+  }
+  Timed2D ball2(sinfo2.ball.x, sinfo2.ball.y, ctime);
+  Timed2D ballVel(0, 0, ctime);
+  if (updateBallFilter(ball2, ballVel, sinfo2, sinfo, ctime, 0)) {
+    sinfo2.ball = Orthogonal(ball2.x, ball2.y, 0);
+    filterUncertainty(u, ctime);
   }
+  sinfo2.time = sinfo.time;
+}
 
-  //各ロボットの推定
-  for (int i=BLUE; i<=YELLOW; i++) {
-    for (int j=1; j<=MAX_ROBOT_NUM; j++) {
-      if (sinfo.robot[i][j].isInvisible()) {
-        //見えていなければ
-        if (robot[i][j].isInvisible() || ctime-robotTime[i][j] > 1.0) { //TODO 1.0は要検討
-          //過去データがないか，古ければ
-          sinfo2.robot[i][j].vanish();
-          sinfo2.id[i][j] = false;
-        } else {
-          //過去データがあり，古くなければ
-          sinfo2.robot[i][j] = robot[i][j];
-          sinfo2.id[i][j] = id[i][j];
-        }
+
+///
+///@brief 隠れている間にパーティクルフィルタを使うかを設定する
+///@param[in] use 使うか？
+///@return なし
+///
+///- 使う場合は，ここで粒子の記憶領域を確保する．
+///
+void Estimator::setBallParticleFilter(bool use)
+{
+  if (use && !ballFilter) {
+    ballFilter.reset(new BallParticleFilter);
+  } else if (!use) {
+    ballFilter.reset();
+  }
+}
+
+///
+///@brief パーティクルフィルタを更新し，隠れていればその推定値を使う
+///@param[in,out] ball2 ボールの推定位置
+///@param[in,out] ballVel ボールの推定速度 [mm/s]
+///@param[in] sinfo2 ロボットの推定位置（ボールを隠すもの）
+///@param[in] sinfo 現在の位置情報
+///@param[in] ctime 現在の時刻
+///@param[in] fitTime 見えなくなってもball2をそのまま使う時間 [s]
+///@retval true パーティクルフィルタの推定値に置き換えた
+///@retval false 置き換えていない
+///
+///- 短い隠れでは直線の当てはめの外挿の方が正確なので，fitTimeを過ぎるまでは置き換えない．
+///
+bool Estimator::updateBallFilter(Timed2D &ball2, Timed2D &ballVel, const srInfo &sinfo2, const srInfo &sinfo, double ctime, double fitTime)
+{
+  if (!ballFilter) {
+    return false;
+  }
+  ballFilter->update(sinfo.ball, ballVel, sinfo2, ctime);
+  if (!sinfo.ball.isInvisible() || !ballFilter->isValid()) {
+    return false;
+  }
+  if (!ball2.isInvisible() && ctime-ballTime <= fitTime) {
+    return false;
+  }
+  Orthogonal b = ballFilter->getBall();
+  ball2 = Timed2D(b.x, b.y, ctime);
+  ballVel = ballFilter->getVelocity();
+  return true;
+}
+
+///
+///@brief パーティクルフィルタの推定値の不確かさを求める
+///@param[out] u 不確かさ
+///@param[in] ctime 現在の時刻
+///@return なし
+///
+///- 粒子の広がりが見えていない間の誤差を表しているので，時間の分の誤差は加えない．
+///
+void Estimator::filterUncertainty(Uncertainty &u, double ctime)
+{
+  ballFilter->getCovariance(u.cxx, u.cxy, u.cyy);
+  ageUncertainty(u, ctime-ballTime, 0, param.confidenceDistance);
+}
+
+///
+///@brief 保持しているボールのデータに直線を当てはめる（外れ値に頑健な重み付き最小二乗法）
+///@param[out] ball2 推定したボール位置
+///@param[out] ballVel 推定したボール速度 [mm/s]
+///@param[out] u 推定したボール位置の共分散（ageとconfidenceは設定しない）
+///@param[in] ctime 現在の時刻
+///@retval true 推定できた
+///@retval false 推定できない（データが縮退している）
+///
+///- 最初は全データを同じ重みで当てはめ，その後，残差に応じてHuberの重みで再計算する．
+///- 残差が ballRejectDistance を超えるデータは重み0として除外する．
+///- 再計算の回数は ballFitIteration 回までで，重みが変化しなくなれば打ち切る．
+///  0にすると従来の最小二乗法と同じになる．
+///- 共分散は，重み付き残差から求めた観測の誤差（ballPositionNoise以上）を
+///  現時刻の位置の推定値の分散に換算したもの．
+///- 計算し直した重みで縮退した場合は，前回の当てはめの結果とその重みを使う．
+///
+bool Estimator::fitBall(Timed2D &ball2, Timed2D &ballVel, Uncertainty &u, double ctime)
+{
+  const size_t n = ballDeque.size();
+  ballWeight.assign(n, 1.0);
+  bool fitted = false;
+  double gain = 0; //観測の誤差の分散に対する現時刻の位置の分散の比
+  for (int iteration=0; ; iteration++) {
+    //最小二乗法 x = vx*(t-tc)+x0, y = vy*(t-tc)+y0
+    double stx =0, sty = 0, st = 0, sx = 0, sy =0, st2 = 0, sw = 0;
+    for (size_t i=0; i<n; i++) {
+      const Timed2D &b = ballDeque[i];
+      const double w = ballWeight[i];
+      double t = b.time-ctime; //現時刻を基準とする
+      stx += w*t*b.x;
+      sty += w*t*b.y;
+      st += w*t;
+      sx += w*b.x;
+      sy += w*b.y;
+      st2 += w*t*t;
+      sw += w;
+    }
+    double det = sw*st2-st*st;
+    if (sw == 0 || det <= 1e-9*sw*sw) {
+      //前回の結果があればそれを使う（共分散も前回の重みで求める）
+      if (fitted) {
+        ballWeight.swap(ballWeightPrev);
+      }
+      break;
+    }
+    ball2.x = (st2*sx-stx*st)/det;
+    ball2.y = (st2*sy-sty*st)/det;
+    ballVel.x = (sw*stx-st*sx)/det;
+    ballVel.y = (sw*sty-st*sy)/det;
+    ballVel.time = ctime;
+    gain = st2/det;
+    if (ballVel.abs() < param.ballVelocityFloor) {
+      ball2.x = sx/sw;
+      ball2.y = sy/sw;
+      ballVel = Timed2D(0,0,ctime);
+      gain = 1/sw;
+    }
+    fitted = true;
+    if (iteration >= param.ballFitIteration) {
+      break;
+    }
+    //残差から重みを計算し直す
+    ballWeightPrev = ballWeight;
+    double change = 0;
+    for (size_t i=0; i<n; i++) {
+      const Timed2D &b = ballDeque[i];
+      double t = b.time-ctime;
+      double ex = b.x - (ball2.x + ballVel.x*t);
+      double ey = b.y - (ball2.y + ballVel.y*t);
+      double r = sqrt(ex*ex+ey*ey);
+      double w;
+      if (r <= param.ballHuberDistance) {
+        w = 1.0;
+      } else if (r <= param.ballRejectDistance) {
+        w = param.ballHuberDistance/r;
       } else {
-        //見えていれば，
-        if (!robot[i][j].isInvisible() && ctime-robotTime[i][j] <= 1.0 //TODO 1.0は要検討
-          && id[i][j] && robot[i][j].distance(sinfo.robot[i][j]) > 240 ) { //TODO 240は要検討
-          //過去データがあり，古くなく，idが真であり，現在データと離れていれば，
-          sinfo2.robot[i][j] = robot[i][j];
-          sinfo2.id[i][j] = id[i][j];
-        } else {
-          robot[i][j] = sinfo2.robot[i][j] = sinfo.robot[i][j];
-          id[i][j] = sinfo2.id[i][j] = sinfo.id[i][j];
-          robotTime[i][j] = ctime;
-        }
+        w = 0.0;
       }
+      change = std::max(change, std::abs(w - ballWeight[i]));
+      ballWeight[i] = w;
+    }
+    if (change < 1e-3) {
+      break;
     }
   }
-  sinfo2.time = sinfo.time;
+  if (fitted) {
+    double sw = 0, exx = 0, exy = 0, eyy = 0;
+    for (size_t i=0; i<n; i++) {
+      const Timed2D &b = ballDeque[i];
+      const double w = ballWeight[i];
+      double t = b.time-ctime;
+      double ex = b.x - (ball2.x + ballVel.x*t);
+      double ey = b.y - (ball2.y + ballVel.y*t);
+      sw += w;
+      exx += w*ex*ex;
+      exy += w*ex*ey;
+      eyy += w*ey*ey;
+    }
+    const double noise2 = param.ballPositionNoise*param.ballPositionNoise;
+    const double dof = std::max(sw-2, 1.0); //直線の2つの係数の分を引く
+    u.cxx = gain*std::max(exx/dof, noise2);
+    u.cxy = gain*exy/dof;
+    u.cyy = gain*std::max(eyy/dof, noise2);
+  }
+  return fitted;
+}
+
+///
+///@brief 外れ値に頑健なボールの当てはめの設定
+///@param[in] iteration 重みを計算し直す回数の上限（計算量の上限，0ならば通常の最小二乗法）
+///@param[in] huberDistance 重みを下げ始める残差 [mm]
+///@param[in] rejectDistance 除外する残差 [mm]
+///@retval false 正常終了
+///@retval true 異常終了（範囲外の値があるので変更しない）
+///
+bool Estimator::setBallFit(int iteration, double huberDistance, double rejectDistance)
+{
+  EstimatorParameter p = param;
+  p.ballFitIteration = iteration;
+  p.ballHuberDistance = huberDistance;
+  p.ballRejectDistance = rejectDistance;
+  if (p.check()) {
+    return true;
+  }
+  param.ballFitIteration = iteration;
+  param.ballHuberDistance = huberDistance;
+  param.ballRejectDistance = rejectDistance;
+  return false;
+}
+
+///
+///@brief 調整用パラメータを設定する
+///@param[in] p パラメータ
+///@retval false 正常終了
+///@retval true 異常終了（範囲外の値があるので変更しない）
+///
+bool Estimator::setParameter(const EstimatorParameter &p)
+{
+  if (p.check()) {
+    return true;
+  }
+  param = p;
+  setBallParticleFilter(param.ballParticleFilter);
+  return false;
+}
+
+///
+///@brief ボールが蹴られたことを検出する
+///@param[in] ball 現在のボールの観測
+///@param[in] ctime 現在の時刻
+///@retval true 蹴られた（ballDequeを蹴られた後のデータだけにした）
+///@retval false 蹴られていない
+///
+///- 前回の推定値から予測した位置との残差が2回続けて大きく，
+///  かつ最新の2データ間の速度が急に大きくなった（加速度の急変）場合に蹴られたと判断する．
+///- 距離100mmの判定（update()のballErrorCount）を待たずに，2フレームで反応する．
+///- 速度が大きすぎる場合は誤検出や置き直しとみなして何もしない．
+///
+bool Estimator::detectKick(const Timed2D &ball, double ctime)
+{
+  const double kickResidual = param.kickResidual;
+  const double kickSpeed = param.kickSpeed;
+  const double maxBallSpeed = param.maxBallSpeed;
+
+  if (ball.isInvisible() || prevBall.isInvisible()) {
+    ballOutlierRun = 0;
+    return false;
+  }
+  double dt = ctime - prevBall.time;
+  double ex = ball.x - (prevBall.x + prevBallVel.x*dt);
+  double ey = ball.y - (prevBall.y + prevBallVel.y*dt);
+  if (ex*ex+ey*ey > kickResidual*kickResidual) {
+    ballOutlierRun++;
+  } else {
+    ballOutlierRun = 0;
+  }
+  size_t n = ballDeque.size();
+  if (ballOutlierRun < 2 || n < 3) {
+    return false;
+  }
+  const Timed2D &b1 = ballDeque[n-2];
+  const Timed2D &b2 = ballDeque[n-1];
+  double speed = b2.distance(b1)/(b2.time-b1.time);
+  if (speed < kickSpeed || speed > maxBallSpeed) {
+    return false;
+  }
+  //蹴られる直前の1データと蹴られた後のデータだけを残す
+  size_t keep = std::min((size_t)ballOutlierRun+1, n);
+  ballDeque.erase(ballDeque.begin(), ballDeque.end() - keep);
+  ballOutlierRun = 0;
+  return true;
+}
+
+///
+///@brief ボールの運動の状態を判断する
+///@param[in] ball2 推定したボール位置
+///@param[in] ballVel 推定したボール速度 [mm/s]
+///@param[in] kicked 今回蹴られたと判断したか？
+///@param[in] ctime 現在の時刻
+///@return ボールの運動の状態
+///
+///- ロボットの推定位置（robotOut）が求められた後に呼ぶこと．
+///
+BallMotion Estimator::classifyBall(const Timed2D &ball2, const Timed2D &ballVel, bool kicked, double ctime)
+{
+  const double rollingSpeed = param.rollingSpeed;
+  const double kickDuration = param.kickDuration;
+  const double heldDistance = param.heldDistance;
+
+  if (ball2.isInvisible()) {
+    return BallMotionNone;
+  }
+  double speed = ballVel.abs();
+  if (kicked) {
+    ballKickTime = ctime;
+    return BallKicked;
+  }
+  if (ballMotion == BallKicked && ctime - ballKickTime < kickDuration && speed >= rollingSpeed) {
+    return BallKicked;
+  }
+  //最も近いロボットまでの距離の2乗（見えていないロボットは非常に遠くにあるとみなせる）
+  double d2 = heldDistance*heldDistance + 1;
+  for (int k=0; k<ROBOT_SLOT_NUM; k++) {
+    double dx = robotOut.x[k] - ball2.x;
+    double dy = robotOut.y[k] - ball2.y;
+    d2 = std::min(d2, dx*dx+dy*dy);
+  }
+  if (d2 <= heldDistance*heldDistance) {
+    return BallHeld;
+  }
+  if (speed >= rollingSpeed) {
+    return BallRolling;
+  }
+  return BallStopped;
 }
 
 ///
@@ -102,96 +656,89 @@ void Estimator::update(srInfo &sinfo2, const srInfo &sinfo, double ctime)
 ///
 void Estimator::update(srInfo &sinfo2, Timed2D &ballVel, const srInfo &sinfo, double ctime)
 {
-  static int errorCount = 0;
+  BallMotion motion;
+  update(sinfo2, ballVel, motion, sinfo, ctime);
+}
+
+///
+///@brief 位置を推定し保持している値を更新（ボール速度・運動状態推定版）
+///@param[out] sinfo2 推定結果
+///@param[out] ballVel ボールの推定速度 [mm/s]
+///@param[out] motion ボールの運動の状態
+///@param[in] sinfo 現在の位置情報
+///@param[in] ctime 現在の時刻
+///@return なし
+///
+///- ctimeではなく， sinfo.timeを使う方がいいかもしれない．
+///
+void Estimator::update(srInfo &sinfo2, Timed2D &ballVel, BallMotion &motion, const srInfo &sinfo, double ctime)
+{
+  //各ロボットの推定（ボールの運動状態の判断に使うので先に行う）
+  updateRobots(sinfo2, sinfo, ctime);
+
   Timed2D ball(sinfo.ball.x, sinfo.ball.y, ctime);
   //ボールの推定
   if (!ball.isInvisible()) {
     //見えていれば
     ballDeque.push_back(ball);
+    ballTime = ctime;
   }
   //古いデータを取り除く
   while (ballDeque.size() > 0) {
-    if (ctime - ballDeque.front().time <= 1.0) break; //TODO 1[s]は要検討
+    if (ctime - ballDeque.front().time <= param.ballWindow) break;
     ballDeque.pop_front();
   }
+  bool kicked = detectKick(ball, ctime);
   Timed2D ball2;
+  Uncertainty &u = sinfo2.ballUncertainty;
+  u = observed(param.ballPositionNoise);
   if (ballDeque.empty()) { //保持データがない場合
     ball2.vanish();
     ballVel = Timed2D(0,0,ctime);
-  } else if (ballDeque.size() < 3) { //保持データ最小値 要検討
+  } else if (ballDeque.size() < (size_t)param.ballMinSamples) { //保持データ最小値
+    ball2 = ballDeque.back();
+    ballVel = Timed2D(0,0,ctime);
+  } else if (!fitBall(ball2, ballVel, u, ctime)) {
     ball2 = ballDeque.back();
     ballVel = Timed2D(0,0,ctime);
   } else {
-    //最小二乗法 x = vx*(t-tc)+x0, y = vy*(t-tc)+y0
-    double stx =0, sty = 0, st = 0, sx = 0, sy =0, st2 = 0;
-    size_t n = ballDeque.size();
-    for (size_t i=0; i<n; i++) {
-      Timed2D &b = ballDeque[i];
-      double t = b.time-ctime; //現時刻を基準とする
-      stx += t*b.x;
-      sty += t*b.y;
-      st += t;
-      sx += b.x;
-      sy += b.y;
-      st2 += t*t;
+    //推定値との隔たりが連続して大きい回数を数える
+    //外れ値は重みが0になっているので，1回だけなら推定値は引きずられない．
+    if (!ball.isInvisible() && ball2.distance(ball) > param.ballErrorDistance) {
+      ballErrorCount++;
+    } else {
+      ballErrorCount = 0;
     }
-    double det = n*st2-st*st;
-    if (det==0) {
+  }
+  if (ballErrorCount > param.ballErrorLimit && !ballDeque.empty()) {
+    //隔たりが連続した場合はボールが実際に動いたとみなす．
+    //全てを捨てずに，連続した外れ値だけを残して直ちに推定し直す．
+    size_t keep = std::min((size_t)ballErrorCount, ballDeque.size());
+    ballDeque.erase(ballDeque.begin(), ballDeque.end() - keep);
+    ballErrorCount = 0;
+    u = observed(param.ballPositionNoise);
+    if (ballDeque.size() < (size_t)param.ballMinSamples || !fitBall(ball2, ballVel, u, ctime)) {
+      //残したデータが少なければ，当てはめずに最新の位置を使う
       ball2 = ballDeque.back();
       ballVel = Timed2D(0,0,ctime);
-    } else {
-      ball2.x = (st2*sx-stx*st)/det;
-      ball2.y = (st2*sy-sty*st)/det;
-      ballVel.x = (n*stx-st*sx)/det;
-      ballVel.y = (n*sty-st*sy)/det;
-      if (ballVel.abs()<10) {
-        ball2.x = sx/n;
-        ball2.y = sy/n;
-        ballVel = Timed2D(0,0,ctime);
-      }
-      //推定値との隔たりが連続して大きい回数を数える
-      if (ball2.distance(ball) > 100 && !ball.isInvisible()) { //TODO 距離200[mm]は要検討
-        errorCount++;
-      } else {
-        errorCount = 0;
-      }
     }
   }
-  if (errorCount > 1) { //TODO エラー回数の上限は要検討
-    ballDeque.clear();
-    errorCount = 0;
+  //隠れている間はパーティクルフィルタの推定値を使う
+  if (updateBallFilter(ball2, ballVel, sinfo2, sinfo, ctime, param.ballFilterDelay)) {
+    filterUncertainty(u, ctime);
+  } else if (ball2.isInvisible()) {
+    u.vanish();
+  } else {
+    //見えていない間は外挿しているので，その時間の分だけ誤差を加える
+    ageUncertainty(u, ctime-ballTime, param.ballDriftSpeed, param.confidenceDistance);
   }
   sinfo2.ball = Orthogonal(ball2.x,ball2.y,0);
-//  cout << ballDeque.size() << " " << errorCount << " " << ball2.distance(ball) << endl;
-  //各ロボットの推定
-  for (int i=BLUE; i<=YELLOW; i++) {
-    for (int j=1; j<=MAX_ROBOT_NUM; j++) {
-      if (sinfo.robot[i][j].isInvisible()) {
-        //見えていなければ
-        if (robot[i][j].isInvisible() || ctime-robotTime[i][j] > 1.0) { //TODO 1.0は要検討
-          //過去データがないか，古ければ
-          sinfo2.robot[i][j].vanish();
-          sinfo2.id[i][j] = false;
-        } else {
-          //過去データがあり，古くなければ
-          sinfo2.robot[i][j] = robot[i][j];
-          sinfo2.id[i][j] = id[i][j];
-        }
-      } else {
-        //見えていれば，
-        if (!robot[i][j].isInvisible() && ctime-robotTime[i][j] <= 1.0 //TODO 1.0は要検討
-          && id[i][j] && robot[i][j].distance(sinfo.robot[i][j]) > 240 ) { //TODO 240は要検討
-          //過去データがあり，古くなく，idが真であり，現在データと離れていれば，
-          sinfo2.robot[i][j] = robot[i][j];
-          sinfo2.id[i][j] = id[i][j];
-        } else {
-          robot[i][j] = sinfo2.robot[i][j] = sinfo.robot[i][j];
-          id[i][j] = sinfo2.id[i][j] = sinfo.id[i][j];
-          robotTime[i][j] = ctime;
-        }
-      }
-    }
-  }
+//  cout << ballDeque.size() << " " << ballErrorCount << " " << ball2.distance(ball) << endl;
+  //ボールの運動状態の判断
+  ballMotion = motion = classifyBall(ball2, ballVel, kicked, ctime);
+  prevBall = ball2;
+  prevBall.time = ctime;
+  prevBallVel = ballVel;
   sinfo2.time = sinfo.time;
 }
 
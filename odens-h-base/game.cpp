@@ -10,6 +10,7 @@
 ///@{
 ///
 #include "game.h"
+#include <algorithm>
 
 namespace odens {
 
@@ -32,6 +33,12 @@ Game::Game(int color)
   m_prevPlayType = PlayTypeNone;
   m_kickType = KickTypeNone;
   m_setPlayTime = 0;
+  m_commandCounter = 0;
+  m_hasCommandCounter = false;
+  m_command = ref::HALT;
+  m_setPlayTimeout = 20;
+  m_ballMovedDistance = 100;
+  m_timeline.reserve(GAME_TIMELINE_RESERVE);
 
   SET_PLAY_TYPE_STRING_TABLE(PlayTypeNone);
   SET_PLAY_TYPE_STRING_TABLE(Halt);
@@ -39,6 +46,7 @@ Game::Game(int color)
   SET_PLAY_TYPE_STRING_TABLE(InPlay);
   SET_PLAY_TYPE_STRING_TABLE(SetPlay);
   SET_PLAY_TYPE_STRING_TABLE(PreSetPlay);
+  SET_PLAY_TYPE_STRING_TABLE(BallPlacement);
 
   SET_KICK_TYPE_STRING_TABLE(KickTypeNone);
   SET_KICK_TYPE_STRING_TABLE(OurKickOff);
@@ -49,9 +57,38 @@ Game::Game(int color)
   SET_KICK_TYPE_STRING_TABLE(TheirPenaltyKick);
   SET_KICK_TYPE_STRING_TABLE(TheirDirectFreeKick);
   SET_KICK_TYPE_STRING_TABLE(TheirIndirectFreeKick);
+  SET_KICK_TYPE_STRING_TABLE(OurBallPlacement);
+  SET_KICK_TYPE_STRING_TABLE(TheirBallPlacement);
 
 }
 
+//遷移表のいくつかの要素をコンパイル時に確かめる
+static_assert(gameTransition(ref::PREPARE_KICKOFF_YELLOW, YELLOW, Halt).kick == OurKickOff, "gameRuleTable");
+static_assert(gameTransition(ref::PREPARE_KICKOFF_YELLOW, BLUE, Halt).kick == TheirKickOff, "gameRuleTable");
+static_assert(gameTransition(ref::DIRECT_FREE_BLUE, BLUE, InPlay).play == InPlay, "gameRuleTable");
+static_assert(gameTransition(ref::GOAL_BLUE, BLUE, PreSetPlay).play == PreSetPlay, "gameRuleTable");
+static_assert(gameTransition(ref::CommandNOI, BLUE, InPlay).play == OutOfPlay, "gameRuleTable");
+
+///
+///@brief セットプレーを打ち切ってInPlayにする時間を設定する
+///@param[in] t 時間 [s]（規定値は20）
+///@return なし
+///
+void Game::setSetPlayTimeout(double t)
+{
+  m_setPlayTimeout = t;
+}
+
+///
+///@brief 相手のセットプレーでボールが動いたとみなす距離を設定する
+///@param[in] d 距離 [mm]（規定値は100）
+///@return なし
+///
+void Game::setBallMovedDistance(double d)
+{
+  m_ballMovedDistance = d;
+}
+
 ///
 ///@brief ゲームモードを決定する
 ///@param[in] rinfo レフェリーボックスからの情報
@@ -61,100 +98,120 @@ Game::Game(int color)
 ///
 GameMode Game::decideMode(const RefereeInfo &rinfo, const Orthogonal &ball, double ctime)
 {
-  const ref::Command &c = rinfo.command;
+  return decideMode(rinfo, ball, BallMotionNone, 0, ctime);
+}
+
+///
+///@brief ゲームモードを決定する（ボールの運動状態利用版）
+///@param[in] rinfo レフェリーボックスからの情報
+///@param[in] ball 現在のボール位置
+///@param[in] motion 現在のボールの運動状態（Estimatorの推定結果）
+///@param[in] kickTime ボールが最後に蹴られたと判断した時刻（Estimator::getBallKickTime()）
+///@param[in] ctime 現在時刻
+///@return 決定結果
+///
+///- 相手のセットプレーでボールが蹴られたと判断されたら，setBallMovedDistance()の距離を動くのを待たずにInPlayにする．
+///  セットプレーの開始より前のキック（STOP中のボールの移動など）では終了しない．
+///
+GameMode Game::decideMode(const RefereeInfo &rinfo, const Orthogonal &ball, BallMotion motion, double kickTime, double ctime)
+{
+  m_command = rinfo.command;
+  return decideCommand(m_command, ball, motion, kickTime, ctime);
+}
+
+///
+///@brief レフェリーボックスからの受信が途絶えたときのゲームモードを決定する
+///@param[in,out] rinfo レフェリーボックスからの情報（コマンドをSTOPに置き換える）
+///@param[in] ball 現在のボール位置
+///@param[in] ctime 現在時刻
+///@return 決定結果（OutOfPlay）
+///
+///- 最後に受信したコマンドのままプレーを続けないように，STOPのときと同じOutOfPlayを返す．
+///- rinfo.commandも置き換えるので，呼び出し側はロボットを止める判断にそのまま使える．
+///- 遷移の状態（前回のプレーの種類，記憶しているキックの種類）と遷移の記録は変えない．
+///  受信が戻れば，途絶える前のコマンドからそのまま続ける．
+///
+GameMode Game::decideSafeMode(RefereeInfo &rinfo, const Orthogonal &, double)
+{
+  rinfo.command = ref::STOP;
   GameMode mode;
-  switch (c) {
-  case ref::HALT:
-    mode.play = Halt;
-    mode.kick = KickTypeNone;
-    break;
-  case ref::STOP:
-    mode.play = OutOfPlay;
-    mode.kick = KickTypeNone;
-    break;
-  case ref::NORMAL_START:
-    if (m_prevPlayType == InPlay) {
-      mode.play = InPlay;
-    } else {
-      mode.play = SetPlay;
-    }
-    mode.kick = m_kickType;
-    break;
-  case ref::FORCE_START:
-    mode.play = InPlay;
-    mode.kick = KickTypeNone;
-    break;
-  case ref::PREPARE_KICKOFF_YELLOW:
-    mode.play = PreSetPlay;
-    m_kickType = (m_ourColor==YELLOW)?OurKickOff:TheirKickOff;
-    mode.kick = m_kickType;
-    break;
-  case ref::PREPARE_KICKOFF_BLUE:
-    mode.play = PreSetPlay;
-    m_kickType = (m_ourColor==BLUE)?OurKickOff:TheirKickOff;
-    mode.kick = m_kickType;
-    break;
-  case ref::PREPARE_PENALTY_YELLOW:
-    mode.play = PreSetPlay;
-    m_kickType = (m_ourColor==YELLOW)?OurPenaltyKick:TheirPenaltyKick;
-    mode.kick = m_kickType;
-    break;
-  case ref::PREPARE_PENALTY_BLUE:
-    mode.play = PreSetPlay;
-    m_kickType = (m_ourColor==BLUE)?OurPenaltyKick:TheirPenaltyKick;
-    mode.kick = m_kickType;
-    break;
-  case ref::DIRECT_FREE_YELLOW:
-    if (m_prevPlayType == InPlay) {
-      mode.play = InPlay;
-    } else {
-      mode.play = SetPlay;
-      m_kickType = (m_ourColor==YELLOW)?OurDirectFreeKick:TheirDirectFreeKick;
-    }
-    mode.kick = m_kickType;
-    break;
-  case ref::DIRECT_FREE_BLUE:
-    if (m_prevPlayType == InPlay) {
-      mode.play = InPlay;
-    } else {
-      mode.play = SetPlay;
-      m_kickType = (m_ourColor==BLUE)?OurDirectFreeKick:TheirDirectFreeKick;
-    }
+  mode.play = OutOfPlay;
+  mode.kick = KickTypeNone;
+  return mode;
+}
+
+///
+///@brief コマンドの変化を1つ処理する
+///@param[in] event コマンドの変化（Referee::popEvent()で取り出したもの）
+///@param[in] ball 現在のボール位置
+///@param[in] motion 現在のボールの運動状態
+///@param[in] kickTime ボールが最後に蹴られたと判断した時刻
+///@param[in] ctime 現在時刻
+///@return そのコマンドでのゲームモード
+///
+///- 取り出せる全てのイベントについて古い順に呼び，最後の戻り値をその周期のゲームモードにする．
+///  イベントがない周期はupdate()で決め直す（同じコマンドを1周期に2回処理しない）．
+///  メインループが遅れて最新のコマンドしか見えない場合でも，途中のコマンド
+///  （PREPARE_KICKOFF_*のキックの種類など）を取りこぼさない．
+///- 処理済みのカウンタのイベントは無視する．
+///
+GameMode Game::consume(const RefereeEvent &event, const Orthogonal &ball, BallMotion motion, double kickTime, double ctime)
+{
+  if (m_hasCommandCounter && event.commandCounter == m_commandCounter) {
+    GameMode mode;
+    mode.play = m_prevPlayType;
     mode.kick = m_kickType;
-    break;
-  case ref::INDIRECT_FREE_YELLOW:
-    if (m_prevPlayType == InPlay) {
-      mode.play = InPlay;
-    } else {
-      mode.play = SetPlay;
-      m_kickType = (m_ourColor==YELLOW)?OurIndirectFreeKick:TheirIndirectFreeKick;
-    }
+    return mode;
+  }
+  m_hasCommandCounter = true;
+  m_commandCounter = event.commandCounter;
+  m_command = event.command;
+  return decideCommand(m_command, ball, motion, kickTime, ctime);
+}
+
+///
+///@brief 最後に処理したコマンドのままでゲームモードを決め直す
+///@param[in] ball 現在のボール位置
+///@param[in] motion 現在のボールの運動状態
+///@param[in] kickTime ボールが最後に蹴られたと判断した時刻
+///@param[in] ctime 現在時刻
+///@return 決定結果
+///
+///- consume()でイベントを1つも処理しなかった周期に呼び，セットプレーの終了を判断する．
+///  Referee::get()の情報はイベントより古いことがあるので，コマンドには使わない．
+///
+GameMode Game::update(const Orthogonal &ball, BallMotion motion, double kickTime, double ctime)
+{
+  return decideCommand(m_command, ball, motion, kickTime, ctime);
+}
+
+///
+///@brief コマンドからゲームモードを決定する（decideMode()とconsume()の本体）
+///@param[in] c レフェリーボックスのコマンド
+///@param[in] ball 現在のボール位置
+///@param[in] motion 現在のボールの運動状態
+///@param[in] kickTime ボールが最後に蹴られたと判断した時刻
+///@param[in] ctime 現在時刻
+///@return 決定結果
+///
+///- コマンドによる遷移はgameRuleTableを引いて決める．
+///- セットプレーの終了はsetSetPlayTimeout()とsetBallMovedDistance()で設定した値で判断する．
+///
+GameMode Game::decideCommand(ref::Command c, const Orthogonal &ball, BallMotion motion, double kickTime, double ctime)
+{
+  GameTransition t = gameTransition(c, m_ourColor, m_prevPlayType);
+  GameMode mode;
+  mode.play = t.play;
+  switch (t.rule) {
+  case KickStore:
+    m_kickType = t.kick;
     mode.kick = m_kickType;
     break;
-  case ref::INDIRECT_FREE_BLUE:
-    if (m_prevPlayType == InPlay) {
-      mode.play = InPlay;
-    } else {
-      mode.play = SetPlay;
-      m_kickType = (m_ourColor==BLUE)?OurIndirectFreeKick:TheirIndirectFreeKick;
-    }
+  case KickRecall:
     mode.kick = m_kickType;
     break;
-  case ref::TIMEOUT_YELLOW:
-    mode.play = m_prevPlayType;
-    mode.kick = KickTypeNone;
-    break;
-  case ref::TIMEOUT_BLUE:
-    mode.play = m_prevPlayType;
-    mode.kick = KickTypeNone;
-    break;
-  case ref::GOAL_YELLOW:
-    mode.play = m_prevPlayType;
-    mode.kick = KickTypeNone;
-    break;
-  case ref::GOAL_BLUE:
-    mode.play = m_prevPlayType;
-    mode.kick = KickTypeNone;
+  default:
+    mode.kick = t.kick;
     break;
   }
   //cout << ctime-m_setPlayTime << endl;
@@ -163,20 +220,94 @@ GameMode Game::decideMode(const RefereeInfo &rinfo, const Orthogonal &ball, doub
       //SetPlayに切り替わった時
       m_setPlayBall = ball;  //TODO: ボールが見えていない場合の対応
       m_setPlayTime = ctime;
-    } else if (ctime-m_setPlayTime > 20) { //20秒以上経過したら TODO: 可変にする
+    } else if (ctime-m_setPlayTime > m_setPlayTimeout) { //時間切れ
+      mode.play = InPlay;
+      m_kickType = KickTypeNone;
+      mode.kick = m_kickType;
+    } else if (mode.isTheirKick() && motion == BallKicked && kickTime > m_setPlayTime) { //セットプレー開始後に蹴られたら
       mode.play = InPlay;
       m_kickType = KickTypeNone;
       mode.kick = m_kickType;
-    } else if (mode.isTheirKick() && ball.distance(m_setPlayBall) > 100) { //100mm以上動いたら TODO: 可変にする
+    } else if (mode.isTheirKick() && ball.distance(m_setPlayBall) > m_ballMovedDistance) { //ボールが動いたら
       mode.play = InPlay;
       m_kickType = KickTypeNone;
       mode.kick = m_kickType;
     }
   }
   m_prevPlayType = mode.play;
+  record(c, mode, ball, ctime);
   return mode;
 }
 
+///
+///@brief ゲームモードが変わっていたら遷移を記録する
+///@param[in] c きっかけになったコマンド
+///@param[in] mode 決定したゲームモード
+///@param[in] ball 現在のボール位置
+///@param[in] ctime 現在時刻
+///@return なし
+///
+void Game::record(ref::Command c, const GameMode &mode, const Orthogonal &ball, double ctime)
+{
+  if (!m_timeline.empty() && m_timeline.back().play == mode.play && m_timeline.back().kick == mode.kick) {
+    return;
+  }
+  GameModeTransition tr;
+  tr.time = ctime;
+  tr.command = c;
+  tr.play = mode.play;
+  tr.kick = mode.kick;
+  tr.ballX = static_cast<float>(ball.x);
+  tr.ballY = static_cast<float>(ball.y);
+  m_timeline.push_back(tr);
+}
+
+///
+///@brief 時刻の範囲を指定してゲームモードの遷移の記録を取り出す
+///@param[in] t0 範囲の始め [s]
+///@param[in] t1 範囲の終わり [s]（この時刻の遷移も含む）
+///@param[out] out 取り出した遷移（時刻の順）
+///@return 取り出した遷移の数
+///
+int Game::getTimeline(double t0, double t1, std::vector<GameModeTransition> &out) const
+{
+  auto earlier = [](const GameModeTransition &tr, double t) { return tr.time < t; };
+  auto first = std::lower_bound(m_timeline.begin(), m_timeline.end(), t0, earlier);
+  auto last = first;
+  while (last != m_timeline.end() && last->time <= t1) {
+    ++last;
+  }
+  out.assign(first, last);
+  return static_cast<int>(out.size());
+}
+
+///
+///@brief 指定した時刻に有効だったゲームモードの遷移を得る
+///@param[in] t 時刻 [s]
+///@param[out] tr その時刻以前で最後の遷移
+///@retval false 正常終了
+///@retval true 異常終了（その時刻以前の記録がない）
+///
+bool Game::getModeAt(double t, GameModeTransition &tr) const
+{
+  auto later = [](double t, const GameModeTransition &tr) { return t < tr.time; };
+  auto it = std::upper_bound(m_timeline.begin(), m_timeline.end(), t, later);
+  if (it == m_timeline.begin()) {
+    return true;
+  }
+  tr = *(it-1);
+  return false;
+}
+
+///
+///@brief ゲームモードの遷移の記録を消す
+///@return なし
+///
+void Game::clearTimeline()
+{
+  m_timeline.clear();
+}
+
 } //namespace odens
 
 ///@} doxygenのためのコメント（消してはいけない）
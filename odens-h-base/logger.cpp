@@ -72,6 +72,51 @@ void Logger::write(double ctime, const srInfo &sinfo, const Timed2D &ballVel,
     << com << endl; 
 }
 
+///
+///@brief ゲームモードの遷移の記録をログファイルの最後に出力する
+///@param[in] timeline 遷移の記録（Game::getTimeline()）
+///@return なし
+///
+///- 1行に1つの遷移を「# GameMode 時刻 コマンド プレー キック ボールx ボールy」の形式で出力する．
+///- 行頭を#にして，毎フレームの行を読むプログラム（estimator-tunerなど）では読み飛ばされるようにしている．
+///
+void Logger::writeTimeline(const std::vector<GameModeTransition> &timeline)
+{
+  if (!m_fout) return;
+
+  m_fout << "# GameTimeline " << timeline.size() << endl;
+  for (const GameModeTransition &tr : timeline) {
+    m_fout << "# GameMode " << tr.time << " " << tr.command << " "
+      << tr.play << " " << tr.kick << " "
+      << tr.ballX << " " << tr.ballY << endl;
+  }
+}
+
+///
+///@brief ロボットへの送信の統計と記録をログファイルの最後に出力する
+///@param[in] stats 送信の統計（Robot::getSendStats()）
+///@param[in] trace 送信の記録（Robot::getSendTrace()）
+///@return なし
+///
+///- 統計を「# RobotStats 書き込み 変化 再送 失敗 期限切れ バイト数 時間平均 時間最大 遅れ平均 遅れ最大」，
+///  記録を1行に1つ「# RobotSend 時刻 コマンド バイト数 成功 時間 遅れ」の形式で出力する（時間は[s]）．
+///- 遅れは再送なら-1．行頭を#にするのはwriteTimeline()と同じ理由．
+///
+void Logger::writeRobotTrace(const RobotSendStats &stats, const std::vector<RobotSendRecord> &trace)
+{
+  if (!m_fout) return;
+
+  m_fout << "# RobotStats " << stats.writes << " " << stats.changes << " "
+    << stats.keepalives << " " << stats.failures << " " << stats.timeouts << " "
+    << stats.bytes << " " << stats.durationMean << " " << stats.durationMax << " "
+    << stats.delayMean << " " << stats.delayMax << endl;
+  m_fout << "# RobotTrace " << trace.size() << endl;
+  for (const RobotSendRecord &r : trace) {
+    m_fout << "# RobotSend " << r.time << " " << r.command << " " << r.bytes << " "
+      << r.ok << " " << r.duration << " " << r.delay << endl;
+  }
+}
+
 } //namespace odens
 
 ///@} doxygenのためのコメント（消してはいけない）
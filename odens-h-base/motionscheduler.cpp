@@ -0,0 +1,265 @@
+﻿///
+///@file motionscheduler.cpp
+///@brief MotionSchedulerクラスのメンバ関数の定義
+///@par Copyright
+/// Copyright (C) 2026 Team ODENS, Masutani Lab, Osaka Electro-Communication University
+///@par 履歴
+///- 2026/10/18 升谷 保博 新規作成（動作の区切りによるコマンドの切り替え）
+///@addtogroup robot
+///@{
+///
+#include <cmath>
+#include <algorithm>
+#include "motionscheduler.h"
+
+using namespace std;
+
+namespace odens {
+
+///
+///@brief コンストラクタ
+///
+MotionScheduler::MotionScheduler()
+{
+  m_probot = nullptr;
+  m_enabled = false;
+  m_timingTable = nullptr;
+  m_timingNum = 0;
+  m_current = 0;
+  m_startTime = 0;
+  m_holdUntil = 0;
+  m_period = 0;
+  m_hasPending = false;
+  m_pending = 0;
+  m_queueHead = 0;
+  m_queueNum = 0;
+  m_stepEnd = 0;
+  m_stats = MotionSchedulerStats();
+}
+
+///
+///@brief コマンドを送るRobotと各コマンドの継続時間の表を設定する
+///@param[in] robot Robot
+///@param[in] table 各コマンドの最短の継続時間と中断の可否（Commandの順）
+///@param[in] num tableの要素数
+///@return なし
+///
+void MotionScheduler::setRobot(Robot &robot, const MotionTiming *table, size_t num)
+{
+  m_probot = &robot;
+  m_timingTable = table;
+  m_timingNum = num;
+  m_current = robot.getCommand();
+}
+
+///
+///@brief コマンドの最短の継続時間と中断の可否を返す
+///@param[in] com コマンド
+///@return 最短の継続時間と中断の可否（無効な場合，表にないコマンドと連続値の移動指令はいつでも中断できる）
+///
+MotionTiming MotionScheduler::getTiming(RobotCommand com) const
+{
+  if (!m_enabled || isMotionCommand(com) || com >= m_timingNum) {
+    MotionTiming t = {0, true};
+    return t;
+  }
+  return m_timingTable[com];
+}
+
+///
+///@brief 2つのコマンドのパケットが同じか？（ロボットにとっては切り替わらない）
+///
+///- 連続値の移動指令も符号化したパケットで比べる（量が0の移動指令とCommandNoneは同じ）．
+///
+bool MotionScheduler::isSamePacket(RobotCommand a, RobotCommand b) const
+{
+  if (a == b) {
+    return true;
+  }
+  Packet pa, pb;
+  if (m_probot->getPacket(a, pa) || m_probot->getPacket(b, pb)) {
+    return false;
+  }
+  return pa.size == pb.size && equal(pa.b.begin(), pa.b.begin()+pa.size, pb.b.begin());
+}
+
+///
+///@brief Robotへコマンドを送り，切り替えを保留する時刻を決める
+///@param[in] com コマンド
+///@param[in] duration 続ける時間（0以下ならMotionTimingに従う） [s]
+///@param[in] ctime 現在の時刻 [s]
+///@return なし
+///
+///- パケットが同じコマンドなら，Robotのコマンドは変えるが，動作は続いているものとして区切りは変えない．
+///
+void MotionScheduler::apply(RobotCommand com, double duration, double ctime)
+{
+  if (com == m_current) {
+    return;
+  }
+  bool same = isSamePacket(com, m_current);
+  if (isMotionCommand(com)) {
+    m_probot->putCommand(com);
+  } else {
+    m_probot->setCommand(com);
+  }
+  m_current = com;
+  if (same) {
+    return;
+  }
+  MotionTiming t = getTiming(com);
+  m_startTime = ctime;
+  m_period = t.interruptible ? 0 : (duration > 0 ? duration : t.minDuration);
+  m_holdUntil = ctime + m_period;
+  m_stats.switches++;
+}
+
+///
+///@brief 動作の列の現在の段を始める
+///@param[in] ctime 現在の時刻 [s]
+///@return なし
+///
+void MotionScheduler::startStep(double ctime)
+{
+  const MotionStep &s = m_queue[m_queueHead];
+  double d = s.duration > 0 ? s.duration : getTiming(s.command).minDuration;
+  m_stepEnd = ctime + d;
+  apply(s.command, d, ctime);
+}
+
+///
+///@brief コマンドの切り替えを依頼する（Taskから毎周期呼ぶ）
+///@param[in] com コマンド
+///@param[in] ctime 現在の時刻 [s]
+///@return なし
+///
+///- 送っているコマンドが中断できず，区切りに達していなければ保留する．
+///- 保留中の依頼は最新のものに置き換え，送っているコマンドと同じなら取り消す．
+///- 動作の列の実行中は，列が終わるまで保留する．
+///
+void MotionScheduler::request(RobotCommand com, double ctime)
+{
+  m_stats.requests++;
+  if (m_hasPending && m_pending == com) {
+    update(ctime);
+    return;
+  }
+  if (m_hasPending) {
+    m_stats.collapsed++;
+    m_hasPending = false;
+  }
+  if (!isSequenceRunning() && isSamePacket(com, m_current)) {
+    apply(com, 0, ctime);
+    update(ctime);
+    return;
+  }
+  m_pending = com;
+  m_hasPending = true;
+  update(ctime);
+  if (m_hasPending) {
+    m_stats.deferred++;
+  }
+}
+
+///
+///@brief 連続値の移動指令への切り替えを依頼する
+///@param[in] motion 移動指令
+///@param[in] ctime 現在の時刻 [s]
+///@retval false 正常終了
+///@retval true 異常終了（このロボットは対応していない）
+///
+bool MotionScheduler::requestMotion(const RobotMotion &motion, double ctime)
+{
+  if (!m_probot->supportsMotion()) {
+    cerr << "連続値の移動指令に対応していない" << endl;
+    return true;
+  }
+  request(encodeMotion(motion), ctime);
+  return false;
+}
+
+///
+///@brief 保留と動作の列を捨てて，すぐにコマンドを送る（停止やトルクオフ用）
+///@param[in] com コマンド
+///@param[in] ctime 現在の時刻 [s]
+///@return なし
+///
+void MotionScheduler::force(RobotCommand com, double ctime)
+{
+  if (m_hasPending) {
+    m_stats.collapsed++;
+    m_hasPending = false;
+  }
+  m_queueNum = 0;
+  m_period = 0;
+  m_holdUntil = ctime;
+  apply(com, 0, ctime);
+}
+
+///
+///@brief 動作の列を始める
+///@param[in] steps 動作の列
+///@param[in] num 段数
+///@param[in] ctime 現在の時刻 [s]
+///@retval false 正常終了
+///@retval true 異常終了（段数が0かMOTION_QUEUE_SIZEを超える）
+///
+///- 送っているコマンドの区切りを待たずに始める．保留中の依頼は捨てる．
+///- 列が終わると最後の段のコマンドのままで，次の依頼はすぐに切り替える．
+///
+bool MotionScheduler::startSequence(const MotionStep *steps, size_t num, double ctime)
+{
+  if (num == 0 || num > MOTION_QUEUE_SIZE) {
+    cerr << "動作の列の段数 " << num << " は範囲外" << endl;
+    return true;
+  }
+  if (m_hasPending) {
+    m_stats.collapsed++;
+    m_hasPending = false;
+  }
+  copy(steps, steps+num, m_queue);
+  m_queueHead = 0;
+  m_queueNum = num;
+  m_stats.sequences++;
+  startStep(ctime);
+  return false;
+}
+
+///
+///@brief 時刻を進める（動作の列を進め，区切りに達したら保留中の依頼を送る）
+///@param[in] ctime 現在の時刻 [s]
+///@return なし
+///
+///- 保留中の依頼がないまま区切りを過ぎたら，同じコマンドの次の周期が始まったとみなして
+///  区切りを次の周期の終わりへ延ばす．
+///
+void MotionScheduler::update(double ctime)
+{
+  if (isSequenceRunning()) {
+    if (ctime < m_stepEnd) {
+      return;
+    }
+    m_queueHead++;
+    m_queueNum--;
+    if (isSequenceRunning()) {
+      startStep(ctime);
+      return;
+    }
+    m_period = 0;
+    m_holdUntil = ctime;
+  }
+  if (ctime < m_holdUntil) {
+    return;
+  }
+  if (m_hasPending) {
+    m_hasPending = false;
+    apply(m_pending, 0, ctime);
+  } else if (m_period > 0) {
+    double n = floor((ctime - m_startTime)/m_period) + 1;
+    m_holdUntil = m_startTime + n*m_period;
+  }
+}
+
+} //namespace odens
+
+///@} doxygenのためのコメント（消してはいけない）
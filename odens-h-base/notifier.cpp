@@ -0,0 +1,52 @@
+﻿///
+///@file notifier.cpp
+///@brief Notifierクラスのメンバ関数の定義
+///@par Copyright
+/// Copyright (C) 2026 Team ODENS, Masutani Lab, Osaka Electro-Communication University
+///@par 履歴
+///- 2026/10/18 升谷 保博 新規作成（ビジョンとレフェリーの待ち合わせ）
+///@addtogroup notifier
+///@{
+///
+
+#include "notifier.h"
+
+namespace odens {
+
+///
+///@brief 通知する（受信スレッドから呼ぶ）
+///@param[in] source 通知の発生源
+///@return なし
+///
+void Notifier::notify(NotifySource source)
+{
+  boost::mutex::scoped_lock lock(m_mutex);
+  m_pending |= source;
+  m_condition.notify_all();
+}
+
+///
+///@brief いずれかの通知が来るまで待つ（メインループから呼ぶ）
+///@param[in] timeout タイムアウト [ms]
+///@return 来ていた通知（NotifySourceの論理和），タイムアウトならNotifyNone
+///
+///- 既に通知が来ていれば待たずに戻る．戻るときに通知はクリアする．
+///- 見かけ上の起床（spurious wakeup）では戻らない．
+///
+unsigned Notifier::wait(unsigned timeout)
+{
+  boost::mutex::scoped_lock lock(m_mutex);
+  boost::system_time deadline = boost::get_system_time() + boost::posix_time::milliseconds(timeout);
+  while (m_pending == NotifyNone) {
+    if (!m_condition.timed_wait(lock, deadline)) {
+      break;
+    }
+  }
+  unsigned pending = m_pending;
+  m_pending = NotifyNone;
+  return pending;
+}
+
+} //namespace odens
+
+///@} doxygenのためのコメント（消してはいけない）
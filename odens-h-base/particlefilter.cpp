@@ -0,0 +1,286 @@
+﻿///
+///@file particlefilter.cpp
+///@brief BallParticleFilterクラスのメンバ関数の定義
+///@par Copyright
+/// Copyright (C) 2026 Team ODENS, Masutani Lab, Osaka Electro-Communication University
+///@par 履歴
+///- 2026/10/18 升谷 保博 新規作成（ボールのパーティクルフィルタ）
+///@addtogroup particlefilter
+///@{
+///
+
+#include <cmath>
+#include <algorithm>
+#include "particlefilter.h"
+
+namespace odens {
+
+///
+///@brief 粒子を動かす（分岐のないループ）
+///@param[in,out] p 粒子
+///@param[in] nx 速度のx成分に加える雑音
+///@param[in] ny 速度のy成分に加える雑音
+///@param[in] dt 経過時間 [s]
+///@param[in] decay 速度に掛ける減衰率
+///@return なし
+///
+///- 壁（フィールドの外周からFIELD_MARGIN）の外には出ないようにする．
+///
+static void propagateParticles(BallParticleArray &p, const double *nx, const double *ny,
+                               double dt, double decay)
+{
+  const double xmax = FIELD_LENGTH2+FIELD_MARGIN;
+  const double ymax = FIELD_WIDTH2+FIELD_MARGIN;
+  for (int i=0; i<BALL_PARTICLE_NUM; i++) {
+    double vx = p.vx[i]*decay + nx[i];
+    double vy = p.vy[i]*decay + ny[i];
+    double x = p.x[i] + vx*dt;
+    double y = p.y[i] + vy*dt;
+    p.x[i] = std::min(std::max(x, -xmax), xmax);
+    p.y[i] = std::min(std::max(y, -ymax), ymax);
+    p.vx[i] = vx;
+    p.vy[i] = vy;
+  }
+}
+
+///
+///@brief 観測による重みの更新（分岐のないループ）
+///@param[in,out] w 重み
+///@param[in] p 粒子
+///@param[in] bx 観測したボールのx座標
+///@param[in] by 観測したボールのy座標
+///@param[in] sigma 観測の誤差の尺度 [mm]
+///@return なし
+///
+///- 外れた観測に引きずられにくいように，正規分布ではなくコーシー分布の尤度を使う．
+///
+static void weightObserved(double *w, const BallParticleArray &p, double bx, double by, double sigma)
+{
+  const double inv = 1/(sigma*sigma);
+  for (int i=0; i<BALL_PARTICLE_NUM; i++) {
+    double dx = p.x[i]-bx;
+    double dy = p.y[i]-by;
+    w[i] *= 1/(1 + (dx*dx+dy*dy)*inv);
+  }
+}
+
+///
+///@brief 見えなかったことによる重みの更新（分岐のないループ）
+///@param[in,out] w 重み
+///@param[out] occluded 作業用（隠れる領域にあれば1）
+///@param[in] p 粒子
+///@param[in] sinfo ロボットの位置（隠すもの）
+///@param[in] radius ロボットがボールを隠す半径 [mm]
+///@param[in] miss 隠れる領域の外でボールを見落とす確率
+///@return なし
+///
+static void weightUnobserved(double *w, double *occluded, const BallParticleArray &p,
+                             const srInfo &sinfo, double radius, double miss)
+{
+  const double r2 = radius*radius;
+  for (int i=0; i<BALL_PARTICLE_NUM; i++) {
+    occluded[i] = 0;
+  }
+  for (int c=BLUE; c<=YELLOW; c++) {
+    for (int j=1; j<=MAX_ROBOT_NUM; j++) {
+      //見えていないロボットはINVISIBLEの位置にあるので，どの粒子も隠さない
+      const double rx = sinfo.robot[c][j].x;
+      const double ry = sinfo.robot[c][j].y;
+      for (int i=0; i<BALL_PARTICLE_NUM; i++) {
+        double dx = p.x[i]-rx;
+        double dy = p.y[i]-ry;
+        double inside = (dx*dx+dy*dy < r2) ? 1.0 : 0.0;
+        occluded[i] = std::max(occluded[i], inside);
+      }
+    }
+  }
+  for (int i=0; i<BALL_PARTICLE_NUM; i++) {
+    w[i] *= occluded[i] + (1-occluded[i])*miss;
+  }
+}
+
+///
+///@brief コンストラクタ
+///
+BallParticleFilter::BallParticleFilter()
+  : m_random(12345), m_normal(0, 1), m_uniform(0, 1)
+{
+  m_decay = 2.0;              //TODO 2[s]は要検討
+  m_velocityNoise = 300;      //TODO 300[mm/s/√s]は要検討
+  m_observationNoise = 20;    //TODO 20[mm]は要検討
+  m_missProbability = 0.1;    //TODO 0.1は要検討
+  m_occluderRadius = 2*ROBOT_RADIUS; //TODO 要検討
+  m_resetDistance = 500;      //TODO 500[mm]は要検討
+  m_holdTime = 10.0;          //TODO 10[s]は要検討
+  clear();
+}
+
+///
+///@brief 保持している値をすべてクリア
+///@return なし
+///
+void BallParticleFilter::clear()
+{
+  m_initialized = false;
+  m_index = 0;
+  m_time = 0;
+  m_seenTime = 0;
+  m_ball.vanish();
+  m_vel = Timed2D(0,0,0);
+  m_spread = 0;
+  m_cxx = m_cxy = m_cyy = 0;
+}
+
+///
+///@brief 観測したボールの周りに粒子をばらまく
+///@param[in] ball 観測したボールの位置
+///@param[in] vel ボールの推定速度 [mm/s]
+///@param[in] ctime 現在の時刻
+///@return なし
+///
+void BallParticleFilter::initialize(const Orthogonal &ball, const Timed2D &vel, double ctime)
+{
+  BallParticleArray &p = m_particle[m_index];
+  for (int i=0; i<BALL_PARTICLE_NUM; i++) {
+    p.x[i] = ball.x + m_observationNoise*m_normal(m_random);
+    p.y[i] = ball.y + m_observationNoise*m_normal(m_random);
+    p.vx[i] = vel.x + m_velocityNoise*m_normal(m_random);
+    p.vy[i] = vel.y + m_velocityNoise*m_normal(m_random);
+    m_weight[i] = 1.0/BALL_PARTICLE_NUM;
+  }
+  m_initialized = true;
+  m_time = ctime;
+  m_seenTime = ctime;
+}
+
+///
+///@brief 系統的リサンプリング
+///@return なし
+///
+///- 重みは正規化されていること．結果はもう一方の組に書き，組を切り替える．
+///
+void BallParticleFilter::resample()
+{
+  const BallParticleArray &p = m_particle[m_index];
+  BallParticleArray &q = m_particle[1-m_index];
+  const double step = 1.0/BALL_PARTICLE_NUM;
+  double u = step*m_uniform(m_random);
+  double c = m_weight[0];
+  int j = 0;
+  for (int i=0; i<BALL_PARTICLE_NUM; i++) {
+    while (u > c && j < BALL_PARTICLE_NUM-1) {
+      j++;
+      c += m_weight[j];
+    }
+    q.x[i] = p.x[j];
+    q.y[i] = p.y[j];
+    q.vx[i] = p.vx[j];
+    q.vy[i] = p.vy[j];
+    u += step;
+  }
+  for (int i=0; i<BALL_PARTICLE_NUM; i++) {
+    m_weight[i] = step;
+  }
+  m_index = 1-m_index;
+}
+
+///
+///@brief 重み付き平均で推定値を求める
+///@return なし
+///
+void BallParticleFilter::estimate()
+{
+  const BallParticleArray &p = m_particle[m_index];
+  double sx = 0, sy = 0, svx = 0, svy = 0, sxx = 0, sxy = 0, syy = 0;
+  for (int i=0; i<BALL_PARTICLE_NUM; i++) {
+    const double w = m_weight[i];
+    sx += w*p.x[i];
+    sy += w*p.y[i];
+    svx += w*p.vx[i];
+    svy += w*p.vy[i];
+    sxx += w*p.x[i]*p.x[i];
+    sxy += w*p.x[i]*p.y[i];
+    syy += w*p.y[i]*p.y[i];
+  }
+  m_ball = Orthogonal(sx, sy, 0);
+  m_vel = Timed2D(svx, svy, m_time);
+  m_cxx = std::max(sxx-sx*sx, 0.0);
+  m_cxy = sxy-sx*sy;
+  m_cyy = std::max(syy-sy*sy, 0.0);
+  m_spread = sqrt(m_cxx + m_cyy);
+}
+
+///
+///@brief 1フレーム分の更新
+///@param[in] ball 今回観測したボールの位置（見えていなければ見えていない値）
+///@param[in] vel ボールの推定速度 [mm/s]（初期化のときだけ使う）
+///@param[in] sinfo ロボットの位置（ボールを隠すものとして使う）
+///@param[in] ctime 現在の時刻
+///@return なし
+///
+///- 見えていない状態が m_holdTime を超えたら更新をやめる（isValid()がfalseになる）．
+///
+void BallParticleFilter::update(const Orthogonal &ball, const Timed2D &vel, const srInfo &sinfo, double ctime)
+{
+  if (!m_initialized) {
+    if (!ball.isInvisible()) {
+      initialize(ball, vel, ctime);
+      estimate();
+    }
+    return;
+  }
+  if (!ball.isInvisible() && (!isValid() || m_ball.distance(ball) > m_resetDistance)) {
+    //初めて見えたか，推定から大きく外れた（置き直しなど）
+    initialize(ball, vel, ctime);
+    estimate();
+    return;
+  }
+  if (!isValid()) {
+    return;
+  }
+
+  //予測
+  double dt = ctime - m_time;
+  m_time = ctime;
+  const double sd = m_velocityNoise*sqrt(std::max(dt, 0.0));
+  for (int i=0; i<BALL_PARTICLE_NUM; i++) {
+    m_noiseX[i] = sd*m_normal(m_random);
+    m_noiseY[i] = sd*m_normal(m_random);
+  }
+  BallParticleArray &p = m_particle[m_index];
+  propagateParticles(p, m_noiseX, m_noiseY, dt, exp(-dt/m_decay));
+
+  //重み付け
+  if (ball.isInvisible()) {
+    weightUnobserved(m_weight, m_occluded, p, sinfo, m_occluderRadius, m_missProbability);
+  } else {
+    weightObserved(m_weight, p, ball.x, ball.y, m_observationNoise);
+    m_seenTime = ctime;
+  }
+  double sum = 0;
+  for (int i=0; i<BALL_PARTICLE_NUM; i++) {
+    sum += m_weight[i];
+  }
+  if (!(sum > 0)) {
+    //全ての粒子が否定された場合は重みを戻す
+    sum = 1;
+    for (int i=0; i<BALL_PARTICLE_NUM; i++) {
+      m_weight[i] = 1.0/BALL_PARTICLE_NUM;
+    }
+  }
+  double sum2 = 0;
+  for (int i=0; i<BALL_PARTICLE_NUM; i++) {
+    m_weight[i] /= sum;
+    sum2 += m_weight[i]*m_weight[i];
+  }
+  estimate();
+
+  //有効な粒子の数が半分を下回ったらリサンプリング
+  if (1/sum2 < BALL_PARTICLE_NUM/2) {
+    resample();
+  }
+}
+
+} //namespace odens
+
+///@} doxygenのためのコメント（消してはいけない）
@@ -0,0 +1,229 @@
+﻿///
+///@file predictor.cpp
+///@brief BallPredictorクラスのメンバ関数の定義
+///@par Copyright
+/// Copyright (C) 2026 Team ODENS, Masutani Lab, Osaka Electro-Communication University
+///@par 履歴
+///- 2026/10/18 升谷 保博 新規作成（ボールの軌道予測）
+///@addtogroup predictor
+///@{
+///
+
+#include <iostream>
+#include <cmath>
+#include <algorithm>
+#include "predictor.h"
+
+namespace odens {
+
+///
+///@brief コンストラクタ
+///
+BallPredictor::BallPredictor()
+{
+  m_deceleration = 400; //TODO 400[mm/s^2]は要検討
+  m_horizon = 5;        //TODO 5[s]は要検討
+  m_ball.vanish();
+  update(m_ball, Timed2D(0,0,0));
+}
+
+///
+///@brief 転がり摩擦による減速度を設定する
+///@param[in] deceleration 減速度 [mm/s^2]（正の値）
+///@retval false 正常終了
+///@retval true 異常終了（0以下なので変更しない）
+///
+///- 次のupdate()から有効になる．
+///
+bool BallPredictor::setDeceleration(double deceleration)
+{
+  if (deceleration <= 0) {
+    std::cerr << "減速度 " << deceleration << " は0以下" << std::endl;
+    return true;
+  }
+  m_deceleration = deceleration;
+  return false;
+}
+
+///
+///@brief ボールの推定値を与えて軌道を計算し直す
+///@param[in] ball ボールの推定位置（EstimatorのsInfo2.ball）
+///@param[in] ballVel ボールの推定速度 [mm/s]
+///@return なし
+///
+///- 1フレームに1回呼べばよい．
+///- 減速度が0以下なら予測できないので，ボールが見えていないものとして扱う（全ての問い合わせが「なし」を返す）．
+///
+void BallPredictor::update(const Orthogonal &ball, const Timed2D &ballVel)
+{
+  m_ball = ball;
+  m_speed = ballVel.abs();
+  if (!(m_deceleration > 0)) {
+    m_ball.vanish();
+  }
+  if (m_ball.isInvisible() || m_speed == 0) {
+    m_speed = 0;
+    m_ux = 1;
+    m_uy = 0;
+  } else {
+    m_ux = ballVel.x/m_speed;
+    m_uy = ballVel.y/m_speed;
+  }
+  m_stopTime = (m_speed == 0) ? 0 : m_speed/m_deceleration;
+  m_stopDistance = (m_speed == 0) ? 0 : m_speed*m_speed/(2*m_deceleration);
+  m_sampleTime = std::min(m_stopTime, m_horizon)/(PREDICTOR_SAMPLE_NUM-1);
+  for (int i=0; i<PREDICTOR_SAMPLE_NUM; i++) {
+    double s = travel(i*m_sampleTime);
+    m_sampleX[i] = m_ball.x + s*m_ux;
+    m_sampleY[i] = m_ball.y + s*m_uy;
+  }
+}
+
+///
+///@brief 時間tの間に転がる距離
+///@param[in] t 時間 [s]
+///@return 距離 [mm]
+///
+double BallPredictor::travel(double t) const
+{
+  if (t >= m_stopTime) {
+    return m_stopDistance;
+  }
+  return m_speed*t - 0.5*m_deceleration*t*t;
+}
+
+///
+///@brief 時間t後のボールの位置
+///@param[in] t 時間 [s]
+///@return 位置（ボールが見えていなければ見えていない値）
+///
+Orthogonal BallPredictor::position(double t) const
+{
+  if (m_ball.isInvisible()) {
+    return m_ball;
+  }
+  double s = travel(t);
+  return Orthogonal(m_ball.x + s*m_ux, m_ball.y + s*m_uy, 0);
+}
+
+///
+///@brief 距離sだけ転がるまでの時間
+///@param[in] s 距離 [mm]
+///@return 時間 [s]（止まるまでに届かない場合は負）
+///
+double BallPredictor::timeToDistance(double s) const
+{
+  if (s <= 0) {
+    return 0;
+  }
+  if (m_ball.isInvisible() || s > m_stopDistance) {
+    return -1;
+  }
+  //s = v t - a t^2 / 2 の小さい方の解
+  double d = m_speed*m_speed - 2*m_deceleration*s;
+  return (m_speed - sqrt(std::max(d, 0.0)))/m_deceleration;
+}
+
+///
+///@brief 点pと点qを通る直線にボールが達するまでの時間
+///@param[in] p 直線上の点
+///@param[in] q 直線上のもう一つの点
+///@return 時間 [s]（達しない場合は負）
+///
+double BallPredictor::timeToLine(const Orthogonal &p, const Orthogonal &q) const
+{
+  if (m_ball.isInvisible()) {
+    return -1;
+  }
+  //直線の法線方向の成分で考える
+  double nx = -(q.y-p.y);
+  double ny = q.x-p.x;
+  double h = (p.x-m_ball.x)*nx + (p.y-m_ball.y)*ny; //ボールから直線までの符号付き距離×|n|
+  double un = m_ux*nx + m_uy*ny;
+  if (h == 0) {
+    return 0;
+  }
+  if (un == 0 || h/un < 0) {
+    return -1;
+  }
+  return timeToDistance(h/un);
+}
+
+///
+///@brief 自チームのゴールライン（x = -FIELD_LENGTH2）を横切る点
+///@return 横切る点と時間（横切らない場合は見えていない値）
+///
+///- ゴールの幅の中かどうかは呼び出し側で y と GOAL_WIDTH2 を比べる．
+///
+Timed2D BallPredictor::crossOurGoalLine() const
+{
+  Timed2D r;
+  r.vanish();
+  double t = timeToLine(Orthogonal(-FIELD_LENGTH2,0,0), Orthogonal(-FIELD_LENGTH2,1,0));
+  if (t < 0) {
+    return r;
+  }
+  Orthogonal p = position(t);
+  return Timed2D(p.x, p.y, t);
+}
+
+///
+///@brief ロボットがボールに追いつける最も早い点
+///@param[in] robot ロボットの位置
+///@param[in] speed ロボットの歩く速さ [mm/s]（正の値）
+///@param[in] reach ボールに届いたとみなす中心間の距離 [mm]
+///@return 迎撃点と時間（ボールかロボットが見えていない場合，速さが0以下の場合は見えていない値）
+///
+///- ロボットはどの方向にも一定の速さで直進できるとみなす．
+///- update()で計算した軌道の点を順に調べ，追いつける最初の区間を二分法で細かくする．
+///- 探索時間内に追いつけない場合は止まる位置（またはm_horizon後の位置）で待つ時間を返す．
+///
+Timed2D BallPredictor::intercept(const Orthogonal &robot, double speed, double reach) const
+{
+  Timed2D r;
+  r.vanish();
+  if (m_ball.isInvisible() || robot.isInvisible() || !(speed > 0)) {
+    return r;
+  }
+  //f(t) = ロボットからt後のボールまでの距離 - 届く距離 - 歩ける距離 が0以下になる最初のt
+  int i;
+  double f = 0;
+  for (i=0; i<PREDICTOR_SAMPLE_NUM; i++) {
+    double dx = m_sampleX[i]-robot.x;
+    double dy = m_sampleY[i]-robot.y;
+    f = sqrt(dx*dx+dy*dy) - reach - speed*i*m_sampleTime;
+    if (f <= 0) {
+      break;
+    }
+  }
+  if (i == 0) {
+    return Timed2D(m_ball.x, m_ball.y, 0);
+  }
+  double t;
+  if (i == PREDICTOR_SAMPLE_NUM) {
+    //軌道の最後の点（止まった位置）で待つ
+    t = (PREDICTOR_SAMPLE_NUM-1)*m_sampleTime + f/speed;
+    return Timed2D(m_sampleX[PREDICTOR_SAMPLE_NUM-1], m_sampleY[PREDICTOR_SAMPLE_NUM-1], t);
+  } else {
+    double lo = (i-1)*m_sampleTime;
+    double hi = i*m_sampleTime;
+    for (int k=0; k<20; k++) {
+      double mid = 0.5*(lo+hi);
+      Orthogonal p = position(mid);
+      double dx = p.x-robot.x;
+      double dy = p.y-robot.y;
+      if (sqrt(dx*dx+dy*dy) - reach - speed*mid <= 0) {
+        hi = mid;
+      } else {
+        lo = mid;
+      }
+    }
+    t = hi;
+  }
+  Orthogonal p = position(t);
+  return Timed2D(p.x, p.y, t);
+}
+
+} //namespace odens
+
+///@} doxygenのためのコメント（消してはいけない）
@@ -9,8 +9,12 @@
 ///@addtogroup referee
 ///@{
 ///
+#include <cstring>
+#include <algorithm>
+#include <cmath>
 #include "referee.h"
 #include "referee.pb.h"
+#include "util.h"
 
 using namespace std;
 using boost::asio::ip::udp;
@@ -27,6 +31,90 @@ string RefereeInfo::stageStringTable[ref::StageNOI];
 ///SSL_Referee_Stage列挙型の項目に対応する文字列を設定するマクロ
 #define SET_STAGE_STRING_TABLE(x) RefereeInfo::stageStringTable[ref::x] = #x
 
+///
+///@brief レフェリーボックスの情報を初期値にする
+///@param[out] info レフェリーボックスの情報
+///@return なし
+///
+void Referee::clearInfo(RefereeInfo &info)
+{
+  info = RefereeInfo(); //値初期化で全て0にする
+  info.stage = ref::NORMAL_FIRST_HALF_PRE;
+  info.command = ref::HALT;
+  info.nextCommand = ref::HALT;
+  info.designatedPosition.vanish();
+}
+
+///
+///@brief チームの情報を取り出す
+///@param[out] t チームの情報
+///@param[in] team パースしたチームの情報
+///@return なし
+///
+///- 文字列と配列は固定長の領域に切り詰めて写すので，メモリを確保しない．
+///
+static void decodeTeam(RefereeTeamInfo &t, const SSL_Referee_TeamInfo &team)
+{
+  const std::string &name = team.name();
+  size_t length = std::min(name.size(), (size_t)REFEREE_TEAM_NAME_LENGTH);
+  memcpy(t.name, name.data(), length);
+  t.name[length] = '\0';
+  t.score = team.score();
+  t.redCards = team.red_cards();
+  t.yellowCardNum = std::min(team.yellow_card_times_size(), REFEREE_YELLOW_CARD_NUM);
+  for (int i=0; i<t.yellowCardNum; i++) {
+    t.yellowCardTimes[i] = team.yellow_card_times(i);
+  }
+  t.yellowCards = team.yellow_cards();
+  t.timeouts = team.timeouts();
+  t.timeoutTime = team.timeout_time();
+  t.goalie = team.goalie();
+  t.foulCounter = team.foul_counter();
+  t.ballPlacementFailures = team.ball_placement_failures();
+  t.canPlaceBall = team.can_place_ball();
+  t.maxAllowedBots = team.max_allowed_bots();
+}
+
+///
+///@brief パースしたパケットからレフェリーボックスの情報を取り出す
+///@param[out] info レフェリーボックスの情報（前回の値に上書きする）
+///@param[in] referee パースしたパケット
+///@return なし
+///
+///- referee.protoより新しいゲームコントローラの列挙値は，protobufが未知のフィールドとして
+///  扱うので，コマンドやステージが欠けたパケットになる．
+///  - コマンドが欠けていれば，安全側のSTOPとしunknownCommandを真にする．
+///  - ステージが欠けていれば，前回の値のままにする．
+///
+static void decode(RefereeInfo &info, const SSL_Referee &referee)
+{
+  info.packetTimestamp = referee.packet_timestamp();
+  if (referee.has_stage()) {
+    info.stage = static_cast<ref::Stage>(referee.stage());
+  }
+  info.stageTimeLeft = referee.stage_time_left();
+  info.unknownCommand = !referee.has_command();
+  info.command = info.unknownCommand ? ref::STOP : static_cast<ref::Command>(referee.command());
+  info.commandCounter = referee.command_counter();
+  info.commandTimestamp = referee.command_timestamp();
+  decodeTeam(info.team[BLUE], referee.blue());
+  decodeTeam(info.team[YELLOW], referee.yellow());
+  info.score[BLUE] = info.team[BLUE].score;
+  info.score[YELLOW] = info.team[YELLOW].score;
+  info.hasDesignatedPosition = referee.has_designated_position();
+  if (info.hasDesignatedPosition) {
+    info.designatedPosition = Orthogonal(referee.designated_position().x(), referee.designated_position().y(), 0);
+  } else {
+    info.designatedPosition.vanish();
+  }
+  info.hasBlueTeamOnPositiveHalf = referee.has_blue_team_on_positive_half();
+  info.blueTeamOnPositiveHalf = referee.blue_team_on_positive_half();
+  info.hasNextCommand = referee.has_next_command();
+  info.nextCommand = static_cast<ref::Command>(referee.next_command());
+  info.hasCurrentActionTimeRemaining = referee.has_current_action_time_remaining();
+  info.currentActionTimeRemaining = referee.current_action_time_remaining();
+}
+
 ///
 ///@brief 初期化の後にレフェリーボックスからの信号を受信するスレッドを開始する
 ///@param[in] address マルチキャストアドレス
@@ -38,13 +126,7 @@ bool Referee::start(string address, int port)
 {
   //cout << "Referee::start() 開始" << endl;
 
-  m_refereeInfo.packetTimestamp = 0;
-  m_refereeInfo.stage = ref::NORMAL_FIRST_HALF_PRE;
-  m_refereeInfo.stageTimeLeft = 0;
-  m_refereeInfo.command = ref::HALT;
-  m_refereeInfo.commandCounter = 0;
-  m_refereeInfo.score[BLUE] = 0;
-  m_refereeInfo.score[YELLOW] = 0;
+  clearInfo(m_refereeInfo);
   m_active = false;
 
   SET_COMMAND_STRING_TABLE(HALT);
@@ -63,6 +145,8 @@ bool Referee::start(string address, int port)
   SET_COMMAND_STRING_TABLE(TIMEOUT_BLUE);
   SET_COMMAND_STRING_TABLE(GOAL_YELLOW);
   SET_COMMAND_STRING_TABLE(GOAL_BLUE);
+  SET_COMMAND_STRING_TABLE(BALL_PLACEMENT_YELLOW);
+  SET_COMMAND_STRING_TABLE(BALL_PLACEMENT_BLUE);
 
   SET_STAGE_STRING_TABLE(NORMAL_FIRST_HALF_PRE);
   SET_STAGE_STRING_TABLE(NORMAL_FIRST_HALF);
@@ -107,36 +191,50 @@ bool Referee::start(string address, int port)
 ///
 ///- Referee::start()の中でこの関数を別スレッドで起動する．
 ///- この関数で例外が発生した場合にプログラムを終了してしまっていいのか？
+///- 受信バッファ，パース用のオブジェクト，取り出し先は繰り返しの外に置いて使い回す．
+///  protobufは同じオブジェクトにパースし直すと確保済みの領域を再利用する．
+///- 取り出しは排他制御の外で行い，ロックしている間は固定長の構造体を写すだけにする．
 ///
 void Referee::main()
 {
   cout << "Referee::main() 開始" << endl;
   try {
+    char buffer[65536];
+    SSL_Referee referee;
+    RefereeInfo info;
+    clearInfo(info);
     m_loop = true;
     while (m_loop) { 
       //パケット受信
-      char buffer[65536];
       udp::endpoint sender_endpoint;
       size_t length 
         = m_socket.receive_from(boost::asio::buffer(buffer, sizeof(buffer)), sender_endpoint);
 
-      //パース
-      SSL_Referee referee;
-      if (!referee.ParseFromArray(buffer, int(length))) {
+      //パース（知らない列挙値で必須フィールドが欠けても受け入れる）
+      if (!referee.ParsePartialFromArray(buffer, int(length))) {
         cerr << "Referee::main() パース失敗";
         continue;
       }
+      decode(info, referee);
+      double now = getTime();
       {
         boost::mutex::scoped_lock lock(m_mutex);
-        m_refereeInfo.packetTimestamp = referee.packet_timestamp();
-        m_refereeInfo.stage = static_cast<ref::Stage>(referee.stage());
-        m_refereeInfo.stageTimeLeft = referee.stage_time_left();
-        m_refereeInfo.command = static_cast<ref::Command>(referee.command());
-        m_refereeInfo.commandCounter = referee.command_counter();
-        m_refereeInfo.score[BLUE] = referee.blue().score();
-        m_refereeInfo.score[YELLOW] = referee.yellow().score();
+        m_refereeInfo = info;
         m_active = true;
+        //受信間隔の統計（逐次的に平均と分散を求める）
+        if (m_packets > 0) {
+          double d = now - m_lastArrival;
+          double delta = d - m_intervalMean;
+          m_intervalMean += delta/m_packets;
+          m_intervalM2 += delta*(d - m_intervalMean);
+          m_intervalMax = std::max(m_intervalMax, d);
+          m_interval = d;
+        }
+        m_packets++;
+        m_lastArrival = now;
       }
+      //get()で新しい情報が得られるようになってから知らせる
+      pushEvent(info, now);
     }
   } catch (exception& e) {
     cerr << "Referee::main() 例外: " << e.what() << endl;
@@ -144,32 +242,103 @@ void Referee::main()
   }
 }
 
+///
+///@brief コマンドのカウンタが変わっていれば，変化を待ち行列に入れる（受信スレッドから呼ぶ）
+///@param[in] info 今回受信したレフェリーボックスの情報
+///@param[in] arrivalTime 受信した時刻
+///@return なし
+///
+///- ロックフリーの単一生産者・単一消費者の待ち行列なので，メインループが止まっていても待たない．
+///- 待ち行列が一杯の場合は入れずに数を数える（古いものを優先して残す）．
+///  m_lastCounterを進めないので，同じカウンタの次のパケットで入れ直す．レフェリーボックスは
+///  同じ情報を送り続けるので，最新のコマンドは待ち行列が空けば必ず届く．
+///  その間に変わったコマンドはmissedに数える．
+///- 通知先が設定されていれば，コマンドが変わったときだけ（エッジで）メインループを起こす．
+///
+void Referee::pushEvent(const RefereeInfo &info, double arrivalTime)
+{
+  if (m_hasCounter && info.commandCounter == m_lastCounter) {
+    return;
+  }
+  RefereeEvent event;
+  event.command = info.command;
+  event.commandCounter = info.commandCounter;
+  event.commandTimestamp = info.commandTimestamp;
+  event.missed = m_hasCounter ? info.commandCounter - m_lastCounter - 1 : 0;
+  event.arrivalTime = arrivalTime;
+  if (!m_events.push(event)) {
+    m_droppedEvents++;
+    return;
+  }
+  m_hasCounter = true;
+  m_lastCounter = info.commandCounter;
+  if (m_notifier) {
+    m_notifier->notify(NotifyReferee);
+  }
+}
+
+///
+///@brief コマンドの変化を古い順に1つ取り出す（メインループから呼ぶ）
+///@param[out] event コマンドの変化
+///@retval true 取り出した
+///@retval false 待ち行列が空
+///
+///- 取り出すのは1つのスレッドに限る．
+///
+bool Referee::popEvent(RefereeEvent &event)
+{
+  return m_events.pop(event);
+}
+
 ///
 ///@brief レフェリーボックスからの情報を非同期に得る
 ///@param[out] info レフェリーボックスの情報
 ///@retval 0 正常終了
 ///@retval 1 未受信
-///@retval 2 途絶（前回とタイムスタンプの変化がない）
+///@retval 2 途絶（最後の受信からsetTimeout()で設定した時間が過ぎた）
 ///
 ///- m_mutex によって排他制御している．
+///- 受信の周期より速く呼んでも途絶とはみなさない（タイムスタンプではなく経過時間で判断する）．
+///- 途絶の場合もinfoには最後に受信した情報が入る．
 ///
 int Referee::get(RefereeInfo &info)
 {
-  static google::protobuf::uint64 prevTimestamp = 0;
   bool active;
+  double lastArrival;
   {
     boost::mutex::scoped_lock lock(m_mutex);
     active = m_active;
     info = m_refereeInfo;
+    lastArrival = m_lastArrival;
   }
   if (active == false) {
     return 1;
   }
-  if (info.packetTimestamp == prevTimestamp) {
-    return 2;
+  bool stale = getTime() - lastArrival > m_timeout;
+  if (stale && !m_stale) {
+    m_staleCount++;
   }
-  prevTimestamp = info.packetTimestamp;
-  return 0;
+  m_stale = stale;
+  return stale ? 2 : 0;
+}
+
+///
+///@brief 受信の状態を得る
+///@param[out] stat 受信間隔の統計
+///@return なし
+///
+///- staleCountはget()を呼ぶスレッドから呼んだ場合だけ正確である．
+///
+void Referee::getStatistics(RefereeStatistics &stat)
+{
+  boost::mutex::scoped_lock lock(m_mutex);
+  stat.packets = m_packets;
+  stat.interval = m_interval;
+  stat.meanInterval = m_intervalMean;
+  stat.jitter = (m_packets > 2) ? sqrt(m_intervalM2/(m_packets-2)) : 0;
+  stat.maxInterval = m_intervalMax;
+  stat.age = (m_packets > 0) ? getTime() - m_lastArrival : 0;
+  stat.staleCount = m_staleCount;
 }
 
 } //namespace odens
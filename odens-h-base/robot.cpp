@@ -10,6 +10,8 @@
 ///@{
 ///
 #include "robot.h"
+#include <cstring>
+#include <sstream>
 #include "util.h"
 
 using namespace std;
@@ -20,52 +22,99 @@ namespace odens {
 ///
 ///@brief ロボットへコマンドを送信するスレッドを開始する
 ///@param[in] port シリアルポートの名前
-///@param[in] interval 送信間隔 [ms]
+///@param[in] interval コマンドが変わらないときに再送する間隔 [ms]
 ///@retval false 正常終了
 ///@retval true 異常終了
 ///
 bool Robot::start(string port, int interval)
+{
+  if (open(m_io, port, interval, 0)) {
+    return true;
+  }
+  boost::thread thread(&Robot::main, this);
+  m_thread.swap(thread);
+  return false;
+}
+
+///
+///@brief シリアルポートを開いて最初の送信（と受信）を予約する
+///@param[in] io 使うIOサービス
+///@param[in] port シリアルポートの名前
+///@param[in] interval コマンドが変わらないときに再送する間隔 [ms]
+///@param[in] phase 最初の送信を遅らせる時間 [ms]（RobotManagerで送信の時期をずらすため）
+///@retval false 正常終了
+///@retval true 異常終了
+///
+///- ioを実行するスレッドはまだ動いていないか，動いていても予約した処理は同じスレッドで実行される．
+///
+bool Robot::open(io_service &io, string port, int interval, int phase)
 {
   initializePacket();
   m_interval = interval;
-  m_packet = m_packetTable[0];
+  m_com = 0;
+  m_sending = 0;
+  m_lastSent = static_cast<RobotCommand>(-1);
+  m_comTime = getTime() + 0.001*phase; //最初の送信を予定した時刻
+  m_writing = false;
+  m_kickPending = false;
+  m_pio = &io;
   try {
     //シリアルポートの初期設定
-    m_serial.open(port);
-    m_serial.set_option(serial_port_base::baud_rate(m_baud_rate));
-    m_serial.set_option(serial_port_base::character_size(8));
-    m_serial.set_option(serial_port_base::flow_control(serial_port_base::flow_control::none));
-    m_serial.set_option(serial_port_base::parity(m_parity));
-    m_serial.set_option(serial_port_base::stop_bits(serial_port_base::stop_bits::one));
-    //スレッド開始
-    boost::thread thread(&Robot::main, this);
-    m_thread.swap(thread);
+    m_serial.reset(new serial_port(io));
+    m_keepaliveTimer.reset(new deadline_timer(io));
+    m_writeTimer.reset(new deadline_timer(io));
+    m_serial->open(port);
+    m_serial->set_option(serial_port_base::baud_rate(m_baud_rate));
+    m_serial->set_option(serial_port_base::character_size(8));
+    m_serial->set_option(serial_port_base::flow_control(serial_port_base::flow_control::none));
+    m_serial->set_option(serial_port_base::parity(m_parity));
+    m_serial->set_option(serial_port_base::stop_bits(serial_port_base::stop_bits::one));
+    //最初の送信（と受信）を予約
+    if (phase > 0) {
+      m_keepaliveTimer->expires_from_now(boost::posix_time::milliseconds(phase));
+      m_keepaliveTimer->async_wait([this](const boost::system::error_code &ec) { onKeepalive(ec); });
+    } else {
+      io.post([this]() { startWrite(); });
+    }
+    if (m_receive) {
+      io.post([this]() { startRead(); });
+    }
   } catch(exception &e) {
-    cerr << "Robot::start() 例外: " << e.what() << endl;
+    cerr << "Robot::open() 例外: " << e.what() << endl;
     return true;
   }
   return false;
 }
 
 ///
-///@brief ロボットへパケットを繰り返し送信する（別スレッドで実行）
+///@brief シリアルポートとタイマを破棄して，自分のIOサービスを使う状態に戻す
+///@return なし
+///
+///- RobotManagerのスレッドを止めた後で呼ばれる．
+///
+void Robot::close()
+{
+  m_writeTimer.reset();
+  m_keepaliveTimer.reset();
+  m_serial.reset();
+  m_writing = false;
+  m_pio = &m_io;
+}
+
+///
+///@brief ロボットへパケットを送信する（別スレッドで実行）
 ///@return なし
 ///
 ///- Robot::start()の中でこの関数を別スレッドで起動する．
+///- 送信は全てm_ioの非同期操作の完了ハンドラで進める．このスレッドだけがハンドラを実行するので，
+///  m_writingやm_sendingは排他制御しなくてよい（RobotManagerで開始した場合も同様）．
 ///- この関数で例外が発生した場合にプログラムを終了してしまっていいのか？
 ///
 void Robot::main()
 {
   cout << "Robot::main() 開始" << endl;
   try {
-    m_loop = true;
-    while (m_loop) { 
-      {
-        boost::mutex::scoped_lock lock(m_mutex);
-        m_serial.write_some(buffer(m_packet.b));
-      }
-      msleep(m_interval);
-    }
+    m_io.run();
   } catch(exception &e) {
     cerr << "Robot::main() 例外: " << e.what() << endl;
     exit(1);
@@ -73,24 +122,403 @@ void Robot::main()
 }
 
 ///
-///@brief ロボットへ送るパケットを非同期に設定する
+///@brief setCommand()からの送信の依頼を処理する（送信スレッドで実行）
+///@return なし
+///
+///- 書き込み中なら，その完了ハンドラで新しいコマンドを送信するので何もしない．
+///
+void Robot::kick()
+{
+  m_kickPending = false;
+  if (!m_writing) {
+    m_keepaliveTimer->cancel();
+    startWrite();
+  }
+}
+
+///
+///@brief 現在のコマンドのパケットの非同期書き込みを始める（送信スレッドで実行）
+///@return なし
+///
+///- async_writeはパケットの全てのバイトを書き終えるか失敗するまで完了しない．
+///- m_writeTimeout [ms]を過ぎたら書き込みを取り消す．
+///- 連続値の移動指令なら，パケットをm_motionPacketに作ってから書き込む．
+///- 1つ前の書き込みとコマンドが異なれば，コマンドが変わってから書き込みを始めるまでの時間を求める．
+///
+void Robot::startWrite()
+{
+  m_sending = m_com.load();
+  m_writing = true;
+  m_writeStart = getTime();
+  if (m_sending != m_lastSent) {
+    m_writeDelay = static_cast<float>(std::max(0.0, m_writeStart - m_comTime.load()));
+  } else {
+    m_writeDelay = -1;
+  }
+  m_lastSent = m_sending;
+  const Packet *ppacket = &m_packetTable[0];
+  if (isMotionCommand(m_sending)) {
+    int q[3];
+    decodeMotion(m_sending, q);
+    if (!makeMotionPacket(q, m_motionPacket)) {
+      ppacket = &m_motionPacket;
+    }
+  } else {
+    ppacket = &m_packetTable[m_sending]; //start()の後は変更しないので参照してよい
+  }
+  const Packet &packet = *ppacket;
+  async_write(*m_serial, buffer(packet.b.data(), packet.size),
+    [this](const boost::system::error_code &ec, size_t bytes) { onWrite(ec, bytes); });
+  m_writeTimer->expires_from_now(boost::posix_time::milliseconds(m_writeTimeout));
+  m_writeTimer->async_wait([this](const boost::system::error_code &ec) { onWriteTimeout(ec); });
+}
+
+///
+///@brief 書き込みの完了ハンドラ（送信スレッドで実行）
+///@param[in] ec エラーコード
+///@param[in] bytes 書き込んだバイト数
+///@return なし
+///
+///- 書き込み中にコマンドが変わっていたら，すぐに次の書き込みを始める．
+///- そうでなければ，m_interval [ms]後の再送（キープアライブ）を予約する．
+///
+void Robot::onWrite(const boost::system::error_code &ec, size_t bytes)
+{
+  m_writing = false;
+  m_writeTimer->cancel();
+  if (ec && ec != error::operation_aborted) {
+    cerr << "Robot::onWrite() エラー: " << ec.message() << endl;
+    exit(1);
+  }
+  double now = getTime();
+  recordSend(bytes, !ec, now);
+  if (!ec && m_receive && expectsAck()) {
+    addPendingAck(now);
+  }
+  if (m_com.load() != m_sending) {
+    startWrite();
+    return;
+  }
+  m_keepaliveTimer->expires_from_now(boost::posix_time::milliseconds(m_interval));
+  m_keepaliveTimer->async_wait([this](const boost::system::error_code &ec) { onKeepalive(ec); });
+}
+
+///
+///@brief 書き込みの期限のタイマのハンドラ（送信スレッドで実行）
+///@param[in] ec エラーコード
+///@return なし
+///
+///- 期限を過ぎていたらシリアルポートの操作を取り消す．onWrite()がoperation_abortedで呼ばれ，
+///  次の書き込みに進む．
+///
+void Robot::onWriteTimeout(const boost::system::error_code &ec)
+{
+  if (ec == error::operation_aborted || !m_writing) {
+    return;
+  }
+  if (m_writeTimer->expires_at() > deadline_timer::traits_type::now()) {
+    return; //期限が延長されている（次の書き込みのタイマ）
+  }
+  uint32_t timeouts;
+  {
+    boost::mutex::scoped_lock lock(m_traceMutex);
+    timeouts = ++m_sendStats.timeouts;
+  }
+  cerr << "Robot: 書き込みが期限を過ぎた（" << timeouts << "回目）" << endl;
+  m_serial->cancel();
+}
+
+///
+///@brief 再送のタイマのハンドラ（送信スレッドで実行）
+///@param[in] ec エラーコード
+///@return なし
+///
+void Robot::onKeepalive(const boost::system::error_code &ec)
+{
+  if (ec == error::operation_aborted || m_writing) {
+    return;
+  }
+  startWrite();
+}
+
+///
+///@brief ロボットからの非同期読み込みを始める（送信スレッドで実行）
+///@return なし
+///
+void Robot::startRead()
+{
+  m_serial->async_read_some(buffer(m_rxBuffer.data()+m_rxSize, m_rxBuffer.size()-m_rxSize),
+    [this](const boost::system::error_code &ec, size_t bytes) { onRead(ec, bytes); });
+}
+
+///
+///@brief 読み込みの完了ハンドラ（送信スレッドで実行）
+///@param[in] ec エラーコード
+///@param[in] bytes 読み込んだバイト数
+///@return なし
+///
+///- 溜まったバイト列をparseReply()で応答に区切り，残りは次の読み込みまで持ち越す．
+///- 書き込みの期限切れでシリアルポートの操作を取り消した場合も，読み込みを続ける．
+///
+void Robot::onRead(const boost::system::error_code &ec, size_t bytes)
+{
+  if (ec && ec != error::operation_aborted) {
+    cerr << "Robot::onRead() エラー: " << ec.message() << "（受信を止める）" << endl;
+    return;
+  }
+  m_rxSize += bytes;
+  double now = getTime();
+  size_t pos = 0;
+  while (pos < m_rxSize) {
+    RobotReply reply;
+    size_t used = parseReply(m_rxBuffer.data()+pos, m_rxSize-pos, reply);
+    if (used == 0) {
+      break;
+    }
+    handleReply(reply, used, now);
+    pos += used;
+  }
+  if (pos == 0 && m_rxSize == m_rxBuffer.size()) {
+    //一杯になっても区切れないバイト列は捨てる
+    RobotReply reply;
+    reply.type = ReplyNone;
+    reply.size = 0;
+    handleReply(reply, m_rxSize, now);
+    pos = m_rxSize;
+  }
+  memmove(m_rxBuffer.data(), m_rxBuffer.data()+pos, m_rxSize-pos);
+  m_rxSize -= pos;
+  startRead();
+}
+
+///
+///@brief 書き込みを終えた送信を記録して統計に反映する（送信スレッドで実行）
+///@param[in] bytes 書き込んだバイト数
+///@param[in] ok 書き込みに成功したか？
+///@param[in] now 書き込みを終えた時刻 [s]
+///@return なし
+///
+void Robot::recordSend(size_t bytes, bool ok, double now)
+{
+  RobotSendRecord r;
+  r.time = m_writeStart;
+  r.command = m_sending;
+  r.bytes = static_cast<uint32_t>(bytes);
+  r.ok = ok;
+  r.duration = static_cast<float>(now - m_writeStart);
+  r.delay = m_writeDelay;
+  boost::mutex::scoped_lock lock(m_traceMutex);
+  m_trace[m_traceCount % ROBOT_TRACE_SIZE] = r;
+  m_traceCount++;
+  RobotSendStats &s = m_sendStats;
+  s.writes++;
+  s.bytes += bytes;
+  if (r.delay >= 0) {
+    s.changes++;
+    s.delayMean += (r.delay - s.delayMean)/s.changes;
+    s.delayMax = std::max(s.delayMax, static_cast<double>(r.delay));
+  } else {
+    s.keepalives++;
+  }
+  if (!ok) {
+    s.failures++;
+    return;
+  }
+  uint32_t n = s.writes - s.failures;
+  s.durationMean += (r.duration - s.durationMean)/n;
+  s.durationMax = std::max(s.durationMax, static_cast<double>(r.duration));
+}
+
+///
+///@brief 送信の統計を返す
+///@return 送信の統計
+///
+RobotSendStats Robot::getSendStats()
+{
+  boost::mutex::scoped_lock lock(m_traceMutex);
+  return m_sendStats;
+}
+
+///
+///@brief 保持している送信の記録を返す
+///@param[out] trace 送信の記録（古い順，最新のROBOT_TRACE_SIZE個まで）
+///@return 記録の数
+///
+size_t Robot::getSendTrace(std::vector<RobotSendRecord> &trace)
+{
+  boost::mutex::scoped_lock lock(m_traceMutex);
+  size_t n = static_cast<size_t>(std::min<uint64_t>(m_traceCount, ROBOT_TRACE_SIZE));
+  trace.resize(n);
+  for (size_t i = 0; i < n; i++) {
+    trace[i] = m_trace[(m_traceCount - n + i) % ROBOT_TRACE_SIZE];
+  }
+  return n;
+}
+
+///
+///@brief 書き込みを終えた送信をACK待ちにする（送信スレッドで実行）
+///@param[in] writeEnd 書き込みを終えた時刻 [s]
+///@return なし
+///
+void Robot::addPendingAck(double writeEnd)
+{
+  dropLostAcks(writeEnd);
+  m_ackSendTime = m_writeStart;
+  m_ackWriteEnd = writeEnd;
+  m_ackPending++;
+}
+
+///
+///@brief 区切った応答1つをテレメトリに反映する（送信スレッドで実行）
+///@param[in] reply 応答
+///@param[in] bytes 応答に使ったバイト数
+///@param[in] now 受信した時刻 [s]
+///@return なし
+///
+///- ACK（NAK）は書き込みを終えた最新の送信に対応させて往復時間を求め，
+///  それより前のACK待ちの送信は取りこぼしとする．
+///
+void Robot::handleReply(const RobotReply &reply, size_t bytes, double now)
+{
+  if (reply.type == ReplyAck || reply.type == ReplyNak) {
+    dropLostAcks(now);
+  }
+  boost::mutex::scoped_lock lock(m_telemetryMutex);
+  switch (reply.type) {
+  case ReplyAck:
+  case ReplyNak:
+    if (reply.type == ReplyAck) {
+      m_telemetry.acks++;
+    } else {
+      m_telemetry.naks++;
+    }
+    if (m_ackPending > 0) {
+      double rtt = now - m_ackSendTime;
+      m_telemetry.lostAcks += m_ackPending - 1;
+      m_ackPending = 0;
+      m_telemetry.rttSamples++;
+      m_telemetry.rttLast = rtt;
+      m_telemetry.rttMean += (rtt - m_telemetry.rttMean)/m_telemetry.rttSamples;
+      if (rtt > m_telemetry.rttMax) {
+        m_telemetry.rttMax = rtt;
+      }
+    }
+    break;
+  case ReplyData:
+    m_telemetry.dataReplies++;
+    m_telemetry.lastData = reply;
+    break;
+  default:
+    m_telemetry.badBytes += static_cast<uint32_t>(bytes);
+    return;
+  }
+  m_telemetry.lastReplyTime = now;
+}
+
+///
+///@brief 書き込みを終えてからm_ackTimeoutを過ぎたACK待ちの送信を取りこぼしとする（送信スレッドで実行）
+///@param[in] now 現在時刻 [s]
+///@return なし
+///
+void Robot::dropLostAcks(double now)
+{
+  if (m_ackPending > 0 && now - m_ackWriteEnd > m_ackTimeout) {
+    boost::mutex::scoped_lock lock(m_telemetryMutex);
+    m_telemetry.lostAcks += m_ackPending;
+    m_ackPending = 0;
+  }
+}
+
+///
+///@brief ロボットからの受信をまとめた情報を返す
+///@return テレメトリ（setReceive(true)でなければ全て0）
+///
+RobotTelemetry Robot::getTelemetry()
+{
+  boost::mutex::scoped_lock lock(m_telemetryMutex);
+  return m_telemetry;
+}
+
+///
+///@brief ロボットへ送るコマンドを非同期に設定する
 ///@param[in] com コマンド
 ///@return なし
 ///
-///- m_mutex によって排他制御している．
+///- コマンドは不可分変数に書くだけで，ミューテックスを使わない．
+///  書き込みが滞っていても呼び出し側が待たされることはない．
+///- 前回と異なるコマンドなら，送信スレッドへすぐに送信するように依頼する
+///  （依頼が処理待ちなら重ねて依頼しない）．
 ///
 void Robot::setCommand(const RobotCommand &com)
 {
-  if (com < 0 || m_packetTable.size() <= com) {
+  if (com < 0 || m_packetNum <= com) {
     cerr << "com = " << com << "は範囲外" << endl;
     return;
   }
   //m_packetTable[com].print();
-  {
-    boost::mutex::scoped_lock lock(m_mutex);
-    m_packet = m_packetTable[com];
+  putCommand(com);
+}
+
+///
+///@brief 連続値の移動指令を非同期に設定する
+///@param[in] motion 移動指令
+///@retval false 正常終了
+///@retval true 異常終了（このロボットは対応していない）
+///
+///- 量子化した値をRobotCommandに詰めて，setCommand()と同じ不可分変数で受け渡す．
+///  量子化した値が前回と同じなら送信を依頼しない．
+///
+bool Robot::setMotion(const RobotMotion &motion)
+{
+  if (!supportsMotion()) {
+    cerr << "連続値の移動指令に対応していない" << endl;
+    return true;
   }
-  m_com = com;
+  putCommand(encodeMotion(motion));
+  return false;
+}
+
+///
+///@brief 送信するコマンドを不可分変数に書き，変わっていれば送信スレッドへ送信を依頼する
+///@param[in] com コマンド（連続値の移動指令を含む）
+///@return なし
+///
+///- 変わった時刻を送信の記録のために残す．
+///- 依頼が処理待ちなら重ねて依頼しない．
+///
+void Robot::putCommand(RobotCommand com)
+{
+  if (m_com.load() == com) {
+    return;
+  }
+  m_comTime = getTime();
+  if (m_com.exchange(com) == com) {
+    return;
+  }
+  if (!m_kickPending.exchange(true)) {
+    m_pio->post([this]() { kick(); });
+  }
+}
+
+///
+///@brief コマンドのパケットを返す
+///@param[in] com コマンド（連続値の移動指令を含む）
+///@param[out] packet パケット
+///@retval false 正常終了
+///@retval true 異常終了（範囲外か，連続値の移動指令に対応していない）
+///
+bool Robot::getPacket(RobotCommand com, Packet &packet) const
+{
+  if (isMotionCommand(com)) {
+    int q[3];
+    decodeMotion(com, q);
+    return makeMotionPacket(q, packet);
+  }
+  if (m_packetNum <= com) {
+    return true;
+  }
+  packet = m_packetTable[com];
+  return false;
 }
 
 ///
@@ -100,7 +528,14 @@ void Robot::setCommand(const RobotCommand &com)
 ///
 string Robot::getCommandString(const RobotCommand &com)
 {
-  if (com < 0 || m_packetTable.size() <= com) {
+  if (isMotionCommand(com)) {
+    int q[3];
+    decodeMotion(com, q);
+    ostringstream os;
+    os << "Motion(" << q[0] << "," << q[1] << "," << q[2] << ")";
+    return os.str();
+  }
+  if (com < 0 || m_packetNum <= com) {
     cerr << "com = " << com << "は範囲外" << endl;
     return "";
   }
@@ -113,7 +548,7 @@ string Robot::getCommandString(const RobotCommand &com)
 ///
 string Robot::getCommandString()
 {
-  return m_commandStringTable[m_com];
+  return getCommandString(m_com.load());
 }
 
 ///
@@ -122,7 +557,7 @@ string Robot::getCommandString()
 ///
 size_t Robot::size()
 {
-  return m_packetTable.size();
+  return m_packetNum;
 }
 
 } //namespace odens
@@ -0,0 +1,100 @@
+﻿///
+///@file robotmanager.cpp
+///@brief RobotManagerクラスのメンバ関数の定義
+///@par Copyright
+/// Copyright (C) 2026 Team ODENS, Masutani Lab, Osaka Electro-Communication University
+///@par 履歴
+///- 2026/10/18 升谷 保博 新規作成（複数のロボットを1つのスレッドで動かす）
+///@addtogroup robot
+///@{
+///
+#include "robotmanager.h"
+
+using namespace std;
+
+namespace odens {
+
+///
+///@brief Robotを登録する（start()の前に呼ぶ）
+///@param[in] robot Robot（setReceive()などの設定は済ませておく）
+///@param[in] port シリアルポートの名前
+///@param[in] interval コマンドが変わらないときに再送する間隔 [ms]
+///@retval false 正常終了
+///@retval true 異常終了
+///
+bool RobotManager::add(Robot &robot, string port, int interval)
+{
+  if (m_thread.joinable()) {
+    cerr << "RobotManager::add() 開始後は登録できない" << endl;
+    return true;
+  }
+  Entry e = {&robot, port, interval};
+  m_entries.push_back(e);
+  return false;
+}
+
+///
+///@brief 登録した全てのRobotのシリアルポートを開いてスレッドを開始する
+///@retval false 正常終了
+///@retval true 異常終了
+///
+///- i番目のRobotの最初の送信をi×再送の間隔÷台数 [ms]遅らせる．
+///- stop()の後に再び開始できる（止めたm_ioを戻してから使う）．
+///
+bool RobotManager::start()
+{
+  if (m_thread.joinable()) {
+    cerr << "RobotManager::start() 開始済み" << endl;
+    return true;
+  }
+  m_io.reset();
+  int n = static_cast<int>(m_entries.size());
+  for (int i = 0; i < n; i++) {
+    Entry &e = m_entries[i];
+    if (e.robot->open(m_io, e.port, e.interval, i*e.interval/n)) {
+      stop();
+      return true;
+    }
+  }
+  m_work.reset(new boost::asio::io_service::work(m_io));
+  boost::thread thread(&RobotManager::main, this);
+  m_thread.swap(thread);
+  return false;
+}
+
+///
+///@brief スレッドを止めて，各Robotのシリアルポートを閉じる
+///@return なし
+///
+///- 各Robotのシリアルポートとタイマはm_ioで作ったものなので，m_ioより先に破棄する．
+///
+void RobotManager::stop()
+{
+  m_work.reset();
+  m_io.stop();
+  if (m_thread.joinable()) {
+    m_thread.join();
+  }
+  for (Entry &e : m_entries) {
+    e.robot->close();
+  }
+}
+
+///
+///@brief 全てのRobotの送受信を進める（別スレッドで実行）
+///@return なし
+///
+void RobotManager::main()
+{
+  cout << "RobotManager::main() 開始" << endl;
+  try {
+    m_io.run();
+  } catch(exception &e) {
+    cerr << "RobotManager::main() 例外: " << e.what() << endl;
+    exit(1);
+  }
+}
+
+} //namespace odens
+
+///@} doxygenのためのコメント（消してはいけない）
@@ -124,8 +124,12 @@ void Vision::main()
         boost::mutex::scoped_lock lock(m_mutex);
         m_visionInfo = info;
         m_active = true;
+        m_updated = true;
         m_condition.notify_all();
       }
+      if (m_notifier) {
+        m_notifier->notify(NotifyVision);
+      }
     }
     m_socket.close();
   } catch (exception& e) {
@@ -143,23 +147,55 @@ void Vision::main()
 ///
 ///- m_mutex によって排他制御し，m_condition で同期を取っている．
 ///- 別スレッドで新たな情報を受け取るか，タイムアウトになるまでこの関数は終わらない．
+///  前回取り出した後に既に受け取っていれば，待たずに戻る．
 ///- タイムアウトの設定は1秒で固定でいいのか？
 ///
 int Vision::get(VisionInfo &info)
 {
-  static int prevFrameNumber = 0;
   boost::mutex::scoped_lock lock(m_mutex);
-  if (m_condition.timed_wait(lock,boost::posix_time::milliseconds(1000))) {
-    info = m_visionInfo;
-    int d = info.frameNumber - prevFrameNumber;
-    prevFrameNumber = info.frameNumber;
-    if (d == 1) {
-      return 0;
-    } else {
-      return d; //前回とのフレーム番号の差が2以上
+  boost::system_time deadline = boost::get_system_time() + boost::posix_time::milliseconds(1000);
+  while (!m_updated) {
+    if (!m_condition.timed_wait(lock, deadline)) {
+      return -1; //タイムアウト
     }
+  }
+  return take(info);
+}
+
+///
+///@brief SSL-Visionサーバからの情報を待たずに得る
+///@param[in] info 位置情報
+///@retval 0 正常終了
+///@retval -1 前回から新しい情報がない（infoは変更しない）
+///@retval 2以上 受信の抜け（飛び）がある
+///
+///- Notifierで待つメインループから使う．
+///
+int Vision::tryGet(VisionInfo &info)
+{
+  boost::mutex::scoped_lock lock(m_mutex);
+  if (!m_updated) {
+    return -1;
+  }
+  return take(info);
+}
+
+///
+///@brief 受け取った情報を写し，フレーム番号の差を調べる（m_mutexをロックして呼ぶ）
+///@param[in] info 位置情報
+///@retval 0 正常終了
+///@retval 2以上 受信の抜け（飛び）がある
+///
+int Vision::take(VisionInfo &info)
+{
+  info = m_visionInfo;
+  m_updated = false;
+  int d = info.frameNumber - m_prevFrameNumber;
+  m_prevFrameNumber = info.frameNumber;
+  if (d == 1) {
+    return 0;
   } else {
-    return -1; //タイムアウト
+    return d; //前回とのフレーム番号の差が2以上
   }
 }
 
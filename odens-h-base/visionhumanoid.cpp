@@ -37,6 +37,40 @@ int VisionHumanoid::get(srInfo &sinfo, VisionInfo &vinfo)
   if (r < 0) {
     return r;
   }
+  convertInfo(sinfo, vinfo, oinfo);
+  return r;
+}
+
+///
+///@brief get()の待たない版
+///@param[out] sinfo ボールを1個にして，ロボット番号に変換した情報
+///@param[out] vinfo 座標変換だけをした情報
+///@retval 0 正常終了
+///@retval -1 前回から新しい情報がない（sinfo，vinfoは変更しない）
+///@retval 2以上 受信の抜け（飛び）がある
+///
+///- setNotifier()で設定したNotifierで待ってから呼ぶ．
+///
+int VisionHumanoid::tryGet(srInfo &sinfo, VisionInfo &vinfo)
+{
+  VisionInfo oinfo;
+  int r = m_vision.tryGet(oinfo);
+  if (r < 0) {
+    return r;
+  }
+  convertInfo(sinfo, vinfo, oinfo);
+  return r;
+}
+
+///
+///@brief Visionクラスから得た情報を変換する
+///@param[out] sinfo ボールを1個にして，ロボット番号に変換した情報
+///@param[out] vinfo 座標変換だけをした情報
+///@param[in] oinfo Visionクラスから得た情報
+///@return なし
+///
+void VisionHumanoid::convertInfo(srInfo &sinfo, VisionInfo &vinfo, const VisionInfo &oinfo)
+{
   //座標変換
   vinfo = oinfo;
   for (int i=0; i<oinfo.nBall; i++) {
@@ -88,7 +122,6 @@ int VisionHumanoid::get(srInfo &sinfo, VisionInfo &vinfo)
       }
     }
   }
-  return r;
 }
 
 ///
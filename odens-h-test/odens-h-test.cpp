@@ -20,6 +20,7 @@
 #include "config.h"
 #include "visionhumanoid.h"
 #include "referee.h"
+#include "notifier.h"
 #include "estimator.h"
 #include "ric30.h"
 #include "robotismini.h"
@@ -45,8 +46,12 @@ int main(int argc, char* argv[])
   draw.initialize(Config::MyColor, Config::MyNumber, drawInterval);
   inkeyInitialize();
 
+  //ビジョンとレフェリーボックスのどちらかの更新でメインループを起こす
+  Notifier notifier;
+
   //SSL-Visionの設定
   VisionHumanoid vh;
+  vh.setNotifier(&notifier);
   if (vh.start(Config::VisionAddress, Config::VisionPortNumber)) {
     cerr << "終了" << endl;
     return 1;
@@ -61,6 +66,9 @@ int main(int argc, char* argv[])
 
   //レフェリーボックスの設定
   Referee ref;
+  uint32_t droppedEvents = 0;
+  ref.setNotifier(&notifier);
+  ref.setTimeout(Config::RefereeTimeout);
   if (Config::Referee) {
     if (ref.start(Config::RefereeAddress, Config::RefereePortNumber)) {
      cerr << "終了" << endl;
@@ -69,8 +77,11 @@ int main(int argc, char* argv[])
   }
 
   Estimator estimator;
+  estimator.setParameter(Config::EstimatorParam);
 
   Game game(Config::MyColor);
+  game.setSetPlayTimeout(Config::SetPlayTimeout);
+  game.setBallMovedDistance(Config::BallMovedDistance);
 
   Task *ptask;
   cout << "RobotType: " << Config::RobotType << endl;
@@ -88,6 +99,10 @@ int main(int argc, char* argv[])
   }
 
   //ロボットとの通信の設定
+  ptask->setRobotReceive(Config::RobotReceive);
+  ptask->setParametricMotion(Config::ParametricMotion);
+  ptask->setMotionScheduler(Config::MotionScheduler);
+  ptask->setInterceptWalkSpeed(Config::InterceptWalkSpeed);
   if (ptask->startRobot(Config::RobotPortName, 50)) {
     cerr << "終了" << endl;
     return 1;
@@ -105,13 +120,22 @@ int main(int argc, char* argv[])
   }
   bool loop = true;
   double prevTime = getTime();
+  //レフェリーだけで起きた場合は前回の値を使うので，繰り返しの外に置く
+  srInfo sinfo;
+  srInfo sinfo2; //推定値
+  Timed2D ballVel(0, 0, 0);
+  BallMotion ballMotion = BallMotionNone;
+  sinfo.vanish();
+  sinfo2.vanish();
   while (loop) {
-    srInfo sinfo;
     VisionInfo vinfo;
     double btime = getTime();
-    int r = vh.get(sinfo, vinfo);
-    if (r < 0) {
+    //ビジョンの新しいフレームか，レフェリーの新しいコマンドが来るまで待つ
+    unsigned source = notifier.wait(1000);
+    int r = vh.tryGet(sinfo, vinfo);
+    if (source == NotifyNone) {
       cout << "ビジョンタイムアウト" << endl;
+      sinfo.vanish(); //古いフレームを使い続けない
     } else if ( r > 1 ) {
       cout << "ビジョンフレーム番号差: " << r << endl;
     }
@@ -121,13 +145,15 @@ int main(int argc, char* argv[])
     //  << ", vision: " << currentTime - btime << endl;
     prevTime = currentTime;
 
-    srInfo sinfo2; //推定値
-    Timed2D ballVel;
-    estimator.update(sinfo2,ballVel, sinfo, currentTime);
+    if (r >= 0 || source == NotifyNone) {
+      //新しいフレームがあるか，タイムアウトの場合だけ推定を更新する
+      estimator.update(sinfo2,ballVel,ballMotion, sinfo, currentTime);
+    }
 
     //レフェリーの信号を調べる
     RefereeInfo rinfo;
     string s;
+    bool refereeLost = false;
     if (Config::Referee) {
       switch (ref.get(rinfo)) {
       case 1:
@@ -135,6 +161,7 @@ int main(int argc, char* argv[])
         break;
       case 2:
         s = "途絶";
+        refereeLost = true;
         break;
       default:
         s = rinfo.commandString();
@@ -143,6 +170,20 @@ int main(int argc, char* argv[])
       s = "無効";
       rinfo.command = ref::NORMAL_START;
     }
+    //途中のコマンドを取りこぼさないように，コマンドの変化を古い順に処理する
+    //（一時停止中も処理して待ち行列を空にしておく）
+    RefereeEvent event;
+    GameMode mode;
+    bool consumed = false;
+    while (Config::Referee && ref.popEvent(event)) {
+      mode = game.consume(event, sinfo2.ball, ballMotion, estimator.getBallKickTime(), currentTime);
+      consumed = true;
+    }
+    //待ち行列が一杯で入れられなかったイベントは次のパケットで入れ直されるが，遅れるので知らせる
+    if (ref.getDroppedEvents() != droppedEvents) {
+      droppedEvents = ref.getDroppedEvents();
+      cerr << "レフェリーのイベントの待ち行列が一杯（累計" << droppedEvents << "回）" << endl;
+    }
     draw.string(-FIELD_LENGTH2,FIELD_WIDTH2+100,16,s.c_str());
   
     //キーの状態を調べる
@@ -184,16 +225,29 @@ int main(int argc, char* argv[])
     }
 
     //チームとしてのゲームの状態の判断
-    GameMode mode = game.decideMode(rinfo, sinfo2.ball, currentTime);
+    //レフェリーが途絶えた場合は安全側（STOP）のモードにする
+    //rinfoはイベントより古いことがあるので，コマンドは最後に処理したイベントのものを使う
+    ref::Command command;
+    if (refereeLost) {
+      mode = game.decideSafeMode(rinfo, sinfo2.ball, currentTime);
+      command = rinfo.command;
+    } else {
+      if (!Config::Referee) {
+        mode = game.decideMode(rinfo, sinfo2.ball, ballMotion, estimator.getBallKickTime(), currentTime);
+      } else if (!consumed) {
+        mode = game.update(sinfo2.ball, ballMotion, estimator.getBallKickTime(), currentTime);
+      }
+      command = game.getCommand();
+    }
 
-    if (rinfo.command == ref::HALT || rinfo.command == ref::STOP) {
+    if (command == ref::HALT || command == ref::STOP || mode.play == BallPlacement) {
       ptask->none();
     } else if (ptask->isLying(sinfo2)) {
       ptask->standUp(sinfo2, currentTime);
     } else if (sinfo2.ball.isInvisible()) {
       ptask->none();
     } else {
-      ptask->move(sinfo2, sinfo2.ball);
+      ptask->move(sinfo2, ptask->ballTarget(sinfo2, ballVel, ballMotion));
     }
 
     //フィールド描画
@@ -204,6 +258,14 @@ int main(int argc, char* argv[])
     //ログ出力
     logger.write(currentTime, sinfo, ballVel, rinfo, mode, ptask->getCommand());
   }
+  logger.writeTimeline(game.getTimeline());
+  std::vector<RobotSendRecord> trace;
+  ptask->getRobotSendTrace(trace);
+  logger.writeRobotTrace(ptask->getRobotSendStats(), trace);
+  MotionSchedulerStats ms = ptask->getMotionSchedulerStats();
+  cout << "コマンドの依頼 " << ms.requests << "，切り替え " << ms.switches
+    << "，保留 " << ms.deferred << "，取り消し " << ms.collapsed << endl;
+  cout << "レフェリーのイベントの待ち行列が一杯 " << ref.getDroppedEvents() << "回" << endl;
   draw.terminate();
   return 0;
 }
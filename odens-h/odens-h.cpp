@@ -62,6 +62,7 @@ int main(int argc, char* argv[])
 
   //レフェリーボックスの設定
   Referee ref;
+  uint32_t droppedEvents = 0;
   if (Config::Referee) {
     if (ref.start(Config::RefereeAddress, Config::RefereePortNumber)) {
      cerr << "終了" << endl;
@@ -77,7 +78,10 @@ int main(int argc, char* argv[])
   }
 
   Estimator estimator;
+  estimator.setParameter(Config::EstimatorParam);
   Game game(Config::MyColor);
+  game.setSetPlayTimeout(Config::SetPlayTimeout);
+  game.setBallMovedDistance(Config::BallMovedDistance);
   Role role(Config::MyColor, Config::MyNumber);
 
   //ロガー
@@ -107,10 +111,11 @@ int main(int argc, char* argv[])
 
     srInfo sinfo2; //推定値
 	Timed2D ballVel;
+	BallMotion ballMotion;
 
 	static Orthogonal ball1=sinfo.ball;
 
-    estimator.update(sinfo2,ballVel, sinfo, currentTime);
+    estimator.update(sinfo2,ballVel,ballMotion, sinfo, currentTime);
 
     //レフェリーの信号を調べる
     RefereeInfo rinfo;
@@ -130,6 +135,20 @@ int main(int argc, char* argv[])
       s = "無効";
       rinfo.command = Ref::NORMAL_START;
     }
+    //途中のコマンドを取りこぼさないように，コマンドの変化を古い順に処理する
+    //（一時停止中も処理して待ち行列を空にしておく）
+    RefereeEvent event;
+    GameMode mode;
+    bool consumed = false;
+    while (Config::Referee && ref.popEvent(event)) {
+      mode = game.consume(event, sinfo2.ball, ballMotion, estimator.getBallKickTime(), currentTime);
+      consumed = true;
+    }
+    //待ち行列が一杯で入れられなかったイベントは次のパケットで入れ直されるが，遅れるので知らせる
+    if (ref.getDroppedEvents() != droppedEvents) {
+      droppedEvents = ref.getDroppedEvents();
+      cerr << "レフェリーのイベントの待ち行列が一杯（累計" << droppedEvents << "回）" << endl;
+    }
     drawString(-FIELD_LENGTH2,FIELD_WIDTH2+100,16,s.c_str());
   
     //キーの状態を調べる
@@ -172,7 +191,12 @@ int main(int argc, char* argv[])
     }
 
     //チームとしてのゲームの状態の判断
-    GameMode mode = game.decideMode(rinfo, sinfo2.ball, currentTime);
+    //rinfoはイベントより古いことがあるので，処理したイベントがなければ最後のコマンドで決め直す
+    if (!Config::Referee) {
+      mode = game.decideMode(rinfo, sinfo2.ball, ballMotion, estimator.getBallKickTime(), currentTime);
+    } else if (!consumed) {
+      mode = game.update(sinfo2.ball, ballMotion, estimator.getBallKickTime(), currentTime);
+    }
 
     //行動決定
     role.run(com, ballVel,sinfo2,ball1, mode, currentTime);
@@ -188,6 +212,8 @@ int main(int argc, char* argv[])
 	if(!(sinfo.ball.isInvisible()))
 		ball1 = sinfo.ball;
   }
+  logger.writeTimeline(game.getTimeline());
+  cout << "レフェリーのイベントの待ち行列が一杯 " << ref.getDroppedEvents() << "回" << endl;
   drawTerminate();
   return 0;
 }
@@ -0,0 +1,126 @@
+﻿///
+///@file predictor-test.cpp
+///@brief BallPredictorクラスのテストプログラム
+///@par Copyright
+/// Copyright (C) 2026 Team ODENS, Masutani Lab, Osaka Electro-Communication University
+///@par 履歴
+///- 2026/10/18 升谷 保博 新規作成（ボールの軌道予測のテスト）
+///
+#include <iostream>
+#include <cmath>
+#include "sr.h"
+#include "predictor.h"
+
+using namespace std;
+using namespace odens;
+
+int errors = 0; ///<不一致の数
+
+///
+///@brief 値が期待値に近いかを調べ，違えば表示して数える
+///@param[in] name 項目の名前
+///@param[in] value 値
+///@param[in] expected 期待値
+///@param[in] tolerance 許容誤差
+///@return なし
+///
+void check(const char *name, double value, double expected, double tolerance = 1e-6)
+{
+  if (!(fabs(value-expected) <= tolerance)) {
+    cout << name << ": " << value << "（期待値 " << expected << "）" << endl;
+    errors++;
+  }
+}
+
+///
+///@brief 条件が成り立つかを調べ，成り立たなければ表示して数える
+///@param[in] name 項目の名前
+///@param[in] cond 条件
+///@return なし
+///
+void check(const char *name, bool cond)
+{
+  if (!cond) {
+    cout << name << ": 成り立たない" << endl;
+    errors++;
+  }
+}
+
+///predictor-testメイン関数
+int main()
+{
+  const Orthogonal invisible(INVISIBLE, INVISIBLE, INVISIBLE);
+  BallPredictor predictor;
+  check("減速度0を拒む", predictor.setDeceleration(0));
+  check("負の減速度を拒む", predictor.setDeceleration(-100));
+  check("正の減速度を受け付ける", !predictor.setDeceleration(400));
+
+  //x軸の正の向きに400[mm/s]で転がる．1[s]で止まり，200[mm]転がる．
+  predictor.update(Orthogonal(0, 0, 0), Timed2D(400, 0, 0));
+  check("止まるまでの時間", predictor.stopTime(), 1.0);
+  check("止まる位置x", predictor.stopPosition().x, 200.0);
+  check("止まる位置y", predictor.stopPosition().y, 0.0);
+  check("0.5[s]後の位置", predictor.position(0.5).x, 150.0);
+  check("2[s]後の位置", predictor.position(2.0).x, 200.0);
+  check("150[mm]転がるまでの時間", predictor.timeToDistance(150), 0.5);
+  check("届かない距離", predictor.timeToDistance(300) < 0);
+  check("x=100の直線に達する時間", predictor.timeToLine(Orthogonal(100, 0, 0), Orthogonal(100, 1, 0)),
+        (400-sqrt(400.0*400-2*400*100))/400);
+  check("後ろの直線には達しない", predictor.timeToLine(Orthogonal(-100, 0, 0), Orthogonal(-100, 1, 0)) < 0);
+  check("ゴールラインを横切らない", predictor.crossOurGoalLine().isInvisible());
+
+  //自チームのゴールへ向かって転がる
+  predictor.update(Orthogonal(-FIELD_LENGTH2+100, 50, 0), Timed2D(-400, 0, 0));
+  Timed2D cross = predictor.crossOurGoalLine();
+  check("ゴールラインを横切る", !cross.isInvisible());
+  check("横切る点x", cross.x, -FIELD_LENGTH2);
+  check("横切る点y", cross.y, 50.0);
+  check("横切る時間", cross.time, (400-sqrt(400.0*400-2*400*100))/400);
+
+  //迎撃点：ロボットが歩いて追いついたとき，ボールまでの距離が届く距離になる
+  const double speed = 300;
+  const double reach = ROBOT_RADIUS+BALL_RADIUS;
+  predictor.update(Orthogonal(0, 0, 0), Timed2D(600, 0, 0));
+  Orthogonal robot(300, 400, 0);
+  Timed2D p = predictor.intercept(robot, speed, reach);
+  check("迎撃点がある", !p.isInvisible());
+  if (!p.isInvisible()) {
+    Orthogonal b = predictor.position(p.time);
+    check("迎撃点は軌道上x", p.x, b.x);
+    check("迎撃点は軌道上y", p.y, b.y);
+    check("迎撃点で追いつく", sqrt((p.x-robot.x)*(p.x-robot.x)+(p.y-robot.y)*(p.y-robot.y)) - reach,
+          speed*p.time, 0.1);
+  }
+  //止まる位置より遠いロボットは止まる位置で待つ
+  Orthogonal far(2000, 2000, 0);
+  p = predictor.intercept(far, speed, reach);
+  check("遠いロボットは止まる位置x", p.x, predictor.stopPosition().x);
+  check("遠いロボットの時間", p.time,
+        (sqrt((p.x-far.x)*(p.x-far.x)+(p.y-far.y)*(p.y-far.y)) - reach)/speed, 1e-3);
+  //既に届く距離にいれば今の位置
+  p = predictor.intercept(Orthogonal(50, 0, 0), speed, reach);
+  check("届く距離のロボットの時間", p.time, 0.0);
+  check("歩く速さが0なら迎撃点はない", predictor.intercept(robot, 0, reach).isInvisible());
+  check("歩く速さが負なら迎撃点はない", predictor.intercept(robot, -1, reach).isInvisible());
+  check("ロボットが見えなければ迎撃点はない", predictor.intercept(invisible, speed, reach).isInvisible());
+
+  //止まっているボール
+  predictor.update(Orthogonal(100, 200, 0), Timed2D(0, 0, 0));
+  check("止まっているボールの時間", predictor.stopTime(), 0.0);
+  check("止まっているボールの位置", predictor.stopPosition().y, 200.0);
+  check("止まっているボールへの迎撃", predictor.intercept(robot, speed, reach).time,
+        (sqrt(200.0*200+200*200) - reach)/speed, 1e-3);
+
+  //見えていないボール
+  predictor.update(invisible, Timed2D(400, 0, 0));
+  check("見えないボールの迎撃点はない", predictor.intercept(robot, speed, reach).isInvisible());
+  check("見えないボールは直線に達しない", predictor.timeToLine(Orthogonal(100, 0, 0), Orthogonal(100, 1, 0)) < 0);
+  check("見えないボールはゴールラインを横切らない", predictor.crossOurGoalLine().isInvisible());
+
+  if (errors > 0) {
+    cout << "NG: " << errors << "件の不一致" << endl;
+    return 1;
+  }
+  cout << "OK: 軌道予測と迎撃点が期待通り" << endl;
+  return 0;
+}
@@ -24,6 +24,7 @@ int main(int argc, char* argv[])
   }
 
   Referee ref;
+  ref.setTimeout(Config::RefereeTimeout);
   if (ref.start(Config::RefereeAddress, Config::RefereePortNumber)) {
     cerr << "終了" << endl;
     return 1;
@@ -48,7 +49,33 @@ int main(int argc, char* argv[])
         << ", score[BLUE]=" << rinfo.score[BLUE] 
         << ", score[YELLOW]=" << rinfo.score[YELLOW]
         << endl;
+      for (int c=BLUE; c<=YELLOW; c++) {
+        const RefereeTeamInfo &t = rinfo.team[c];
+        cout << "  " << (c == BLUE ? "blue" : "yellow") << ": name=" << t.name
+          << ", goalie=" << t.goalie
+          << ", redCards=" << t.redCards
+          << ", yellowCards=" << t.yellowCards << "(" << t.yellowCardNum << ")"
+          << ", timeouts=" << t.timeouts
+          << ", timeoutTime=" << t.timeoutTime
+          << endl;
+      }
+      if (rinfo.hasDesignatedPosition) {
+        cout << "  designatedPosition=" << rinfo.designatedPosition << endl;
+      }
+      if (rinfo.hasNextCommand) {
+        cout << "  nextCommand=" << rinfo.nextCommandString() << endl;
+      }
     }
+    RefereeStatistics stat;
+    ref.getStatistics(stat);
+    cout << "  packets=" << stat.packets
+      << ", interval=" << stat.interval*1000 << "ms"
+      << ", mean=" << stat.meanInterval*1000 << "ms"
+      << ", jitter=" << stat.jitter*1000 << "ms"
+      << ", max=" << stat.maxInterval*1000 << "ms"
+      << ", age=" << stat.age*1000 << "ms"
+      << ", staleCount=" << stat.staleCount
+      << endl;
     msleep(1000);
   }
   return 0;
@@ -0,0 +1,726 @@
+﻿///
+///@file robot-sim.cpp
+///@brief 疑似端末（pty）によるロボットの代役（Linux専用）
+///@par Copyright
+/// Copyright (C) 2026 Team ODENS, Masutani Lab, Osaka Electro-Communication University
+///@par 履歴
+///- 2026/10/18 升谷 保博 新規作成（疑似端末によるロボットの代わり）
+///
+///- 疑似端末を開き，その従属側（/dev/pts/N）をロボットのシリアルポートの代わりにする．
+///- 受信したバイト列をロボットの種類ごとの形式で区切り，チェックサムなどを検査して，
+///  コマンドと受信時刻を記録する．RCB-4（KHR3，KXRL2）のACKを返すこともできる．
+///- -tを付けると，同じプロセスの中でRobotクラスを動かして自動テストを行う．
+///  RobotManagerで複数のロボットを1つのスレッドから動かすテストと，
+///  MotionSchedulerがコマンドの切り替えを歩行の区切りまで保留するかのテストも行う．
+///
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <cstdlib>
+#include <memory>
+#include "util.h"
+#include "robot.h"
+#include "robotmanager.h"
+#include "motionscheduler.h"
+#include "ric30.h"
+#include "robotismini.h"
+#include "khr3.h"
+#include "kxrl2.h"
+
+using namespace std;
+using namespace odens;
+
+#ifdef LINUX //Linux
+#include <fcntl.h>
+#include <poll.h>
+#include <termios.h>
+#include <unistd.h>
+
+///
+///@brief 受信したパケット1つの記録
+///
+struct SimFrame {
+  double time; ///<受信時刻 [s]
+  int command; ///<コマンド（表にないパケットなら-1）
+};
+
+///
+///@brief ロボットの種類ごとのパケットの形式
+///
+struct SimProtocol {
+  const char *type;            ///<ロボットの種類（設定ファイルのRobotType）
+  const Packet *table;         ///<パケットの表
+  size_t num;                  ///<パケットの表の要素数
+  size_t size;                 ///<パケットの長さ [byte]
+  uint8_t header[2];           ///<パケットの先頭の2byte
+  bool (*isValid)(const Packet &p); ///<パケットの検査（チェックサムなど）
+  bool canReply;               ///<ACKを返せるか？
+};
+
+///
+///@brief プロトコルの記述子DからSimProtocolを作る
+///
+template <class D>
+SimProtocol makeSimProtocol()
+{
+  return SimProtocol{D::name(), D::table(), D::commandNum, D::size,
+    {baseByte<D>(0), baseByte<D>(1)}, &isProtocolPacket<D>, D::reply == ReplyFormatRcb4};
+}
+
+///対応しているロボットの種類
+static const SimProtocol protocols[] = {
+  makeSimProtocol<ric30::Protocol>(),
+  makeSimProtocol<khr3::Protocol>(),
+  makeSimProtocol<kxrl2::Protocol>(),
+  makeSimProtocol<robotismini::Protocol>(),
+};
+
+///
+///@brief 疑似端末でロボットの代わりをするクラス
+///
+class RobotSimulator {
+private:
+  const SimProtocol &m_protocol; ///<パケットの形式
+  bool m_reply;                  ///<ACKを返すか？
+  int m_master;                  ///<疑似端末の主側のファイル記述子
+  std::string m_slaveName;       ///<疑似端末の従属側の名前
+  boost::thread m_thread;        ///<受信スレッド
+  boost::atomic<bool> m_loop;    ///<受信スレッドの繰り返しのフラグ
+  boost::mutex m_mutex;          ///<以下の記録のためのミューテックス
+  std::vector<SimFrame> m_frames;///<受信したパケットの記録
+  uint32_t m_badFrames;          ///<検査に通らなかったパケットの数
+  uint32_t m_skippedBytes;       ///<先頭が合わずに読み捨てたバイト数
+
+  void main();
+  int decode(const uint8_t *data);
+public:
+  ///
+  ///@brief コンストラクタ
+  ///@param[in] protocol パケットの形式
+  ///@param[in] reply ACKを返すか？
+  ///
+  RobotSimulator(const SimProtocol &protocol, bool reply)
+    :m_protocol(protocol), m_loop(false)
+  {
+    m_reply = reply && protocol.canReply;
+    m_master = -1;
+    m_badFrames = 0;
+    m_skippedBytes = 0;
+  }
+  ///デストラクタ
+  ~RobotSimulator()
+  {
+    stop();
+    if (m_master >= 0) {
+      close(m_master);
+    }
+  }
+  bool start();
+  void stop();
+  ///
+  ///@brief 疑似端末の従属側の名前を返す（RobotPortNameに使う）
+  ///
+  const std::string &getPortName() const
+  {
+    return m_slaveName;
+  }
+  void getFrames(std::vector<SimFrame> &frames, uint32_t &badFrames, uint32_t &skippedBytes);
+};
+
+///
+///@brief 疑似端末を開いて受信スレッドを開始する
+///@retval false 正常終了
+///@retval true 異常終了
+///
+bool RobotSimulator::start()
+{
+  m_master = posix_openpt(O_RDWR | O_NOCTTY);
+  if (m_master < 0 || grantpt(m_master) != 0 || unlockpt(m_master) != 0) {
+    cerr << "疑似端末を開けない" << endl;
+    return true;
+  }
+  termios tio;
+  tcgetattr(m_master, &tio);
+  cfmakeraw(&tio);
+  tcsetattr(m_master, TCSANOW, &tio);
+  m_slaveName = ptsname(m_master);
+  m_loop = true;
+  boost::thread thread(&RobotSimulator::main, this);
+  m_thread.swap(thread);
+  return false;
+}
+
+///
+///@brief 受信スレッドを止める
+///@return なし
+///
+void RobotSimulator::stop()
+{
+  if (m_thread.joinable()) {
+    m_loop = false;
+    m_thread.join();
+  }
+}
+
+///
+///@brief パケットを表と照合してコマンドを求める
+///@param[in] data パケットのバイト列（m_protocol.size byte）
+///@return 最初に一致したコマンド（同じパケットのコマンドは区別できない），一致しなければ-1
+///
+int RobotSimulator::decode(const uint8_t *data)
+{
+  for (size_t i = 0; i < m_protocol.num; i++) {
+    if (std::equal(data, data+m_protocol.size, m_protocol.table[i].b.begin())) {
+      return static_cast<int>(i);
+    }
+  }
+  return -1;
+}
+
+///
+///@brief 受信したバイト列をパケットに区切って記録する（別スレッドで実行）
+///@return なし
+///
+void RobotSimulator::main()
+{
+  const uint8_t ack[] = {0x04, 0x00, 0x06, 0x0a};
+  std::vector<uint8_t> buf;
+  uint8_t rx[256];
+  while (m_loop) {
+    pollfd pfd = {m_master, POLLIN, 0};
+    if (poll(&pfd, 1, 50) <= 0) {
+      continue;
+    }
+    ssize_t n = read(m_master, rx, sizeof(rx));
+    if (n <= 0) {
+      continue;
+    }
+    double now = getTime();
+    buf.insert(buf.end(), rx, rx+n);
+    size_t pos = 0;
+    while (buf.size() - pos >= m_protocol.size) {
+      const uint8_t *p = &buf[pos];
+      if (p[0] != m_protocol.header[0] || p[1] != m_protocol.header[1]) {
+        boost::mutex::scoped_lock lock(m_mutex);
+        m_skippedBytes++;
+        pos++;
+        continue;
+      }
+      Packet packet = Packet();
+      std::copy(p, p+m_protocol.size, packet.b.begin());
+      packet.size = m_protocol.size;
+      boost::mutex::scoped_lock lock(m_mutex);
+      if (!m_protocol.isValid(packet)) {
+        m_badFrames++;
+        pos++;
+        continue;
+      }
+      SimFrame f;
+      f.time = now;
+      f.command = decode(p);
+      m_frames.push_back(f);
+      pos += m_protocol.size;
+      if (m_reply) {
+        if (write(m_master, ack, sizeof(ack)) != sizeof(ack)) {
+          cerr << "ACKを書き込めない" << endl;
+        }
+      }
+    }
+    buf.erase(buf.begin(), buf.begin()+pos);
+  }
+}
+
+///
+///@brief 受信したパケットの記録を得る
+///@param[out] frames 受信したパケット（時刻の順）
+///@param[out] badFrames 検査に通らなかったパケットの数
+///@param[out] skippedBytes 先頭が合わずに読み捨てたバイト数
+///@return なし
+///
+void RobotSimulator::getFrames(std::vector<SimFrame> &frames, uint32_t &badFrames, uint32_t &skippedBytes)
+{
+  boost::mutex::scoped_lock lock(m_mutex);
+  frames = m_frames;
+  badFrames = m_badFrames;
+  skippedBytes = m_skippedBytes;
+}
+
+///
+///@brief ロボットの種類に対応するRobotを作る
+///@param[in] type ロボットの種類
+///@return Robot（未対応の種類ならnullptr）
+///
+Robot *newRobot(const std::string &type)
+{
+  if (type == "RIC30") {
+    return new ric30::RIC30();
+  } else if (type == "ROBOTISMINI") {
+    return new robotismini::ROBOTISMINI();
+  } else if (type == "KHR3") {
+    return new khr3::KHR3();
+  } else if (type == "KXRL2") {
+    return new kxrl2::KXRL2();
+  }
+  return nullptr;
+}
+
+///
+///@brief 自動テストの1台分の状態
+///
+struct SimCase {
+  const SimProtocol *protocol;        ///<パケットの形式
+  std::unique_ptr<RobotSimulator> sim;///<ロボットの代役
+  std::unique_ptr<Robot> robot;       ///<テストするRobot
+  std::vector<int> script;            ///<送るコマンド（連続値の移動指令は-1）
+  std::vector<RobotMotion> motion;    ///<scriptが-1のときに送る移動指令
+};
+
+///
+///@brief 自動テストの結果を調べて表示する
+///@param[in] c 1台分の状態（Robotは止めた後）
+///@param[in] sendTime scriptの各コマンドを送った時刻 [s]
+///@param[in] idleStart 変化がない間の始まりの時刻 [s]
+///@param[in] idleEnd 変化がない間の終わりの時刻 [s]
+///@param[in] interval 再送の間隔 [ms]
+///@param[in] telemetry Robotのテレメトリ
+///@param[in] stats Robotの送信の統計
+///@retval false 合格
+///@retval true 不合格
+///
+///- Robotが数えた書き込みの回数とコマンドの変化の回数が，受信側と一致するかも調べる
+///  （止める間際の1回の差は許す）．
+///
+bool checkCase(SimCase &c, const std::vector<double> &sendTime, double idleStart, double idleEnd,
+  int interval, const RobotTelemetry &telemetry, const RobotSendStats &stats)
+{
+  const SimProtocol &protocol = *c.protocol;
+  std::vector<SimFrame> frames;
+  uint32_t badFrames, skippedBytes;
+  c.sim->getFrames(frames, badFrames, skippedBytes);
+
+  //コマンドの変化の列と，届くまでの時間
+  std::vector<int> changes;
+  std::vector<double> latency;
+  int prev = -2;
+  int idleFrames = 0;
+  for (size_t i = 0; i < frames.size(); i++) {
+    if (frames[i].command != prev) {
+      prev = frames[i].command;
+      changes.push_back(prev);
+      size_t k = changes.size() - 2; //先頭は開始直後のCommandNone
+      if (changes.size() >= 2 && k < c.script.size() && c.script[k] == prev) {
+        latency.push_back(frames[i].time - sendTime[k]);
+      }
+    }
+    if (frames[i].time > idleStart + 0.001*interval && frames[i].time <= idleEnd) {
+      idleFrames++;
+    }
+  }
+  bool ng = false;
+  std::vector<int> expected(1, 0);
+  expected.insert(expected.end(), c.script.begin(), c.script.end());
+  if (changes != expected) {
+    cout << "NG: コマンドの変化の列が一致しない" << endl;
+    ng = true;
+  }
+  if (badFrames > 0 || skippedBytes > 0) {
+    cout << "NG: 検査に通らないパケット " << badFrames << "，読み捨て " << skippedBytes << " [byte]" << endl;
+    ng = true;
+  }
+  //10間隔の間に9回程度の再送がある
+  if (idleFrames < 7 || idleFrames > 11) {
+    cout << "NG: 変化がない間の再送 " << idleFrames << "回" << endl;
+    ng = true;
+  }
+  std::sort(latency.begin(), latency.end());
+  double median = latency.empty() ? 0 : latency[latency.size()/2];
+  double worst = latency.empty() ? 0 : latency.back();
+  if (latency.size() != c.script.size() || worst > 0.02) {
+    cout << "NG: コマンドが変わってから届くまでの時間" << endl;
+    ng = true;
+  }
+  int64_t diff = static_cast<int64_t>(stats.writes) - static_cast<int64_t>(frames.size());
+  if (diff < -1 || diff > 1 || stats.failures > 0 || stats.changes != c.script.size() + 1
+    || stats.bytes != stats.writes*protocol.size || stats.delayMax > 0.02) {
+    cout << "NG: 送信の統計 書き込み " << stats.writes << "，変化 " << stats.changes
+      << "，失敗 " << stats.failures << endl;
+    ng = true;
+  }
+  cout << fixed << setprecision(3);
+  cout << protocol.type << ": パケット " << frames.size() << "，コマンド " << c.script.size()
+    << "，遅れ 中央値 " << median*1000 << " 最大 " << worst*1000 << " [ms]，再送 " << idleFrames << "回";
+  if (protocol.canReply) {
+    cout << "，ACK " << telemetry.acks << " 取りこぼし " << telemetry.lostAcks
+      << " 往復時間 " << telemetry.rttMean*1000 << " [ms]";
+    if (telemetry.acks == 0 || telemetry.lostAcks > 1) {
+      ng = true;
+      cout << endl << "NG: ACK";
+    }
+  }
+  cout << endl << "  送信 " << stats.writes << "，書き込みの時間 平均 " << stats.durationMean*1000
+    << " 最大 " << stats.durationMax*1000 << " [ms]，変化から書き込みまで 平均 " << stats.delayMean*1000
+    << " 最大 " << stats.delayMax*1000 << " [ms]" << endl;
+  return ng;
+}
+
+///
+///@brief ロボットについて自動テストを行う
+///@param[in] protocols テストするロボットの形式
+///@param[in] manager 全てのロボットを1つのRobotManagerで動かすか？（偽ならRobotごとにスレッドを使う）
+///@retval false 合格
+///@retval true 不合格
+///
+///- パケットが他のコマンドと区別できるコマンドを30msごとに順に送り，受信したコマンドの変化の
+///  列が一致するか，検査に通らないパケットがないか，コマンドが変わってから届くまでの時間，
+///  変化がない間の再送の間隔を調べる．ACKを返せる形式では，ACKの往復時間も調べる．
+///- 連続値の移動指令に対応するロボットでは，表にないパケット（-1）が届き，
+///  全て0の指令でCommandNoneと同じパケットに戻ることも調べる．
+///- 複数のロボットには同じ時刻にそれぞれのコマンドを送る．
+///
+bool testRobots(const std::vector<const SimProtocol *> &protocols, bool manager)
+{
+  const int interval = 50; //再送の間隔 [ms]
+  std::vector<SimCase> cases(protocols.size());
+  RobotManager robotManager;
+  size_t steps = 0;
+  for (size_t n = 0; n < cases.size(); n++) {
+    SimCase &c = cases[n];
+    const SimProtocol &protocol = *protocols[n];
+    c.protocol = &protocol;
+    c.sim.reset(new RobotSimulator(protocol, true));
+    if (c.sim->start()) {
+      return true;
+    }
+    c.robot.reset(newRobot(protocol.type));
+    c.robot->setReceive(protocol.canReply);
+    if (manager) {
+      robotManager.add(*c.robot, c.sim->getPortName(), interval);
+    } else if (c.robot->start(c.sim->getPortName(), interval)) {
+      return true;
+    }
+    //区別できるコマンド
+    for (size_t k = 1; k < protocol.num; k++) {
+      bool unique = true;
+      for (size_t i = 0; i < protocol.num; i++) {
+        if (i != k && std::equal(protocol.table[i].b.begin(), protocol.table[i].b.begin()+protocol.size,
+          protocol.table[k].b.begin())) {
+          unique = false;
+        }
+      }
+      if (unique) {
+        c.script.push_back(static_cast<int>(k));
+      }
+    }
+    if (c.robot->supportsMotion()) {
+      const RobotMotion motion[2] = {{0.5, -0.25, 1}, {0, 0, 0}};
+      c.script.push_back(-1);
+      c.motion.push_back(motion[0]);
+      c.script.push_back(0);
+      c.motion.push_back(motion[1]);
+    }
+    steps = std::max(steps, c.script.size());
+  }
+  if (manager && robotManager.start()) {
+    return true;
+  }
+  msleep(200);
+
+  //コマンドを順に送る
+  std::vector<std::vector<double>> sendTime(cases.size());
+  for (size_t k = 0; k < steps; k++) {
+    for (size_t n = 0; n < cases.size(); n++) {
+      SimCase &c = cases[n];
+      if (k >= c.script.size()) {
+        continue;
+      }
+      sendTime[n].push_back(getTime());
+      size_t m = c.script.size() - c.motion.size(); //移動指令の始まり
+      if (k >= m) {
+        c.robot->setMotion(c.motion[k-m]);
+      } else {
+        c.robot->setCommand(c.script[k]);
+      }
+    }
+    msleep(30);
+  }
+  //変化がない間の再送を調べる
+  double idleStart = getTime();
+  msleep(10*interval);
+  double idleEnd = getTime();
+  std::vector<RobotTelemetry> telemetry;
+  for (SimCase &c : cases) {
+    telemetry.push_back(c.robot->getTelemetry());
+  }
+  robotManager.stop();
+  bool ng = false;
+  for (size_t n = 0; n < cases.size(); n++) {
+    RobotSendStats stats = cases[n].robot->getSendStats();
+    cases[n].robot.reset();
+    msleep(10); //書き込んだバイト列が届くのを待つ
+    cases[n].sim->stop();
+    ng = checkCase(cases[n], sendTime[n], idleStart, idleEnd, interval, telemetry[n], stats) || ng;
+  }
+  return ng;
+}
+
+///
+///@brief MotionSchedulerについて自動テストを行う（KXRL2の形式で）
+///@retval false 合格
+///@retval true 不合格
+///
+///- 10msごとにコマンドを依頼し，受信したコマンドの変化の列と時刻から次のことを調べる．
+///  - 前進の1歩目の途中で旋回と前進を交互に依頼しても切り替えない（保留を取り消す）．
+///  - 旋回の依頼は1歩目の区切り（minDuration）で切り替える．
+///  - force()はすぐに切り替える．
+///  - 起き上がりの動作の列の各段を決めた時間だけ続ける．
+///
+bool testScheduler()
+{
+  using namespace kxrl2;
+  const int interval = 50; //再送の間隔 [ms]
+  const SimProtocol &protocol = protocols[2];
+  RobotSimulator sim(protocol, true);
+  if (sim.start()) {
+    return true;
+  }
+  std::unique_ptr<KXRL2> robot(new KXRL2());
+  robot->setReceive(true);
+  if (robot->start(sim.getPortName(), interval)) {
+    return true;
+  }
+  MotionScheduler scheduler;
+  scheduler.setRobot(*robot, motionTimingTable, CommandNOI);
+  scheduler.setEnabled(true);
+  const MotionStep standUpSequence[] = {{CommandNone, 0.167}, {StandUp, 0.166}}; //TaskKXRL2::standUp()と同じ
+  msleep(200);
+
+  //1歩目の途中で旋回と前進を交互に依頼してから，旋回を依頼し続ける
+  double t0 = getTime();
+  for (int i = 0; i < 50; i++) {
+    Command com = TurnLeft;
+    if (getTime() - t0 < 0.25 && i % 2 == 0) {
+      com = Forward;
+    }
+    scheduler.request(com, getTime());
+    msleep(10);
+  }
+  scheduler.force(CommandNone, getTime());
+  msleep(50);
+  //起き上がりの動作の列
+  scheduler.startSequence(standUpSequence, sizeof(standUpSequence)/sizeof(standUpSequence[0]), getTime());
+  while (scheduler.isSequenceRunning()) {
+    scheduler.update(getTime());
+    msleep(10);
+  }
+  scheduler.request(CommandNone, getTime());
+  msleep(100);
+  MotionSchedulerStats stats = scheduler.getStats();
+  robot.reset();
+  msleep(10); //書き込んだバイト列が届くのを待つ
+  sim.stop();
+
+  std::vector<SimFrame> frames;
+  uint32_t badFrames, skippedBytes;
+  sim.getFrames(frames, badFrames, skippedBytes);
+  std::vector<int> changes;
+  std::vector<double> changeTime;
+  for (const SimFrame &f : frames) {
+    if (changes.empty() || f.command != changes.back()) {
+      changes.push_back(f.command);
+      changeTime.push_back(f.time);
+    }
+  }
+  bool ng = false;
+  const int expected[] = {CommandNone, Forward, TurnLeft, CommandNone, StandUp, CommandNone};
+  if (changes != std::vector<int>(expected, expected+6)) {
+    cout << "NG: コマンドの変化の列が一致しない" << endl;
+    return true;
+  }
+  double forward = changeTime[2] - changeTime[1];
+  double standUp = changeTime[5] - changeTime[4];
+  cout << fixed << setprecision(3);
+  cout << "MotionScheduler: 前進 " << forward*1000 << " [ms]（最短 " << motionTimingTable[Forward].minDuration*1000
+    << "），起き上がり " << standUp*1000 << " [ms]（" << standUpSequence[1].duration*1000
+    << "），依頼 " << stats.requests << "，切り替え " << stats.switches
+    << "，保留 " << stats.deferred << "，取り消し " << stats.collapsed << endl;
+  if (forward < motionTimingTable[Forward].minDuration - 0.005 || forward > motionTimingTable[Forward].minDuration + 0.03) {
+    cout << "NG: 前進の1歩目の途中で切り替えた" << endl;
+    ng = true;
+  }
+  if (standUp < standUpSequence[1].duration - 0.005 || standUp > standUpSequence[1].duration + 0.03) {
+    cout << "NG: 起き上がりの段の時間" << endl;
+    ng = true;
+  }
+  if (stats.switches != 5 || stats.collapsed == 0 || badFrames > 0) {
+    cout << "NG: 切り替えの統計" << endl;
+    ng = true;
+  }
+  return ng;
+}
+
+///
+///@brief RCB-4の応答の区切り方を調べる
+///@retval false 合格
+///@retval true 不合格
+///
+///- 長さとして読める1byteが紛れ込んでも，後に続くACKとNAKを待たせずに区切る．
+///
+bool testRcb4Reply()
+{
+  const uint8_t data[] = {0x20, 0x04, 0x00, 0x06, 0x0a, 0x04, 0x00, 0x15, 0x19};
+  RobotReply reply;
+  bool ng = false;
+  if (parseRcb4Reply(data, 3, reply) != 0) { //まだ判断できない
+    ng = true;
+  }
+  if (parseRcb4Reply(data, 5, reply) != 1 || reply.type != ReplyNone) {
+    ng = true;
+  }
+  if (parseRcb4Reply(data+1, 8, reply) != 4 || reply.type != ReplyAck) {
+    ng = true;
+  }
+  if (parseRcb4Reply(data+5, 4, reply) != 4 || reply.type != ReplyNak) {
+    ng = true;
+  }
+  if (ng) {
+    cout << "NG: RCB-4の応答の区切り" << endl;
+  }
+  return ng;
+}
+
+///
+///@brief RobotManagerを止めてから再び開始できるかのテストを行う
+///@param[in] protocol パケットの形式
+///@retval false 合格
+///@retval true 不合格
+///
+///- stop()の後のstart()でもパケットが届くことを調べる．
+///
+bool testRestart(const SimProtocol &protocol)
+{
+  RobotSimulator sim(protocol, false);
+  if (sim.start()) {
+    return true;
+  }
+  std::unique_ptr<Robot> robot(newRobot(protocol.type));
+  RobotManager robotManager;
+  robotManager.add(*robot, sim.getPortName(), 50);
+  size_t counts[2] = {0, 0};
+  for (int i = 0; i < 2; i++) {
+    if (robotManager.start()) {
+      return true;
+    }
+    msleep(300);
+    robotManager.stop();
+    msleep(10); //書き込んだバイト列が届くのを待つ
+    std::vector<SimFrame> frames;
+    uint32_t badFrames, skippedBytes;
+    sim.getFrames(frames, badFrames, skippedBytes);
+    counts[i] = frames.size();
+  }
+  robot.reset();
+  sim.stop();
+  if (counts[0] == 0 || counts[1] <= counts[0]) {
+    cout << "NG: RobotManagerの再開 パケット " << counts[0] << " -> " << counts[1] << endl;
+    return true;
+  }
+  return false;
+}
+
+///robot-simメイン関数
+int main(int argc, char* argv[])
+{
+  std::string type;
+  bool reply = false;
+  bool test = false;
+  for (int i=1; i<argc; i++) {
+    std::string a = argv[i];
+    if (a == "-r") {
+      reply = true;
+    } else if (a == "-t") {
+      test = true;
+    } else {
+      type = a;
+    }
+  }
+  getTimeInitialize();
+
+  if (test) {
+    //自動テスト（種類を省略したら全て）
+    int ng = 0;
+    std::vector<const SimProtocol *> all;
+    for (const SimProtocol &p : protocols) {
+      if (type.empty() || type == p.type) {
+        ng += testRobots(std::vector<const SimProtocol *>(1, &p), false) ? 1 : 0;
+        all.push_back(&p);
+      }
+    }
+    //選んだ種類を全てRobotManagerで1つのスレッドから同時に動かす
+    cout << "RobotManager:" << endl;
+    ng += testRobots(all, true) ? 1 : 0;
+    if (type.empty() || type == "KXRL2") {
+      ng += testScheduler() ? 1 : 0;
+    }
+    ng += testRcb4Reply() ? 1 : 0;
+    if (!all.empty()) {
+      ng += testRestart(*all.front()) ? 1 : 0;
+    }
+    if (ng > 0) {
+      cout << "NG: " << ng << "回" << endl;
+      return 1;
+    }
+    cout << "OK" << endl;
+    return 0;
+  }
+
+  const SimProtocol *protocol = nullptr;
+  for (const SimProtocol &p : protocols) {
+    if (type == p.type) {
+      protocol = &p;
+    }
+  }
+  if (protocol == nullptr) {
+    cerr << "使い方: robot-sim [-r] RobotType | robot-sim -t [RobotType]" << endl;
+    return 1;
+  }
+  RobotSimulator sim(*protocol, reply);
+  if (sim.start()) {
+    return 1;
+  }
+  cout << "RobotPortName = " << sim.getPortName() << " としてrobot-testなどを起動する．Ctrl-Cで終了．" << endl;
+  size_t shown = 0;
+  int prev = -2;
+  double prevTime = getTime();
+  while (true) {
+    msleep(100);
+    std::vector<SimFrame> frames;
+    uint32_t badFrames, skippedBytes;
+    sim.getFrames(frames, badFrames, skippedBytes);
+    for (; shown < frames.size(); shown++) {
+      if (frames[shown].command != prev) {
+        prev = frames[shown].command;
+        cout << fixed << setprecision(3) << frames[shown].time << " コマンド " << prev << endl;
+      }
+    }
+    double now = getTime();
+    if (now - prevTime > 5) {
+      cout << "パケット " << frames.size() << "，検査に通らない " << badFrames
+        << "，読み捨て " << skippedBytes << " [byte]" << endl;
+      prevTime = now;
+    }
+  }
+  return 0;
+}
+
+#else
+
+///robot-simメイン関数（Linux以外）
+int main(int argc, char* argv[])
+{
+  cerr << "robot-simはLinux専用" << endl;
+  return 1;
+}
+
+#endif
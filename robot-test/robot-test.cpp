@@ -24,6 +24,10 @@ using namespace odens;
 
 ///キーとロボットのコマンド対応を表示する
 void printHelp(Robot *pr);
+///ロボットからの受信をまとめた情報を表示する
+void printTelemetry(Robot *pr);
+///送信の統計を表示する
+void printSendStats(Robot *pr);
 
 ///robot-testメイン関数
 int main(int argc, char* argv[])
@@ -50,6 +54,7 @@ int main(int argc, char* argv[])
     return 1;
   }
 
+  probot->setReceive(Config::RobotReceive);
   if (probot->start(Config::RobotPortName, 50)) {
     cerr << "終了" << endl;
     return 1;
@@ -64,6 +69,16 @@ int main(int argc, char* argv[])
       int com = size; //無効な値としてsizeを利用
       if (c == '?') {
         printHelp(probot);
+      } else if (c == 'T') {
+        printTelemetry(probot);
+      } else if (c == 'S') {
+        printSendStats(probot);
+      } else if (c == 'M') {
+        //連続値の移動指令の例（前進0.5，左旋回0.3）
+        RobotMotion m = {0.5, 0, 0.3};
+        if (!probot->setMotion(m)) {
+          cout << probot->getCommandString() << endl;
+        }
       } else if (c == ' ') {
         com = 0;
       } else if ('0' <= c && c <= '9') {
@@ -96,5 +111,35 @@ void printHelp(Robot *pr)
     }
     cout << c << ": " << pr->getCommandString(i) << endl;
   }
+  cout << "T: ロボットからの受信の表示（RobotReceive = trueの場合）" << endl;
+  cout << "S: 送信の統計の表示" << endl;
+  if (pr->supportsMotion()) {
+    cout << "M: 連続値の移動指令（前進0.5，左旋回0.3）" << endl;
+  }
   cout << "?: この一覧の表示" << endl;
+}
+
+void printTelemetry(Robot *pr)
+{
+  RobotTelemetry t = pr->getTelemetry();
+  cout << dec << "ACK: " << t.acks << " NAK: " << t.naks << " 取りこぼし: " << t.lostAcks
+    << " データ: " << t.dataReplies << " 読み捨て: " << t.badBytes << " [byte]" << endl;
+  cout << "往復時間 最新: " << t.rttLast*1000 << " 平均: " << t.rttMean*1000
+    << " 最大: " << t.rttMax*1000 << " [ms]" << endl;
+  if (t.lastData.size > 0) {
+    cout << "最新のデータ: ";
+    for (size_t i = 0; i < t.lastData.size; i++) {
+      cout << hex << int(t.lastData.b[i]) << ",";
+    }
+    cout << dec << endl;
+  }
+}
+
+void printSendStats(Robot *pr)
+{
+  RobotSendStats s = pr->getSendStats();
+  cout << dec << "書き込み: " << s.writes << " 変化: " << s.changes << " 再送: " << s.keepalives
+    << " 失敗: " << s.failures << " 期限切れ: " << s.timeouts << " 合計: " << s.bytes << " [byte]" << endl;
+  cout << "書き込みの時間 平均: " << s.durationMean*1000 << " 最大: " << s.durationMax*1000 << " [ms]" << endl;
+  cout << "変化から書き込みまで 平均: " << s.delayMean*1000 << " 最大: " << s.delayMax*1000 << " [ms]" << endl;
 }
\ No newline at end of file
@@ -51,6 +51,7 @@ int main(int argc, char* argv[])
   }
 
   Estimator estimator;
+  estimator.setParameter(Config::EstimatorParam);
 
   cout << "メインループ開始" << endl;
   while (true) {
@@ -18,6 +18,8 @@
 #include <boost/thread.hpp>
 #include <boost/asio.hpp>
 #include "robot.h"
+#include "robotprotocol.h"
+#include "motionscheduler.h"
 #include "task.h"
 #include "estimator.h"
 
@@ -70,135 +72,181 @@ namespace odens {
     const uint16_t R1 = 0x0800; ///<R1
     const uint16_t R2 = 0x1000; ///<R2
 
-    ///RobotCommand列挙型の項目に対応する文字列を設定するマクロ
-#define SET_COMMAND_STRING_TABLE(x) m_commandStringTable[x] = #x
-
-        ///
-        ///@brief シリアル通信でKHR-3HVへコマンドを送信するクラス
-        ///
-    class KXRL2 : public Robot {
-    private:
-      ///
-      ///@brief KHR-3HVへ送るパケットを作る
-      ///@param[in] c  ボタンの状態を表す2byte
-      ///@param[in] pa1 スライダーPA1
-      ///@param[in] pa2 スライダーPA2
-      ///@param[in] pa3 スライダーPA3
-      ///@param[in] pa4 スライダーPA4
-      ///@return パケットのバイト列
-      ///
-      Packet makePacket(
-        uint16_t c = 0x0000,
-        uint8_t pa1 = 0x00,
-        uint8_t pa2 = 0x00,
-        uint8_t pa3 = 0x00,
-        uint8_t pa4 = 0x00
-      )
+    ///
+    ///@brief KXR-L2の通信規約の記述子（robotprotocol.hを参照）
+    ///
+    ///- RCB-4のCOM→RAMの転送（0d 00 02 50 03 00），ボタン上位，ボタン下位，スライダーPA1～PA4，チェックサム．
+    ///- 出荷時のモーションはスライダーを使わないので，連続値の移動指令には対応しない．
+    ///
+    struct Protocol {
+      typedef Command CommandType; ///<コマンドの列挙型
+      static constexpr size_t commandNum = CommandNOI; ///<コマンドの数
+      static constexpr size_t size = 13; ///<パケットの長さ [byte]
+      static constexpr size_t buttonPos = 6; ///<ボタンの状態の位置
+      static constexpr ButtonFormat buttonFormat = ButtonBigEndian; ///<ボタンの状態の形式
+      static constexpr uint16_t buttonsNone = NONE; ///<何も押さないボタンの状態
+      static constexpr size_t analogPos = 8; ///<アナログ値の位置
+      static constexpr size_t analogNum = 4; ///<アナログ値の数
+      static constexpr ChecksumType checksum = ChecksumSum8; ///<チェックサムの種類
+      static constexpr size_t checksumPos = 12; ///<チェックサムの位置
+      static constexpr int baudRate = 115200; ///<通信速度 [bps]
+      static constexpr boost::asio::serial_port_base::parity::type parity
+        = boost::asio::serial_port_base::parity::even; ///<パリティチェックの種類
+      static constexpr ReplyFormat reply = ReplyFormatRcb4; ///<応答の形式
+      static constexpr int motionForward = -1; ///<前進を割り当てるアナログ値の番号（-1なら対応しない）
+      static constexpr int motionStrafe = -1; ///<横移動を割り当てるアナログ値の番号
+      static constexpr int motionTurn = -1; ///<旋回を割り当てるアナログ値の番号
+      static constexpr int motionSign = 1; ///<連続値の移動指令の正の向きに対するアナログ値の増減
+      ///固定のバイトとアナログの中立値を並べたパケット
+      static constexpr Packet base()
       {
-        Packet p;
-        p.b.resize(13);
-        p.b[0] = 0x0d;
-        p.b[1] = 0x00;
-        p.b[2] = 0x02;
-        p.b[3] = 0x50;
-        p.b[4] = 0x03;
-        p.b[5] = 0x00;
-        uint8_t low = c & 0xff;
-        uint8_t high = (c >> 8) & 0xff;
-        p.b[6] = high;
-        p.b[7] = low;
-        p.b[8] = pa1;
-        p.b[9] = pa2;
-        p.b[10] = pa3;
-        p.b[11] = pa4;
-        uint8_t sum = 0;
-        for (int i = 0; i < 12; i++) {
-          sum += p.b[i];
-        }
-        p.b[12] = sum;//チェックサム
-        return p;
+        return Packet{{{0x0d, 0x00, 0x02, 0x50, 0x03, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}}, 13};
       }
-      //
-      ///@brief KHR-3HVへ送るパケットを設定する
-      ///@return なし
-      ///
-      void initializePacket()
+      ///種類の名前
+      static const char *name()
       {
-        std::cout << "KXRL2::initializePacket()" << std::endl;
-
-        m_packetTable.resize(CommandNOI);
-
-        m_packetTable[CommandNone] = makePacket();
-        m_packetTable[Forward] = makePacket(BU);
-        m_packetTable[ForwardSmall] = makePacket(BU | L1);
-        m_packetTable[Backward] = makePacket(BD);
-        m_packetTable[BackwardSmall] = makePacket(BD | L1);  //未実装
-        m_packetTable[StepRight] = makePacket(BR);
-        m_packetTable[StepRightSmall] = makePacket(BR | L1);  //未実装
-        m_packetTable[TurnRight] = makePacket(BU | BR);
-        m_packetTable[TurnRightSmall] = makePacket(BU | BR | L1);
-        m_packetTable[StepLeft] = makePacket(BL);
-        m_packetTable[StepLeftSmall] = makePacket(B1 | B2 | B3 | B4);  //未実装
-        m_packetTable[TurnLeft] = makePacket(BU | BL);
-        m_packetTable[TurnLeftSmall] = makePacket(BU | BL | L1);
-        m_packetTable[KickRight] = makePacket(B3);
-        m_packetTable[KickRightSide] = makePacket(B3 | R1 | R2);  //未実装
-        m_packetTable[KickRightBack] = makePacket(B3 | BD);  //未実装
-        m_packetTable[KickLeft] = makePacket(B4);
-        m_packetTable[KickLeftSide] = makePacket(B4 | R1 | R2);  //未実装
-        m_packetTable[KickLeftBack] = makePacket(B4 | BD);  //未実装
-        m_packetTable[KeeperRight] = makePacket(BR | B1);  //未実装
-        m_packetTable[KeeperCenter] = makePacket(B2);
-        m_packetTable[KeeperLeft] = makePacket(BL | B1);  //未実装
-        m_packetTable[StandUp] = makePacket(B1 | R2 | L2);
-        m_packetTable[TorqueOn] = makePacket(L2 | R2);
-        m_packetTable[TorqueOff] = makePacket(L1 | R1);
-
-        m_commandStringTable.resize(CommandNOI);
-
-        SET_COMMAND_STRING_TABLE(CommandNone);
-        SET_COMMAND_STRING_TABLE(Forward);
-        SET_COMMAND_STRING_TABLE(ForwardSmall);
-        SET_COMMAND_STRING_TABLE(Backward);
-        SET_COMMAND_STRING_TABLE(BackwardSmall);
-        SET_COMMAND_STRING_TABLE(StepRight);
-        SET_COMMAND_STRING_TABLE(StepRightSmall);
-        SET_COMMAND_STRING_TABLE(TurnRight);
-        SET_COMMAND_STRING_TABLE(TurnRightSmall);
-        SET_COMMAND_STRING_TABLE(StepLeft);
-        SET_COMMAND_STRING_TABLE(StepLeftSmall);
-        SET_COMMAND_STRING_TABLE(TurnLeft);
-        SET_COMMAND_STRING_TABLE(TurnLeftSmall);
-        SET_COMMAND_STRING_TABLE(KickRight);
-        SET_COMMAND_STRING_TABLE(KickRightSide);
-        SET_COMMAND_STRING_TABLE(KickRightBack);
-        SET_COMMAND_STRING_TABLE(KickLeft);
-        SET_COMMAND_STRING_TABLE(KickLeftSide);
-        SET_COMMAND_STRING_TABLE(KickLeftBack);
-        SET_COMMAND_STRING_TABLE(KeeperRight);
-        SET_COMMAND_STRING_TABLE(KeeperCenter);
-        SET_COMMAND_STRING_TABLE(KeeperLeft);
-        SET_COMMAND_STRING_TABLE(StandUp);
-        SET_COMMAND_STRING_TABLE(TorqueOn);
-        SET_COMMAND_STRING_TABLE(TorqueOff);
+        return "KXRL2";
       }
+      static const Packet *table();
+      static const char *const *names();
+    };
 
-    public:
-      KXRL2()
-      {
-        std::cout << "KXRL2 コンストラクタ" << std::endl;
-        m_baud_rate = 115200;
-        m_parity = boost::asio::serial_port_base::parity::even;
-      }
-      ///
-      ///@brief コマンドを表す列挙型の値を返す
-      ///
-      KXRL2::Command getCommand()
-      {
-        return static_cast<kxrl2::Command>(Robot::getCommand());
-      }
+    ///
+    ///@brief KXR-L2へ送るパケットを作る（コンパイル時に計算できる）
+    ///@param[in] c  ボタンの状態を表す2byte
+    ///@param[in] pa1 スライダーPA1
+    ///@param[in] pa2 スライダーPA2
+    ///@param[in] pa3 スライダーPA3
+    ///@param[in] pa4 スライダーPA4
+    ///@return パケットのバイト列
+    ///
+    constexpr Packet makePacket(
+      uint16_t c = 0x0000,
+      uint8_t pa1 = 0x00,
+      uint8_t pa2 = 0x00,
+      uint8_t pa3 = 0x00,
+      uint8_t pa4 = 0x00
+    )
+    {
+      return encodePacket<Protocol>(c, pa1, pa2, pa3, pa4);
+    }
+
+    ///
+    ///@brief 各コマンドのパケットの表（Commandの順に並べる）
+    ///
+    constexpr Packet packetTable[] = {
+      makePacket(),                   //CommandNone
+      makePacket(BU),                 //Forward
+      makePacket(BU | L1),            //ForwardSmall
+      makePacket(BD),                 //Backward
+      makePacket(BD | L1),            //BackwardSmall 未実装
+      makePacket(BR),                 //StepRight
+      makePacket(BR | L1),            //StepRightSmall 未実装
+      makePacket(BU | BR),            //TurnRight
+      makePacket(BU | BR | L1),       //TurnRightSmall
+      makePacket(BL),                 //StepLeft
+      makePacket(B1 | B2 | B3 | B4),  //StepLeftSmall 未実装
+      makePacket(BU | BL),            //TurnLeft
+      makePacket(BU | BL | L1),       //TurnLeftSmall
+      makePacket(B3),                 //KickRight
+      makePacket(B3 | R1 | R2),       //KickRightSide 未実装
+      makePacket(B3 | BD),            //KickRightBack 未実装
+      makePacket(B4),                 //KickLeft
+      makePacket(B4 | R1 | R2),       //KickLeftSide 未実装
+      makePacket(B4 | BD),            //KickLeftBack 未実装
+      makePacket(BR | B1),            //KeeperRight 未実装
+      makePacket(B2),                 //KeeperCenter
+      makePacket(BL | B1),            //KeeperLeft 未実装
+      makePacket(B1 | R2 | L2),       //StandUp
+      makePacket(L2 | R2),            //TorqueOn
+      makePacket(L1 | R1),            //TorqueOff
     };
 
+    ///
+    ///@brief 各コマンドの文字列の表（Commandの順に並べる）
+    ///
+    constexpr const char *commandNames[] = {
+      "CommandNone",
+      "Forward",
+      "ForwardSmall",
+      "Backward",
+      "BackwardSmall",
+      "StepRight",
+      "StepRightSmall",
+      "TurnRight",
+      "TurnRightSmall",
+      "StepLeft",
+      "StepLeftSmall",
+      "TurnLeft",
+      "TurnLeftSmall",
+      "KickRight",
+      "KickRightSide",
+      "KickRightBack",
+      "KickLeft",
+      "KickLeftSide",
+      "KickLeftBack",
+      "KeeperRight",
+      "KeeperCenter",
+      "KeeperLeft",
+      "StandUp",
+      "TorqueOn",
+      "TorqueOff",
+    };
+
+    ///
+    ///@brief 各コマンドの最短の継続時間 [s]と中断の可否（Commandの順に並べる）
+    ///
+    ///- 値はmotionscheduler.hのtimingFreeなどを参照．
+    ///
+    constexpr MotionTiming motionTimingTable[] = {
+      timingFree,      //CommandNone
+      timingStep,      //Forward
+      timingSmallStep, //ForwardSmall
+      timingStep,      //Backward
+      timingSmallStep, //BackwardSmall
+      timingStep,      //StepRight
+      timingSmallStep, //StepRightSmall
+      timingStep,      //TurnRight
+      timingSmallStep, //TurnRightSmall
+      timingStep,      //StepLeft
+      timingSmallStep, //StepLeftSmall
+      timingStep,      //TurnLeft
+      timingSmallStep, //TurnLeftSmall
+      timingWhole,     //KickRight
+      timingWhole,     //KickRightSide
+      timingWhole,     //KickRightBack
+      timingWhole,     //KickLeft
+      timingWhole,     //KickLeftSide
+      timingWhole,     //KickLeftBack
+      timingWhole,     //KeeperRight
+      timingWhole,     //KeeperCenter
+      timingWhole,     //KeeperLeft
+      timingSmallStep, //StandUp
+      timingFree,      //TorqueOn
+      timingFree,      //TorqueOff
+    };
+
+    static_assert(sizeof(packetTable)/sizeof(packetTable[0]) == CommandNOI, "packetTableの要素数がCommandNOIと一致しない");
+    static_assert(sizeof(commandNames)/sizeof(commandNames[0]) == CommandNOI, "commandNamesの要素数がCommandNOIと一致しない");
+    static_assert(sizeof(motionTimingTable)/sizeof(motionTimingTable[0]) == CommandNOI, "motionTimingTableの要素数がCommandNOIと一致しない");
+    static_assert(isProtocolPacketTable<Protocol>(packetTable, CommandNOI), "packetTableに正しくないパケットがある");
+
+    ///パケットの表
+    inline const Packet *Protocol::table()
+    {
+      return packetTable;
+    }
+    ///コマンドの文字列の表
+    inline const char *const *Protocol::names()
+    {
+      return commandNames;
+    }
+
+    ///
+    ///@brief シリアル通信でKXR-L2へコマンドを送信するクラス
+    ///
+    typedef ProtocolRobot<Protocol> KXRL2;
+
     ///
     ///@brief ロボットのタスクの種類
     ///
@@ -217,6 +265,11 @@ namespace odens {
   class TaskKXRL2 : public Task {
   private:
     kxrl2::KXRL2 m_robot;  ///<利用する実ロボット
+    ///
+    ///@brief 目標への移動の状態
+    ///
+    enum MoveMode { Far, Middle, Near };
+    MoveMode m_moveMode;       ///<目標への移動の状態
   public:
     ///
     ///@brief コンストラクタ
@@ -227,6 +280,8 @@ namespace odens {
       :Task(color, number)
     {
       m_probot = &m_robot;
+      m_scheduler.setRobot(m_robot, kxrl2::motionTimingTable, kxrl2::CommandNOI);
+      m_moveMode = Far;
     }
     bool isLying(const srInfo &info);
     int none();
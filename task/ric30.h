@@ -17,6 +17,8 @@
 #include <boost/thread.hpp>
 #include <boost/asio.hpp>
 #include "robot.h"
+#include "robotprotocol.h"
+#include "motionscheduler.h"
 #include "task.h"
 #include "estimator.h"
 
@@ -69,117 +71,171 @@ namespace odens {
     const uint16_t PL = 0x7fff; ///<十字キー左
     const uint16_t PR = 0xdfff; ///<十字キー右
 
-    ///RobotCommand列挙型の項目に対応する文字列を設定するマクロ
-#define SET_COMMAND_STRING_TABLE(x) m_commandStringTable[x] = #x
-
-///
-///@brief シリアル通信でRIC30へコマンドを送信するクラス
-///
-    class RIC30 : public Robot {
-    private:
-      ///
-      ///@brief RIC30へ送るパケットを作る
-      ///@param[in] c  ボタンの状態を表す2byte
-      ///@param[in] rx 右アナログスティック左右
-      ///@param[in] ry 右アナログスティック前後
-      ///@param[in] lx 左アナログスティック左右
-      ///@param[in] ly 左アナログスティック前後
-      ///@return パケットのバイト列
-      ///
-      Packet makePacket(
-        uint16_t c = 0xffff,
-        uint8_t rx = 0x80,
-        uint8_t ry = 0x80,
-        uint8_t lx = 0x80,
-        uint8_t ly = 0x80
-      )
+    ///
+    ///@brief RIC30の通信規約の記述子（robotprotocol.hを参照）
+    ///
+    ///- 6b ff，ボタン上位，ボタン下位，右スティック左右，右スティック前後，左スティック左右，左スティック前後，f3．
+    ///- アナログスティックは0x80が中立で，前（左）へ倒すほど値が小さくなる．
+    ///- 連続値の移動指令は，前進を左スティック前後，横移動を右スティック左右，旋回を左スティック左右に
+    ///  割り当てる（ForwardSmallやTurnLeftSmallと同じ向き）．全て0ならCommandNoneと同じパケットになる．
+    ///
+    struct Protocol {
+      typedef Command CommandType; ///<コマンドの列挙型
+      static constexpr size_t commandNum = CommandNOI; ///<コマンドの数
+      static constexpr size_t size = 9; ///<パケットの長さ [byte]
+      static constexpr size_t buttonPos = 2; ///<ボタンの状態の位置
+      static constexpr ButtonFormat buttonFormat = ButtonBigEndian; ///<ボタンの状態の形式
+      static constexpr uint16_t buttonsNone = NONE; ///<何も押さないボタンの状態
+      static constexpr size_t analogPos = 4; ///<アナログ値の位置
+      static constexpr size_t analogNum = 4; ///<アナログ値の数
+      static constexpr ChecksumType checksum = ChecksumNone; ///<チェックサムの種類
+      static constexpr size_t checksumPos = 0; ///<チェックサムの位置
+      static constexpr int baudRate = 115200; ///<通信速度 [bps]
+      static constexpr boost::asio::serial_port_base::parity::type parity
+        = boost::asio::serial_port_base::parity::none; ///<パリティチェックの種類
+      static constexpr ReplyFormat reply = ReplyFormatNone; ///<応答の形式
+      static constexpr int motionForward = 3; ///<前進を割り当てるアナログ値の番号（-1なら対応しない）
+      static constexpr int motionStrafe = 0; ///<横移動を割り当てるアナログ値の番号
+      static constexpr int motionTurn = 2; ///<旋回を割り当てるアナログ値の番号
+      static constexpr int motionSign = -1; ///<連続値の移動指令の正の向きに対するアナログ値の増減
+      ///固定のバイトとアナログの中立値を並べたパケット
+      static constexpr Packet base()
       {
-        Packet p;
-        p.b.resize(9);
-        p.b[0] = 0x6b;
-        p.b[1] = 0xff;
-        p.b[2] = (c >> 8) & 0x00ff;
-        p.b[3] = c & 0x00ff;
-        p.b[4] = rx;
-        p.b[5] = ry;
-        p.b[6] = lx;
-        p.b[7] = ly;
-        p.b[8] = 0xf3;
-        return p;
+        return Packet{{{0x6b, 0xff, 0x00, 0x00, 0x80, 0x80, 0x80, 0x80, 0xf3}}, 9};
       }
-      ///
-      ///@brief RIC30へ送るパケットを設定する
-      ///@return なし
-      ///
-      void initializePacket()
+      ///種類の名前
+      static const char *name()
       {
-        std::cout << "RIC30::initializePacket()" << std::endl;
-
-        m_packetTable.resize(CommandNOI);
-
-        m_packetTable[CommandNone] = makePacket();
-        m_packetTable[Forward] = makePacket(PU);
-        m_packetTable[ForwardSmall] = makePacket(NONE, 0x80, 0x80, 0x80, 0x00);
-        m_packetTable[Backward] = makePacket(PD);
-        m_packetTable[BackwardSmall] = makePacket();
-        m_packetTable[StepRight] = makePacket(PR);
-        m_packetTable[StepRightSmall] = makePacket();
-        m_packetTable[TurnRight] = makePacket(R1);
-        m_packetTable[TurnRightSmall] = makePacket(NONE, 0x80, 0x80, 0xff, 0x80);
-        m_packetTable[StepLeft] = makePacket(PL);
-        m_packetTable[StepLeftSmall] = makePacket();
-        m_packetTable[TurnLeft] = makePacket(L1);
-        m_packetTable[TurnLeftSmall] = makePacket(NONE, 0x80, 0x80, 0x00, 0x80);
-        m_packetTable[KickRight] = makePacket(B2);
-        m_packetTable[KickLeft] = makePacket(B4);
-        m_packetTable[KeeperRight] = makePacket(R2);
-        m_packetTable[KeeperCenter] = makePacket(B1);
-        m_packetTable[KeeperLeft] = makePacket(L2);
-        m_packetTable[StandUp] = makePacket(B3);
-        m_packetTable[TorqueOn] = makePacket(START);
-        m_packetTable[TorqueOff] = makePacket(SELECT);
-
-        m_commandStringTable.resize(CommandNOI);
-
-        SET_COMMAND_STRING_TABLE(CommandNone);
-        SET_COMMAND_STRING_TABLE(Forward);
-        SET_COMMAND_STRING_TABLE(ForwardSmall);
-        SET_COMMAND_STRING_TABLE(Backward);
-        SET_COMMAND_STRING_TABLE(BackwardSmall);
-        SET_COMMAND_STRING_TABLE(StepRight);
-        SET_COMMAND_STRING_TABLE(StepRightSmall);
-        SET_COMMAND_STRING_TABLE(TurnRight);
-        SET_COMMAND_STRING_TABLE(TurnRightSmall);
-        SET_COMMAND_STRING_TABLE(StepLeft);
-        SET_COMMAND_STRING_TABLE(StepLeftSmall);
-        SET_COMMAND_STRING_TABLE(TurnLeft);
-        SET_COMMAND_STRING_TABLE(TurnLeftSmall);
-        SET_COMMAND_STRING_TABLE(KickRight);
-        SET_COMMAND_STRING_TABLE(KickLeft);
-        SET_COMMAND_STRING_TABLE(KeeperRight);
-        SET_COMMAND_STRING_TABLE(KeeperCenter);
-        SET_COMMAND_STRING_TABLE(KeeperLeft);
-        SET_COMMAND_STRING_TABLE(StandUp);
-        SET_COMMAND_STRING_TABLE(TorqueOn);
-        SET_COMMAND_STRING_TABLE(TorqueOff);
+        return "RIC30";
       }
+      static const Packet *table();
+      static const char *const *names();
+    };
 
-    public:
-      RIC30()
-      {
-        std::cout << "RIC30 コンストラクタ" << std::endl;
-        m_baud_rate = 115200;
-        m_parity = boost::asio::serial_port_base::parity::none;
-      }
-      ric30::Command getCommand()
-        ///
-        ///@brief コマンドを表す列挙型の値を返す
-        ///
-      {
-        return static_cast<ric30::Command>(Robot::getCommand());
-      }
+    ///
+    ///@brief RIC30へ送るパケットを作る（コンパイル時に計算できる）
+    ///@param[in] c  ボタンの状態を表す2byte
+    ///@param[in] rx 右アナログスティック左右
+    ///@param[in] ry 右アナログスティック前後
+    ///@param[in] lx 左アナログスティック左右
+    ///@param[in] ly 左アナログスティック前後
+    ///@return パケットのバイト列
+    ///
+    constexpr Packet makePacket(
+      uint16_t c = 0xffff,
+      uint8_t rx = 0x80,
+      uint8_t ry = 0x80,
+      uint8_t lx = 0x80,
+      uint8_t ly = 0x80
+    )
+    {
+      return encodePacket<Protocol>(c, rx, ry, lx, ly);
+    }
+
+    ///
+    ///@brief 各コマンドのパケットの表（Commandの順に並べる）
+    ///
+    constexpr Packet packetTable[] = {
+      makePacket(),                              //CommandNone
+      makePacket(PU),                            //Forward
+      makePacket(NONE, 0x80, 0x80, 0x80, 0x00),  //ForwardSmall
+      makePacket(PD),                            //Backward
+      makePacket(),                              //BackwardSmall
+      makePacket(PR),                            //StepRight
+      makePacket(),                              //StepRightSmall
+      makePacket(R1),                            //TurnRight
+      makePacket(NONE, 0x80, 0x80, 0xff, 0x80),  //TurnRightSmall
+      makePacket(PL),                            //StepLeft
+      makePacket(),                              //StepLeftSmall
+      makePacket(L1),                            //TurnLeft
+      makePacket(NONE, 0x80, 0x80, 0x00, 0x80),  //TurnLeftSmall
+      makePacket(B2),                            //KickRight
+      makePacket(B4),                            //KickLeft
+      makePacket(R2),                            //KeeperRight
+      makePacket(B1),                            //KeeperCenter
+      makePacket(L2),                            //KeeperLeft
+      makePacket(B3),                            //StandUp
+      makePacket(START),                         //TorqueOn
+      makePacket(SELECT),                        //TorqueOff
+    };
+
+    ///
+    ///@brief 各コマンドの文字列の表（Commandの順に並べる）
+    ///
+    constexpr const char *commandNames[] = {
+      "CommandNone",
+      "Forward",
+      "ForwardSmall",
+      "Backward",
+      "BackwardSmall",
+      "StepRight",
+      "StepRightSmall",
+      "TurnRight",
+      "TurnRightSmall",
+      "StepLeft",
+      "StepLeftSmall",
+      "TurnLeft",
+      "TurnLeftSmall",
+      "KickRight",
+      "KickLeft",
+      "KeeperRight",
+      "KeeperCenter",
+      "KeeperLeft",
+      "StandUp",
+      "TorqueOn",
+      "TorqueOff",
     };
 
+    ///
+    ///@brief 各コマンドの最短の継続時間 [s]と中断の可否（Commandの順に並べる）
+    ///
+    ///- 値はmotionscheduler.hのtimingFreeなどを参照．
+    ///
+    constexpr MotionTiming motionTimingTable[] = {
+      timingFree,      //CommandNone
+      timingStep,      //Forward
+      timingSmallStep, //ForwardSmall
+      timingStep,      //Backward
+      timingSmallStep, //BackwardSmall
+      timingStep,      //StepRight
+      timingSmallStep, //StepRightSmall
+      timingStep,      //TurnRight
+      timingSmallStep, //TurnRightSmall
+      timingStep,      //StepLeft
+      timingSmallStep, //StepLeftSmall
+      timingStep,      //TurnLeft
+      timingSmallStep, //TurnLeftSmall
+      timingWhole,     //KickRight
+      timingWhole,     //KickLeft
+      timingWhole,     //KeeperRight
+      timingWhole,     //KeeperCenter
+      timingWhole,     //KeeperLeft
+      timingSmallStep, //StandUp
+      timingFree,      //TorqueOn
+      timingFree,      //TorqueOff
+    };
+
+    static_assert(sizeof(packetTable)/sizeof(packetTable[0]) == CommandNOI, "packetTableの要素数がCommandNOIと一致しない");
+    static_assert(sizeof(commandNames)/sizeof(commandNames[0]) == CommandNOI, "commandNamesの要素数がCommandNOIと一致しない");
+    static_assert(sizeof(motionTimingTable)/sizeof(motionTimingTable[0]) == CommandNOI, "motionTimingTableの要素数がCommandNOIと一致しない");
+    static_assert(isProtocolPacketTable<Protocol>(packetTable, CommandNOI), "packetTableに正しくないパケットがある");
+
+    ///パケットの表
+    inline const Packet *Protocol::table()
+    {
+      return packetTable;
+    }
+    ///コマンドの文字列の表
+    inline const char *const *Protocol::names()
+    {
+      return commandNames;
+    }
+
+    ///
+    ///@brief シリアル通信でRIC30へコマンドを送信するクラス
+    ///
+    typedef ProtocolRobot<Protocol> RIC30;
+
     ///
     ///@brief ロボットのタスクの種類
     ///
@@ -198,6 +254,11 @@ namespace odens {
   class TaskRIC30 : public Task {
   private:
     ric30::RIC30 m_robot; ///<利用する実ロボット
+    ///
+    ///@brief 目標への移動の状態
+    ///
+    enum MoveMode { Far, Middle, Near };
+    MoveMode m_moveMode;       ///<目標への移動の状態
   public:
     ///
     ///@brief コンストラクタ
@@ -208,6 +269,8 @@ namespace odens {
       :Task(color, number)
     {
       m_probot = &m_robot;
+      m_scheduler.setRobot(m_robot, ric30::motionTimingTable, ric30::CommandNOI);
+      m_moveMode = Far;
     }
     bool isLying(const srInfo &info);
     int none();
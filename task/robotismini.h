@@ -17,6 +17,8 @@
 #include <boost/thread.hpp>
 #include <boost/asio.hpp>
 #include "robot.h"
+#include "robotprotocol.h"
+#include "motionscheduler.h"
 #include "task.h"
 #include "estimator.h"
 
@@ -63,106 +65,161 @@ namespace odens {
     const uint16_t B5 = 0X0100; ///<5ボタン
     const uint16_t B6 = 0X0200; ///<6ボタン
 
-    ///RobotCommand列挙型の項目に対応する文字列を設定するマクロ
-#define SET_COMMAND_STRING_TABLE(x) m_commandStringTable[x] = #x
-
-///
-///@brief シリアル通信でROBOTIS MINIへコマンドを送信するクラス
-///
-    class ROBOTISMINI : public Robot {
-    private:
-      ///
-      ///@brief ROBOTIS MINIへ送るパケットを作る
-      ///@param[in] command  ボタンの状態を表す2byte
-      ///@return パケットのバイト列
-      ///
-      Packet makePacket(uint16_t command = 0)
+    ///
+    ///@brief ROBOTIS MINIの通信規約の記述子（robotprotocol.hを参照）
+    ///
+    ///- ff 55，ボタン下位，~ボタン下位，ボタン上位，~ボタン上位．反転したバイトが検査の代わりになる．
+    ///- 応答も同じ形式（値の意味はロボット側のプログラムで決める）．
+    ///
+    struct Protocol {
+      typedef Command CommandType; ///<コマンドの列挙型
+      static constexpr size_t commandNum = CommandNOI; ///<コマンドの数
+      static constexpr size_t size = 6; ///<パケットの長さ [byte]
+      static constexpr size_t buttonPos = 2; ///<ボタンの状態の位置
+      static constexpr ButtonFormat buttonFormat = ButtonInvertedPairs; ///<ボタンの状態の形式
+      static constexpr uint16_t buttonsNone = NONE; ///<何も押さないボタンの状態
+      static constexpr size_t analogPos = 0; ///<アナログ値の位置
+      static constexpr size_t analogNum = 0; ///<アナログ値の数
+      static constexpr ChecksumType checksum = ChecksumNone; ///<チェックサムの種類
+      static constexpr size_t checksumPos = 0; ///<チェックサムの位置
+      static constexpr int baudRate = 57600; ///<通信速度 [bps]
+      static constexpr boost::asio::serial_port_base::parity::type parity
+        = boost::asio::serial_port_base::parity::none; ///<パリティチェックの種類
+      static constexpr ReplyFormat reply = ReplyFormatEcho; ///<応答の形式
+      static constexpr int motionForward = -1; ///<前進を割り当てるアナログ値の番号（-1なら対応しない）
+      static constexpr int motionStrafe = -1; ///<横移動を割り当てるアナログ値の番号
+      static constexpr int motionTurn = -1; ///<旋回を割り当てるアナログ値の番号
+      static constexpr int motionSign = 1; ///<連続値の移動指令の正の向きに対するアナログ値の増減
+      ///固定のバイトとアナログの中立値を並べたパケット
+      static constexpr Packet base()
       {
-        Packet p;
-        p.b.resize(6);
-        p.b[0] = 0xff;
-        p.b[1] = 0x55;
-        uint8_t low = command & 0xff;
-        uint8_t high = (command >> 8) & 0xff;
-        p.b[2] = low;
-        p.b[3] = ~low;
-        p.b[4] = high;
-        p.b[5] = ~high;
-        return p;
+        return Packet{{{0xff, 0x55, 0x00, 0x00, 0x00, 0x00}}, 6};
       }
-      //
-      ///@brief ROBOTIS MINIへ送るパケットを設定する
-      ///@return なし
-      ///
-      void initializePacket()
+      ///種類の名前
+      static const char *name()
       {
-        std::cout << "ROBOTISMINI::initializePacket()" << std::endl;
-
-        m_packetTable.resize(CommandNOI);
-
-        m_packetTable[CommandNone] = makePacket();
-        m_packetTable[Forward] = makePacket(BU);
-        m_packetTable[ForwardSmall] = makePacket(BU | B6);
-        m_packetTable[Backward] = makePacket(BD);
-        m_packetTable[BackwardSmall] = makePacket(BD | B6);
-        m_packetTable[StepRight] = makePacket(BR | B5);
-        m_packetTable[StepRightSmall] = makePacket(BR | B6);
-        m_packetTable[TurnRight] = makePacket(BR);
-        m_packetTable[TurnRightSmall] = makePacket(BR | B1);
-        m_packetTable[StepLeft] = makePacket(BL | B5);
-        m_packetTable[StepLeftSmall] = makePacket(BL | B6);
-        m_packetTable[TurnLeft] = makePacket(BL);
-        m_packetTable[TurnLeftSmall] = makePacket(BL | B1);
-        m_packetTable[KickRight] = makePacket(BU | B4);
-        m_packetTable[KickLeft] = makePacket(BU | B2);
-        m_packetTable[KeeperRight] = makePacket(BR | B1 | B5);
-        m_packetTable[KeeperCenter] = makePacket(BL | B1 | B5 | B6);
-        m_packetTable[KeeperLeft] = makePacket(BL | B1 | B5);
-        m_packetTable[StandUp] = makePacket(BU | B1);
-        m_packetTable[TorqueOn] = makePacket(BU | B1 | B5 | B6);
-        m_packetTable[TorqueOff] = makePacket(BD | B3 | B5 | B6);
-
-        m_commandStringTable.resize(CommandNOI);
-
-        SET_COMMAND_STRING_TABLE(CommandNone);
-        SET_COMMAND_STRING_TABLE(Forward);
-        SET_COMMAND_STRING_TABLE(ForwardSmall);
-        SET_COMMAND_STRING_TABLE(Backward);
-        SET_COMMAND_STRING_TABLE(BackwardSmall);
-        SET_COMMAND_STRING_TABLE(StepRight);
-        SET_COMMAND_STRING_TABLE(StepRightSmall);
-        SET_COMMAND_STRING_TABLE(TurnRight);
-        SET_COMMAND_STRING_TABLE(TurnRightSmall);
-        SET_COMMAND_STRING_TABLE(StepLeft);
-        SET_COMMAND_STRING_TABLE(StepLeftSmall);
-        SET_COMMAND_STRING_TABLE(TurnLeft);
-        SET_COMMAND_STRING_TABLE(TurnLeftSmall);
-        SET_COMMAND_STRING_TABLE(KickRight);
-        SET_COMMAND_STRING_TABLE(KickLeft);
-        SET_COMMAND_STRING_TABLE(KeeperRight);
-        SET_COMMAND_STRING_TABLE(KeeperCenter);
-        SET_COMMAND_STRING_TABLE(KeeperLeft);
-        SET_COMMAND_STRING_TABLE(StandUp);
-        SET_COMMAND_STRING_TABLE(TorqueOn);
-        SET_COMMAND_STRING_TABLE(TorqueOff);
+        return "ROBOTISMINI";
       }
+      static const Packet *table();
+      static const char *const *names();
+    };
 
-    public:
-      ROBOTISMINI()
-      {
-        std::cout << "ROBOTISMINI コンストラクタ" << std::endl;
-        m_baud_rate = 57600;
-        m_parity = boost::asio::serial_port_base::parity::none;
-      }
-      ///
-      ///@brief コマンドを表す列挙型の値を返す
-      ///
-      robotismini::Command getCommand()
-      {
-        return static_cast<robotismini::Command>(Robot::getCommand());
-      }
+    ///
+    ///@brief ROBOTIS MINIへ送るパケットを作る（コンパイル時に計算できる）
+    ///@param[in] command  ボタンの状態を表す2byte
+    ///@return パケットのバイト列
+    ///
+    constexpr Packet makePacket(
+      uint16_t command = 0
+    )
+    {
+      return encodePacket<Protocol>(command, 0, 0, 0, 0);
+    }
+
+    ///
+    ///@brief 各コマンドのパケットの表（Commandの順に並べる）
+    ///
+    constexpr Packet packetTable[] = {
+      makePacket(),                   //CommandNone
+      makePacket(BU),                 //Forward
+      makePacket(BU | B6),            //ForwardSmall
+      makePacket(BD),                 //Backward
+      makePacket(BD | B6),            //BackwardSmall
+      makePacket(BR | B5),            //StepRight
+      makePacket(BR | B6),            //StepRightSmall
+      makePacket(BR),                 //TurnRight
+      makePacket(BR | B1),            //TurnRightSmall
+      makePacket(BL | B5),            //StepLeft
+      makePacket(BL | B6),            //StepLeftSmall
+      makePacket(BL),                 //TurnLeft
+      makePacket(BL | B1),            //TurnLeftSmall
+      makePacket(BU | B4),            //KickRight
+      makePacket(BU | B2),            //KickLeft
+      makePacket(BR | B1 | B5),       //KeeperRight
+      makePacket(BL | B1 | B5 | B6),  //KeeperCenter
+      makePacket(BL | B1 | B5),       //KeeperLeft
+      makePacket(BU | B1),            //StandUp
+      makePacket(BU | B1 | B5 | B6),  //TorqueOn
+      makePacket(BD | B3 | B5 | B6),  //TorqueOff
+    };
+
+    ///
+    ///@brief 各コマンドの文字列の表（Commandの順に並べる）
+    ///
+    constexpr const char *commandNames[] = {
+      "CommandNone",
+      "Forward",
+      "ForwardSmall",
+      "Backward",
+      "BackwardSmall",
+      "StepRight",
+      "StepRightSmall",
+      "TurnRight",
+      "TurnRightSmall",
+      "StepLeft",
+      "StepLeftSmall",
+      "TurnLeft",
+      "TurnLeftSmall",
+      "KickRight",
+      "KickLeft",
+      "KeeperRight",
+      "KeeperCenter",
+      "KeeperLeft",
+      "StandUp",
+      "TorqueOn",
+      "TorqueOff",
     };
 
+    ///
+    ///@brief 各コマンドの最短の継続時間 [s]と中断の可否（Commandの順に並べる）
+    ///
+    ///- 値はmotionscheduler.hのtimingFreeなどを参照．
+    ///
+    constexpr MotionTiming motionTimingTable[] = {
+      timingFree,      //CommandNone
+      timingStep,      //Forward
+      timingSmallStep, //ForwardSmall
+      timingStep,      //Backward
+      timingSmallStep, //BackwardSmall
+      timingStep,      //StepRight
+      timingSmallStep, //StepRightSmall
+      timingStep,      //TurnRight
+      timingSmallStep, //TurnRightSmall
+      timingStep,      //StepLeft
+      timingSmallStep, //StepLeftSmall
+      timingStep,      //TurnLeft
+      timingSmallStep, //TurnLeftSmall
+      timingWhole,     //KickRight
+      timingWhole,     //KickLeft
+      timingWhole,     //KeeperRight
+      timingWhole,     //KeeperCenter
+      timingWhole,     //KeeperLeft
+      timingSmallStep, //StandUp
+      timingFree,      //TorqueOn
+      timingFree,      //TorqueOff
+    };
+
+    static_assert(sizeof(packetTable)/sizeof(packetTable[0]) == CommandNOI, "packetTableの要素数がCommandNOIと一致しない");
+    static_assert(sizeof(commandNames)/sizeof(commandNames[0]) == CommandNOI, "commandNamesの要素数がCommandNOIと一致しない");
+    static_assert(sizeof(motionTimingTable)/sizeof(motionTimingTable[0]) == CommandNOI, "motionTimingTableの要素数がCommandNOIと一致しない");
+    static_assert(isProtocolPacketTable<Protocol>(packetTable, CommandNOI), "packetTableに正しくないパケットがある");
+
+    ///パケットの表
+    inline const Packet *Protocol::table()
+    {
+      return packetTable;
+    }
+    ///コマンドの文字列の表
+    inline const char *const *Protocol::names()
+    {
+      return commandNames;
+    }
+
+    ///
+    ///@brief シリアル通信でROBOTIS MINIへコマンドを送信するクラス
+    ///
+    typedef ProtocolRobot<Protocol> ROBOTISMINI;
+
     ///
     ///@brief ロボットのタスクの種類
     ///
@@ -181,6 +238,11 @@ namespace odens {
   class TaskROBOTISMINI : public Task {
   private:
     robotismini::ROBOTISMINI m_robot;  ///<利用する実ロボット
+    ///
+    ///@brief 目標への移動の状態
+    ///
+    enum MoveMode { Far, Middle, Near };
+    MoveMode m_moveMode;       ///<目標への移動の状態
   public:
     ///
     ///@brief コンストラクタ
@@ -191,6 +253,8 @@ namespace odens {
       :Task(color, number)
     {
       m_probot = &m_robot;
+      m_scheduler.setRobot(m_robot, robotismini::motionTimingTable, robotismini::CommandNOI);
+      m_moveMode = Far;
     }
     bool isLying(const srInfo &info);
     int none();
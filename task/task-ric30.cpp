@@ -29,7 +29,7 @@ namespace odens {
   ///@retval true 倒れている
   ///
   bool TaskRIC30::isLying(const srInfo &info) {
-    Command com = m_robot.getCommand();
+    RobotCommand com = m_robot.getCommand(); //連続値の移動指令のこともあるのでCommandにしない
     return info.robot[m_ourColor][m_myNumber].isInvisible()
       && com != TorqueOff && com != TorqueOn;
   }
@@ -41,7 +41,7 @@ namespace odens {
   int TaskRIC30::none()
   {
     m_PrevTaskType = TaskTypeNone;
-    m_robot.setCommand(CommandNone);
+    m_scheduler.force(CommandNone, getTime());
     return 0;
   }
 
@@ -51,7 +51,7 @@ namespace odens {
   ///
   int TaskRIC30::torqueOff()
   {
-    m_robot.setCommand(TorqueOff);
+    m_scheduler.force(TorqueOff, getTime());
     return 0;
   }
 
@@ -61,7 +61,7 @@ namespace odens {
   ///
   int TaskRIC30::torqueOn()
   {
-    m_robot.setCommand(TorqueOn);
+    m_scheduler.force(TorqueOn, getTime());
     return 0;
   }
 
@@ -73,25 +73,8 @@ namespace odens {
   ///
   int TaskRIC30::standUp(const srInfo &info, double ctime)
   {
-    static double startTime;
-    static bool isProceeding = false;
-    Command com;
-    if (m_PrevTaskType != TaskStandUp || !isProceeding) {
-      //前のタスクが起き上がりでないか，起き上がりが進行中でなければ，
-      startTime = ctime;
-      isProceeding = true;
-    }
-    if (ctime - startTime < 0.167) {
-      com = CommandNone;
-    } else if (ctime - startTime < 0.333) {
-      com = StandUp;
-    } else {
-      com = CommandNone;
-      isProceeding = false;
-    }
-
+    runStandUp(CommandNone, StandUp, ctime);
     m_PrevTaskType = TaskStandUp;
-    m_robot.setCommand(com);
     return 0;
   }
 
@@ -116,6 +99,9 @@ namespace odens {
       return 1;
     }
     Orthogonal targetLocal = target.transform(robot); //目標をロボット座標系へ変換
+    if (m_parametricMotion) {
+      return moveByMotion(targetLocal);
+    }
     double qG = targetLocal.theta; //ローカル座標系における目標の角度
     double qP = targetLocal.angle(); //目標へ向かう角度
     double d = targetLocal.distance(); //目標までの距離
@@ -143,29 +129,27 @@ namespace odens {
     Command trans = transCom[vp[0].second];
 
     //状態遷移
-    enum Mode { Far, Middle, Near };
-    static Mode mode = Far;
-    if (mode == Far) {
+    if (m_moveMode == Far) {
       if (abs(d) < 70)
-        mode = Near;
+        m_moveMode = Near;
       else if (abs(d) < 100) {
-        mode = Middle;
+        m_moveMode = Middle;
       }
-    } else if (mode == Middle) {
+    } else if (m_moveMode == Middle) {
       if (abs(d) > 150) {
-        mode = Far;
+        m_moveMode = Far;
       } else if (abs(d) < 70) {
-        mode = Near;
+        m_moveMode = Near;
       }
-    } else if (mode == Near) {
+    } else if (m_moveMode == Near) {
       if (abs(d) > 130) {
-        mode = Far;
+        m_moveMode = Far;
       }
     }
 
     //状態によるコマンドの決定
     int retval = 0;
-    if (mode == Far) {
+    if (m_moveMode == Far) {
       if (abs(q1) > DEG2RAD(35)) {
         if (q1 > 0) {
           com = TurnLeft;
@@ -175,7 +159,7 @@ namespace odens {
       } else {
         com = trans;
       }
-    } else if (mode == Middle) {
+    } else if (m_moveMode == Middle) {
       if (abs(q1) > DEG2RAD(20)) {
         if (q1 > 0) {
           com = TurnLeft;
@@ -185,7 +169,7 @@ namespace odens {
       } else {
         com = trans;
       }
-    } else if (mode == Near) {
+    } else if (m_moveMode == Near) {
       if (abs(qG) > DEG2RAD(60)) {
         if (qG > 0) {
           com = TurnLeft;
@@ -204,7 +188,7 @@ namespace odens {
         retval = 10;
       }
     }
-    m_robot.setCommand(com);
+    m_scheduler.request(com, getTime());
     return retval;
   }
 
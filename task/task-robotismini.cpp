@@ -38,7 +38,7 @@ namespace odens {
   int TaskROBOTISMINI::none()
   {
     m_PrevTaskType = TaskTypeNone;
-    m_robot.setCommand(CommandNone);
+    m_scheduler.force(CommandNone, getTime());
     return 0;
   }
 
@@ -48,7 +48,7 @@ namespace odens {
   ///
   int TaskROBOTISMINI::torqueOff()
   {
-    m_robot.setCommand(TorqueOff);
+    m_scheduler.force(TorqueOff, getTime());
     return 0;
   }
 
@@ -58,7 +58,7 @@ namespace odens {
   ///
   int TaskROBOTISMINI::torqueOn()
   {
-    m_robot.setCommand(TorqueOn);
+    m_scheduler.force(TorqueOn, getTime());
     return 0;
   }
 
@@ -94,6 +94,9 @@ namespace odens {
       return 1;
     }
     Orthogonal targetLocal = target.transform(robot); //目標をロボット座標系へ変換
+    if (m_parametricMotion) {
+      return moveByMotion(targetLocal);
+    }
     double qG = targetLocal.theta; //ローカル座標系における目標の角度
     double qP = targetLocal.angle(); //目標へ向かう角度
     double d = targetLocal.distance(); //目標までの距離
@@ -121,29 +124,27 @@ namespace odens {
     Command trans = transCom[vp[0].second];
 
     //状態遷移
-    enum Mode { Far, Middle, Near };
-    static Mode mode = Far;
-    if (mode == Far) {
+    if (m_moveMode == Far) {
       if (abs(d) < 70)
-        mode = Near;
+        m_moveMode = Near;
       else if (abs(d) < 100) {
-        mode = Middle;
+        m_moveMode = Middle;
       }
-    } else if (mode == Middle) {
+    } else if (m_moveMode == Middle) {
       if (abs(d) > 150) {
-        mode = Far;
+        m_moveMode = Far;
       } else if (abs(d) < 70) {
-        mode = Near;
+        m_moveMode = Near;
       }
-    } else if (mode == Near) {
+    } else if (m_moveMode == Near) {
       if (abs(d) > 130) {
-        mode = Far;
+        m_moveMode = Far;
       }
     }
 
     //状態によるコマンドの決定
     int retval = 0;
-    if (mode == Far) {
+    if (m_moveMode == Far) {
       if (abs(q1) > DEG2RAD(35)) {
         if (q1 > 0) {
           com = TurnLeft;
@@ -153,7 +154,7 @@ namespace odens {
       } else {
         com = trans;
       }
-    } else if (mode == Middle) {
+    } else if (m_moveMode == Middle) {
       if (abs(q1) > DEG2RAD(20)) {
         if (q1 > 0) {
           com = TurnLeft;
@@ -163,7 +164,7 @@ namespace odens {
       } else {
         com = trans;
       }
-    } else if (mode == Near) {
+    } else if (m_moveMode == Near) {
       if (abs(qG) > DEG2RAD(60)) {
         if (qG > 0) {
           com = TurnLeft;
@@ -182,7 +183,7 @@ namespace odens {
         retval = 10;
       }
     }
-    m_robot.setCommand(com);
+    m_scheduler.request(com, getTime());
     return retval;
   }
 
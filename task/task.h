@@ -12,10 +12,15 @@
 ///
 
 #pragma once
+#include <algorithm>
 #include "sr.h"
+#include "util.h"
 #include "robot.h"
+#include "robotmanager.h"
+#include "motionscheduler.h"
 #include "game.h"
 #include "estimator.h" 
+#include "predictor.h"
 
 namespace odens {
 
@@ -29,6 +34,61 @@ protected:
   int m_myNumber;     ///<自機の番号
   int m_PrevTaskType; ///<前のタスクの種類
   Robot *m_probot; ///<Taskで使うロボット
+  MotionScheduler m_scheduler; ///<m_probotへ送るコマンドの切り替えの時期を決める
+  bool m_parametricMotion; ///<move()で連続値の移動指令を使うか？
+  BallPredictor m_predictor; ///<転がるボールの迎撃点を求める
+  double m_interceptWalkSpeed; ///<迎撃点を求めるときの歩く速さ [mm/s]（0なら迎撃点を使わない）
+
+  ///
+  ///@brief 連続値の移動指令で目標へ移動する（move()から呼ぶ）
+  ///@param[in] targetLocal ロボット座標系での目標位置
+  ///@return 終了状態（10なら完了）
+  ///
+  ///- 遠い間は目標の方向へ向きながら進む．向きのずれが大きいほど並進を弱めるので，
+  ///  後ろの目標にはその場で旋回してから進む．
+  ///- 近づいたら横移動も使って位置を合わせながら目標の向きへ旋回する．
+  ///- 閾値はコマンドを切り替えるmove()と同じ（70 mm，100 mm，10 deg）．
+  ///
+  int moveByMotion(const Orthogonal &targetLocal)
+  {
+    double qG = targetLocal.theta; //ローカル座標系における目標の角度
+    double qP = targetLocal.angle(); //目標へ向かう角度
+    double d = targetLocal.distance(); //目標までの距離
+    RobotMotion m = {0, 0, 0};
+    int retval = 0;
+    if (d > 100) {
+      double speed = std::min(1.0, d/300) * std::max(0.0, cos(qP));
+      m.forward = speed * cos(qP);
+      m.strafe = speed * sin(qP);
+      m.turn = std::max(-1.0, std::min(1.0, qP/DEG2RAD(45)));
+    } else if (d > 70 || std::abs(qG) > DEG2RAD(10)) {
+      double speed = std::min(1.0, d/300);
+      m.forward = speed * cos(qP);
+      m.strafe = speed * sin(qP);
+      m.turn = std::max(-1.0, std::min(1.0, qG/DEG2RAD(60)));
+    } else {
+      //|qG|が10[deg]未満ならば完了と判断
+      retval = 10;
+    }
+    m_scheduler.requestMotion(m, getTime());
+    return retval;
+  }
+  ///
+  ///@brief 起き上がりの動作の列を進める（ボタンを離してから起き上がりのボタンを押す，standUp()から呼ぶ）
+  ///@param[in] release ボタンを離すコマンド
+  ///@param[in] standUp 起き上がりのコマンド
+  ///@param[in] ctime 現在の時刻 [s]
+  ///
+  ///- 列が終わっていれば始めからやり直す．各段の時間はMotionSchedulerを使う前のstandUp()と同じ．
+  ///
+  void runStandUp(RobotCommand release, RobotCommand standUp, double ctime)
+  {
+    m_scheduler.update(ctime);
+    if (!m_scheduler.isSequenceRunning()) {
+      const MotionStep steps[] = {{release, 0.167}, {standUp, 0.166}};
+      m_scheduler.startSequence(steps, sizeof(steps)/sizeof(steps[0]), ctime);
+    }
+  }
 
 public:
   ///
@@ -36,7 +96,7 @@ public:
   ///@param[in] color 自チームの色
   ///@param[in] number 自機の番号
   ///
-  Task::Task(int color, int number)
+  Task(int color, int number)
   {
     if (color == BLUE) {
       m_ourColor = BLUE;
@@ -47,6 +107,9 @@ public:
     }
     m_myNumber = number;
     m_PrevTaskType = 0;
+    m_probot = nullptr;
+    m_parametricMotion = false;
+    m_interceptWalkSpeed = 0;
   }
   ///
   ///@brief 下請けのRobotの通信開始
@@ -61,6 +124,102 @@ public:
     return m_probot->start(port, interval);
   }
   ///
+  ///@brief 下請けのRobotをRobotManagerに登録する（startRobot()の代わり）
+  ///@param[in] manager 複数のRobotを1つのスレッドで動かすRobotManager
+  ///@param[in] port ポート名
+  ///@param[in] interval 送信間隔[ms]
+  ///
+  bool addRobot(RobotManager &manager, std::string port, int interval)
+  {
+    return manager.add(*m_probot, port, interval);
+  }
+  ///
+  ///@brief 下請けのRobotからの応答を受信するか設定する（startRobot()の前に呼ぶ）
+  ///@param[in] receive 受信するか？
+  ///
+  void setRobotReceive(bool receive)
+  {
+    m_probot->setReceive(receive);
+  }
+  ///
+  ///@brief コマンドの切り替えを動作の区切りまで保留するか設定する
+  ///@param[in] use 保留するか？（falseならMotionSchedulerの前と同じく依頼をすぐに送る）
+  ///
+  void setMotionScheduler(bool use)
+  {
+    m_scheduler.setEnabled(use);
+  }
+  ///
+  ///@brief move()で連続値の移動指令を使うか設定する
+  ///@param[in] use 使うか？（ロボットが対応していなければ使わない）
+  ///
+  void setParametricMotion(bool use)
+  {
+    if (use && !m_probot->supportsMotion()) {
+      std::cerr << "このロボットは連続値の移動指令に対応していない（コマンドを切り替えて移動する）" << std::endl;
+      use = false;
+    }
+    m_parametricMotion = use;
+  }
+  ///
+  ///@brief ballTarget()で迎撃点を求めるときの歩く速さを設定する
+  ///@param[in] speed 歩く速さ [mm/s]（0以下なら迎撃点を使わない）
+  ///
+  void setInterceptWalkSpeed(double speed)
+  {
+    m_interceptWalkSpeed = speed;
+  }
+  ///
+  ///@brief ボールへ向かうときの目標を返す
+  ///@param[in] info フィールドの位置情報（推定値）
+  ///@param[in] ballVel ボールの推定速度 [mm/s]
+  ///@param[in] motion ボールの運動状態
+  ///@return 転がっているか蹴られた直後なら迎撃点，それ以外はボールの位置
+  ///
+  ///- 迎撃点が求まらない場合（自分が見えない，歩く速さが0以下など）もボールの位置を返す．
+  ///
+  Orthogonal ballTarget(const srInfo &info, const Timed2D &ballVel, BallMotion motion)
+  {
+    if (m_interceptWalkSpeed <= 0 || (motion != BallRolling && motion != BallKicked)) {
+      return info.ball;
+    }
+    m_predictor.update(info.ball, ballVel);
+    Timed2D p = m_predictor.intercept(info.robot[m_ourColor][m_myNumber], m_interceptWalkSpeed);
+    if (p.isInvisible()) {
+      return info.ball;
+    }
+    return Orthogonal(p.x, p.y, 0);
+  }
+  ///
+  ///@brief 下請けのRobotからの受信をまとめた情報を返す
+  ///
+  RobotTelemetry getRobotTelemetry()
+  {
+    return m_probot->getTelemetry();
+  }
+  ///
+  ///@brief 下請けのRobotの送信の統計を返す
+  ///
+  RobotSendStats getRobotSendStats()
+  {
+    return m_probot->getSendStats();
+  }
+  ///
+  ///@brief 下請けのRobotの送信の記録を返す
+  ///@param[out] trace 送信の記録（古い順）
+  ///
+  size_t getRobotSendTrace(std::vector<RobotSendRecord> &trace)
+  {
+    return m_probot->getSendTrace(trace);
+  }
+  ///
+  ///@brief コマンドの切り替えの統計を返す
+  ///
+  MotionSchedulerStats getMotionSchedulerStats()
+  {
+    return m_scheduler.getStats();
+  }
+  ///
   ///@brief 自チームの色を返す
   ///
   int getOurColor()
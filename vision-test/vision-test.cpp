@@ -51,6 +51,7 @@ int main(int argc, char* argv[])
   }
 
   Estimator estimator;
+  estimator.setParameter(Config::EstimatorParam);
 
   printHelp();
 